@@ -23,5 +23,7 @@ void cstart (int argc, char ** argv) {
         *start++ = 0;
     }
 
+    sys_call_init();
+
     exit(main(argc, argv));
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+/**
+ * 批量提交的文件操作环
+ *
+ * 用ioring_get_sqe取得空闲的提交项，填好后调用ioring_submit一次交给内核执行，
+ * 再用ioring_peek_cqe逐个取出结果。填写提交项时，可在flags中加入IOSQE_FD_REF
+ * 或IOSQE_LEN_REF，使用同一批中前面操作的结果。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "lib_ioring.h"
+#include <string.h>
+
+/**
+ * @brief 初始化环
+ */
+void ioring_init (ioring_t * ring) {
+    memset(ring, 0, sizeof(ioring_t));
+}
+
+/**
+ * @brief 取得一个空闲的提交项，提交队列满时返回0
+ */
+ioring_sqe_t * ioring_get_sqe (ioring_t * ring) {
+    if (ring->sq_tail - ring->sq_head >= IORING_ENTRIES) {
+        return (ioring_sqe_t *)0;
+    }
+
+    ioring_sqe_t * sqe = ring->sqes + (ring->sq_tail & (IORING_ENTRIES - 1));
+    memset(sqe, 0, sizeof(ioring_sqe_t));
+    ring->sq_tail++;
+    return sqe;
+}
+
+/**
+ * @brief 提交所有未处理的项，返回内核处理的项数
+ */
+int ioring_submit (ioring_t * ring) {
+    return ioring_enter(ring, ring->sq_tail - ring->sq_head);
+}
+
+/**
+ * @brief 取下一个完成项，没有时返回0。使用完后调用ioring_cqe_seen
+ */
+ioring_cqe_t * ioring_peek_cqe (ioring_t * ring) {
+    if (ring->cq_head == ring->cq_tail) {
+        return (ioring_cqe_t *)0;
+    }
+
+    return ring->cqes + (ring->cq_head & (IORING_ENTRIES - 1));
+}
+
+void ioring_cqe_seen (ioring_t * ring) {
+    ring->cq_head++;
+}
+
+void ioring_prep_open (ioring_sqe_t * sqe, const char * path, int flags) {
+    sqe->op = IORING_OP_OPEN;
+    sqe->addr = (uint32_t)path;
+    sqe->len = (uint32_t)flags;
+}
+
+void ioring_prep_read (ioring_sqe_t * sqe, int fd, void * buf, uint32_t len) {
+    sqe->op = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint32_t)buf;
+    sqe->len = len;
+}
+
+void ioring_prep_write (ioring_sqe_t * sqe, int fd, const void * buf, uint32_t len) {
+    sqe->op = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (uint32_t)buf;
+    sqe->len = len;
+}
+
+void ioring_prep_close (ioring_sqe_t * sqe, int fd) {
+    sqe->op = IORING_OP_CLOSE;
+    sqe->fd = fd;
+}
@@ -0,0 +1,24 @@
+/**
+ * 批量提交的文件操作环
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef LIB_IORING_H
+#define LIB_IORING_H
+
+#include "lib_syscall.h"
+
+void ioring_init (ioring_t * ring);
+ioring_sqe_t * ioring_get_sqe (ioring_t * ring);
+int ioring_submit (ioring_t * ring);
+ioring_cqe_t * ioring_peek_cqe (ioring_t * ring);
+void ioring_cqe_seen (ioring_t * ring);
+
+void ioring_prep_open (ioring_sqe_t * sqe, const char * path, int flags);
+void ioring_prep_read (ioring_sqe_t * sqe, int fd, void * buf, uint32_t len);
+void ioring_prep_write (ioring_sqe_t * sqe, int fd, const void * buf, uint32_t len);
+void ioring_prep_close (ioring_sqe_t * sqe, int fd);
+
+#endif // LIB_IORING_H
@@ -0,0 +1,285 @@
+/**
+ * 应用程序的内存分配
+ *
+ * 小块内存从sbrk扩展的堆中分配，空闲块按地址顺序链接，释放时与相邻块合并，
+ * 堆顶空闲区域较大时用负数的sbrk归还给内核。
+ * 大块内存直接用匿名mmap分配，释放时立即munmap，不在堆中留下碎片。
+ * 同一进程的各线程共享堆，空闲链表和sbrk由heap_lock保护。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "lib_syscall.h"
+#include "lib_sync.h"
+#include <string.h>
+#include <reent.h>
+
+#define MALLOC_ALIGN            8                   // 分配对齐
+#define MALLOC_PAGE_SIZE        4096
+#define MALLOC_MMAP_THRESHOLD   (64 * 1024)         // 超过此大小用mmap分配
+#define MALLOC_TOP_PAD          (16 * 1024)         // 扩展堆时多申请的量，减少sbrk次数
+#define MALLOC_TRIM_THRESHOLD   (64 * 1024)         // 堆顶空闲超过此值时归还
+#define MALLOC_MIN_BLOCK        16                  // 切分后剩余块的最小值
+
+#define MBLOCK_MMAP             (1 << 0)            // size最低位：该块由mmap分配
+
+/**
+ * 内存块头部，分配出去的块只使用size，空闲块用next链接
+ */
+typedef struct _mblock_t {
+    uint32_t size;                  // 块大小，含头部
+    struct _mblock_t * next;        // 下一空闲块，仅空闲时有效
+}mblock_t;
+
+static mblock_t * free_list;        // 按地址升序的空闲链表
+static umutex_t heap_lock = UMUTEX_INITIALIZER;     // 保护空闲链表及堆的扩展、归还
+
+static inline uint32_t up_align (uint32_t size, uint32_t bound) {
+    return (size + bound - 1) & ~(bound - 1);
+}
+
+static inline uint32_t mblock_size (mblock_t * block) {
+    return block->size & ~MBLOCK_MMAP;
+}
+
+static inline char * mblock_end (mblock_t * block) {
+    return (char *)block + mblock_size(block);
+}
+
+/**
+ * @brief 将空闲块按地址插入空闲链表，并与前后相邻的块合并
+ */
+static void free_list_insert (mblock_t * block) {
+    mblock_t * pre = (mblock_t *)0;
+    mblock_t * curr = free_list;
+    while (curr && (curr < block)) {
+        pre = curr;
+        curr = curr->next;
+    }
+
+    // 与后一块合并
+    if (curr && (mblock_end(block) == (char *)curr)) {
+        block->size += curr->size;
+        block->next = curr->next;
+    } else {
+        block->next = curr;
+    }
+
+    // 与前一块合并
+    if (pre && (mblock_end(pre) == (char *)block)) {
+        pre->size += block->size;
+        pre->next = block->next;
+    } else if (pre) {
+        pre->next = block;
+    } else {
+        free_list = block;
+    }
+}
+
+/**
+ * @brief 首次适配，从空闲链表中取出至少need字节的块
+ */
+static mblock_t * free_list_take (uint32_t need) {
+    mblock_t * pre = (mblock_t *)0;
+    for (mblock_t * curr = free_list; curr; pre = curr, curr = curr->next) {
+        if (curr->size < need) {
+            continue;
+        }
+
+        mblock_t * next;
+        if (curr->size - need >= MALLOC_MIN_BLOCK) {
+            // 切分，剩余部分留在链表原位置
+            next = (mblock_t *)((char *)curr + need);
+            next->size = curr->size - need;
+            next->next = curr->next;
+            curr->size = need;
+        } else {
+            next = curr->next;
+        }
+
+        if (pre) {
+            pre->next = next;
+        } else {
+            free_list = next;
+        }
+        return curr;
+    }
+
+    return (mblock_t *)0;
+}
+
+/**
+ * @brief 返回链表中最后一个空闲块
+ */
+static mblock_t * free_list_last (void) {
+    mblock_t * curr = free_list;
+    while (curr && curr->next) {
+        curr = curr->next;
+    }
+    return curr;
+}
+
+/**
+ * @brief 扩展堆，使空闲链表中有至少need字节的块
+ */
+static int heap_grow (uint32_t need) {
+    char * top = (char *)sbrk(0);
+    if (top == (char *)-1) {
+        return -1;
+    }
+
+    // 首次扩展时堆起始可能未对齐
+    uint32_t pad = up_align((uint32_t)top, MALLOC_ALIGN) - (uint32_t)top;
+
+    // 堆顶已有空闲块，只需补足差额
+    mblock_t * last = free_list_last();
+    if (last && (mblock_end(last) == top)) {
+        need -= last->size;
+    }
+
+    uint32_t incr = up_align(pad + need + MALLOC_TOP_PAD, MALLOC_PAGE_SIZE);
+    if (sbrk(incr) == (void *)-1) {
+        return -1;
+    }
+
+    mblock_t * block = (mblock_t *)(top + pad);
+    block->size = incr - pad;
+    free_list_insert(block);
+    return 0;
+}
+
+/**
+ * @brief 堆顶空闲区域过大时，归还给内核
+ */
+static void heap_trim (void) {
+    mblock_t * last = free_list_last();
+    if (!last || (last->size < MALLOC_TRIM_THRESHOLD)) {
+        return;
+    }
+
+    char * top = (char *)sbrk(0);
+    if (mblock_end(last) != top) {
+        return;
+    }
+
+    uint32_t release = (last->size - MALLOC_TOP_PAD) & ~(MALLOC_PAGE_SIZE - 1);
+    if (release && (sbrk(-(ptrdiff_t)release) != (void *)-1)) {
+        last->size -= release;
+    }
+}
+
+/**
+ * @brief 分配内存
+ */
+void * malloc (size_t size) {
+    if (size > 0x7FFFFFFF) {
+        return (void *)0;
+    }
+
+    uint32_t need = up_align(size + sizeof(mblock_t), MALLOC_ALIGN);
+    if (need < MALLOC_MIN_BLOCK) {
+        need = MALLOC_MIN_BLOCK;
+    }
+
+    // 大块内存直接映射
+    if (need >= MALLOC_MMAP_THRESHOLD) {
+        uint32_t total = up_align(need, MALLOC_PAGE_SIZE);
+        mblock_t * block = (mblock_t *)mmap((void *)0, total, PROT_READ | PROT_WRITE,
+                                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (block == (mblock_t *)MAP_FAILED) {
+            return (void *)0;
+        }
+        block->size = total | MBLOCK_MMAP;
+        return block + 1;
+    }
+
+    umutex_lock(&heap_lock);
+    mblock_t * block = free_list_take(need);
+    if (!block && (heap_grow(need) == 0)) {
+        block = free_list_take(need);
+    }
+    umutex_unlock(&heap_lock);
+
+    return block ? block + 1 : (void *)0;
+}
+
+/**
+ * @brief 释放内存
+ */
+void free (void * ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    mblock_t * block = (mblock_t *)ptr - 1;
+    if (block->size & MBLOCK_MMAP) {
+        munmap(block, mblock_size(block));
+        return;
+    }
+
+    umutex_lock(&heap_lock);
+    free_list_insert(block);
+    heap_trim();
+    umutex_unlock(&heap_lock);
+}
+
+/**
+ * @brief 重新分配内存，原有空间足够时原地返回
+ */
+void * realloc (void * ptr, size_t size) {
+    if (!ptr) {
+        return malloc(size);
+    }
+
+    if (size == 0) {
+        free(ptr);
+        return (void *)0;
+    }
+
+    mblock_t * block = (mblock_t *)ptr - 1;
+    uint32_t avail = mblock_size(block) - sizeof(mblock_t);
+    if (size <= avail) {
+        return ptr;
+    }
+
+    void * new_ptr = malloc(size);
+    if (new_ptr) {
+        memcpy(new_ptr, ptr, avail);
+        free(ptr);
+    }
+    return new_ptr;
+}
+
+/**
+ * @brief 分配并清零
+ */
+void * calloc (size_t nmemb, size_t size) {
+    if (size && (nmemb > 0x7FFFFFFF / size)) {
+        return (void *)0;
+    }
+
+    size_t total = nmemb * size;
+    void * ptr = malloc(total);
+    if (ptr) {
+        memset(ptr, 0, total);
+    }
+    return ptr;
+}
+
+// newlib内部(如stdio)使用的可重入版本，替换掉库中的实现
+void * _malloc_r (struct _reent * r, size_t size) {
+    return malloc(size);
+}
+
+void _free_r (struct _reent * r, void * ptr) {
+    free(ptr);
+}
+
+void * _realloc_r (struct _reent * r, void * ptr, size_t size) {
+    return realloc(ptr, size);
+}
+
+void * _calloc_r (struct _reent * r, size_t nmemb, size_t size) {
+    return calloc(nmemb, size);
+}
@@ -0,0 +1,100 @@
+/**
+ * 应用程序使用的互斥锁和信号量
+ *
+ * 在共享的整数上用原子操作完成加锁、解锁，无竞争时不进入内核；
+ * 需要等待或唤醒其它进程时，才调用futex。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "lib_syscall.h"
+#include "lib_sync.h"
+
+/**
+ * @brief 初始化互斥锁
+ */
+void umutex_init (umutex_t * mutex) {
+    mutex->state = 0;
+}
+
+/**
+ * @brief 加锁
+ */
+void umutex_lock (umutex_t * mutex) {
+    // 无人持有，直接获得
+    int state = atomic_cmpxchg(&mutex->state, 0, 1);
+    if (state == 0) {
+        return;
+    }
+
+    // 标记为有等待者，然后等待，直到释放时被唤醒再重新获取
+    if (state != 2) {
+        state = atomic_xchg(&mutex->state, 2);
+    }
+    while (state != 0) {
+        futex((int *)&mutex->state, FUTEX_WAIT, 2);
+        state = atomic_xchg(&mutex->state, 2);
+    }
+}
+
+/**
+ * @brief 尝试加锁，成功返回0
+ */
+int umutex_trylock (umutex_t * mutex) {
+    return atomic_cmpxchg(&mutex->state, 0, 1) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief 解锁，有等待者时唤醒其中一个
+ */
+void umutex_unlock (umutex_t * mutex) {
+    if (atomic_add(&mutex->state, -1) != 1) {
+        mutex->state = 0;
+        futex((int *)&mutex->state, FUTEX_WAKE, 1);
+    }
+}
+
+/**
+ * @brief 初始化信号量
+ */
+void usem_init (usem_t * sem, int count) {
+    sem->count = count;
+    sem->waiters = 0;
+}
+
+/**
+ * @brief 尝试获取信号量，成功返回0
+ */
+int usem_trywait (usem_t * sem) {
+    int count;
+    while ((count = sem->count) > 0) {
+        if (atomic_cmpxchg(&sem->count, count, count - 1) == count) {
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief 获取信号量，计数为0时等待
+ */
+void usem_wait (usem_t * sem) {
+    while (usem_trywait(sem) < 0) {
+        // 先登记再等待。登记前已释放的，计数不再为0，futex会立即返回
+        atomic_add(&sem->waiters, 1);
+        futex((int *)&sem->count, FUTEX_WAIT, 0);
+        atomic_add(&sem->waiters, -1);
+    }
+}
+
+/**
+ * @brief 释放信号量，有等待者时唤醒其中一个
+ */
+void usem_post (usem_t * sem) {
+    atomic_add(&sem->count, 1);
+    if (sem->waiters) {
+        futex((int *)&sem->count, FUTEX_WAKE, 1);
+    }
+}
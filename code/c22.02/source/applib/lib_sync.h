@@ -0,0 +1,57 @@
+/**
+ * 应用程序使用的互斥锁和信号量
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef LIB_SYNC_H
+#define LIB_SYNC_H
+
+/**
+ * 互斥锁。0为未锁定，1为已锁定，2为已锁定且可能有等待者
+ * 可放在共享内存中，用于进程间互斥
+ */
+typedef struct _umutex_t {
+    volatile int state;
+}umutex_t;
+
+/**
+ * 计数信号量
+ */
+typedef struct _usem_t {
+    volatile int count;         // 可用的计数
+    volatile int waiters;       // 等待的数量，为0时释放无需进入内核
+}usem_t;
+
+#define UMUTEX_INITIALIZER      {0}
+
+static inline int atomic_cmpxchg (volatile int * ptr, int old, int new_val) {
+    int prev;
+    __asm__ __volatile__("lock cmpxchgl %[n], %[m]"
+            : "=a"(prev), [m]"+m"(*ptr) : [n]"r"(new_val), "0"(old) : "memory");
+    return prev;
+}
+
+static inline int atomic_xchg (volatile int * ptr, int val) {
+    __asm__ __volatile__("xchgl %[v], %[m]" : [v]"+r"(val), [m]"+m"(*ptr) : : "memory");
+    return val;
+}
+
+// 返回相加前的值
+static inline int atomic_add (volatile int * ptr, int val) {
+    __asm__ __volatile__("lock xaddl %[v], %[m]" : [v]"+r"(val), [m]"+m"(*ptr) : : "memory");
+    return val;
+}
+
+void umutex_init (umutex_t * mutex);
+void umutex_lock (umutex_t * mutex);
+int umutex_trylock (umutex_t * mutex);
+void umutex_unlock (umutex_t * mutex);
+
+void usem_init (usem_t * sem, int count);
+void usem_wait (usem_t * sem);
+int usem_trywait (usem_t * sem);
+void usem_post (usem_t * sem);
+
+#endif // LIB_SYNC_H
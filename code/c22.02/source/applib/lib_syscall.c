@@ -11,6 +11,30 @@
 #include "malloc.h"
 #include <string.h>
 
+#define CPUID_EDX_SEP       (1 << 11)       // 支持sysenter/sysexit
+
+static int sysenter_support;            // CPU是否支持sysenter
+static int sysenter_enable;             // 是否使用sysenter进行系统调用
+
+/**
+ * 检查CPU是否支持sysenter，支持时优先使用。启动时调用
+ */
+void sys_call_init (void) {
+    uint32_t eax = 1, ebx, ecx = 0, edx;
+    __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+
+    sysenter_support = (edx & CPUID_EDX_SEP) ? 1 : 0;
+    sysenter_enable = sysenter_support;
+}
+
+/**
+ * 选择是否使用sysenter，CPU不支持时只能使用调用门。返回是否在使用sysenter
+ */
+int sys_call_use_fast (int enable) {
+    sysenter_enable = enable && sysenter_support;
+    return sysenter_enable;
+}
+
 /**
  * 执行系统调用
  */
@@ -18,6 +42,24 @@ static inline int sys_call (syscall_args_t * args) {
     const unsigned long sys_gate_addr[] = {0, SELECTOR_SYSCALL | 0};  // 使用特权级0
     int ret;
 
+    // 快速系统调用，参数由寄存器传递：eax为功能号，ebx/esi/edi/ebp为参数
+    // sysenter不保存返回地址和用户栈，由ecx和edx告诉内核。ebp作参数使用，需先保存
+    if (sysenter_enable) {
+        int arg3 = args->arg3;
+        __asm__ __volatile__(
+                "push %%ebp\n\t"
+                "mov %%edx, %%ebp\n\t"
+                "mov %%esp, %%ecx\n\t"
+                "mov $1f, %%edx\n\t"
+                "sysenter\n\t"
+                "1:\n\t"
+                "pop %%ebp\n\t"
+                :"=a"(ret), "+d"(arg3)
+                :"0"(args->id), "b"(args->arg0), "S"(args->arg1), "D"(args->arg2)
+                :"ecx", "memory");
+        return ret;
+    }
+
     // 采用调用门, 这里只支持5个参数
     // 用调用门的好处是会自动将参数复制到内核栈中，这样内核代码很好取参数
     // 而如果采用寄存器传递，取参比较困难，需要先压栈再取
@@ -46,7 +88,10 @@ int msleep (int ms) {
     return sys_call(&args);
 }
 
-int getpid() {
+/**
+ * 通过系统调用取进程号，getpid直接读取映射的数据页
+ */
+int getpid_syscall (void) {
     syscall_args_t args;
     args.id = SYS_getpid;
     return sys_call(&args);
@@ -174,6 +219,122 @@ int dup (int file) {
     return sys_call(&args);
 }
 
+int dup2 (int file, int new_file) {
+    syscall_args_t args;
+    args.id = SYS_dup2;
+    args.arg0 = file;
+    args.arg1 = new_file;
+    return sys_call(&args);
+}
+
+int pipe (int fd[2]) {
+    syscall_args_t args;
+    args.id = SYS_pipe;
+    args.arg0 = (int)fd;
+    return sys_call(&args);
+}
+
+int shm_open (const char * name, int flags, uint32_t size) {
+    syscall_args_t args;
+    args.id = SYS_shm_open;
+    args.arg0 = (int)name;
+    args.arg1 = flags;
+    args.arg2 = (int)size;
+    return sys_call(&args);
+}
+
+int ksem_open (const char * name, int init_count) {
+    syscall_args_t args;
+    args.id = SYS_ksem_open;
+    args.arg0 = (int)name;
+    args.arg1 = init_count;
+    return sys_call(&args);
+}
+
+int ksem_wait (int id) {
+    syscall_args_t args;
+    args.id = SYS_ksem_wait;
+    args.arg0 = id;
+    return sys_call(&args);
+}
+
+int ksem_post (int id) {
+    syscall_args_t args;
+    args.id = SYS_ksem_post;
+    args.arg0 = id;
+    return sys_call(&args);
+}
+
+int ksem_close (int id) {
+    syscall_args_t args;
+    args.id = SYS_ksem_close;
+    args.arg0 = id;
+    return sys_call(&args);
+}
+
+int futex (int * addr, int op, int val) {
+    syscall_args_t args;
+    args.id = SYS_futex;
+    args.arg0 = (int)addr;
+    args.arg1 = op;
+    args.arg2 = val;
+    return sys_call(&args);
+}
+
+int clone (void * entry, void * stack) {
+    syscall_args_t args;
+    args.id = SYS_clone;
+    args.arg0 = (int)entry;
+    args.arg1 = (int)stack;
+    return sys_call(&args);
+}
+
+int readv(int file, const struct iovec * iov, int iovcnt) {
+    syscall_args_t args;
+    args.id = SYS_readv;
+    args.arg0 = file;
+    args.arg1 = (int)iov;
+    args.arg2 = iovcnt;
+    return sys_call(&args);
+}
+
+int writev(int file, const struct iovec * iov, int iovcnt) {
+    syscall_args_t args;
+    args.id = SYS_writev;
+    args.arg0 = file;
+    args.arg1 = (int)iov;
+    args.arg2 = iovcnt;
+    return sys_call(&args);
+}
+
+ssize_t pread(int file, void * ptr, size_t len, off_t offset) {
+    syscall_args_t args;
+    args.id = SYS_pread;
+    args.arg0 = file;
+    args.arg1 = (int)ptr;
+    args.arg2 = (int)len;
+    args.arg3 = (int)offset;
+    return sys_call(&args);
+}
+
+ssize_t pwrite(int file, const void * ptr, size_t len, off_t offset) {
+    syscall_args_t args;
+    args.id = SYS_pwrite;
+    args.arg0 = file;
+    args.arg1 = (int)ptr;
+    args.arg2 = (int)len;
+    args.arg3 = (int)offset;
+    return sys_call(&args);
+}
+
+int ioring_enter (ioring_t * ring, int to_submit) {
+    syscall_args_t args;
+    args.id = SYS_ioring_enter;
+    args.arg0 = (int)ring;
+    args.arg1 = to_submit;
+    return sys_call(&args);
+}
+
 int ioctl(int fd, int cmd, int arg0, int arg1) {
     syscall_args_t args;
     args.id = SYS_ioctl;
@@ -184,6 +345,103 @@ int ioctl(int fd, int cmd, int arg0, int arg1) {
     return sys_call(&args);
 }
 
+int poll (struct pollfd * fds, int nfds, int timeout) {
+    syscall_args_t args;
+    args.id = SYS_poll;
+    args.arg0 = (int)fds;
+    args.arg1 = nfds;
+    args.arg2 = timeout;
+    return sys_call(&args);
+}
+
+/**
+ * @brief 用poll实现select，exceptfds中的文件不会有事件
+ */
+int select (int nfds, fd_set * readfds, fd_set * writefds, fd_set * exceptfds, struct timeval * timeout) {
+    struct pollfd fds[POLL_FD_MAX];
+    int count = 0;
+
+    for (int fd = 0; fd < nfds; fd++) {
+        short events = 0;
+        if (readfds && FD_ISSET(fd, readfds)) {
+            events |= POLLIN;
+        }
+        if (writefds && FD_ISSET(fd, writefds)) {
+            events |= POLLOUT;
+        }
+        if (events == 0) {
+            continue;
+        }
+
+        if (count >= POLL_FD_MAX) {
+            return -1;
+        }
+        fds[count].fd = fd;
+        fds[count].events = events;
+        count++;
+    }
+
+    int ms = timeout ? (int)(timeout->tv_sec * 1000 + timeout->tv_usec / 1000) : -1;
+    int err = poll(fds, count, ms);
+    if (err < 0) {
+        return err;
+    }
+
+    if (readfds) {
+        FD_ZERO(readfds);
+    }
+    if (writefds) {
+        FD_ZERO(writefds);
+    }
+    if (exceptfds) {
+        FD_ZERO(exceptfds);
+    }
+
+    // 按select的习惯，出错和对端关闭都算作可读写，返回置位的总数
+    int ready = 0;
+    for (int i = 0; i < count; i++) {
+        short revents = fds[i].revents;
+        if (revents & POLLNVAL) {
+            return -1;
+        }
+
+        if (readfds && (fds[i].events & POLLIN) && (revents & (POLLIN | POLLHUP | POLLERR))) {
+            FD_SET(fds[i].fd, readfds);
+            ready++;
+        }
+        if (writefds && (fds[i].events & POLLOUT) && (revents & (POLLOUT | POLLERR))) {
+            FD_SET(fds[i].fd, writefds);
+            ready++;
+        }
+    }
+    return ready;
+}
+
+/**
+ * @brief 读取终端设置
+ */
+int tcgetattr (int fd, struct termios * t) {
+    return ioctl(fd, TTY_CMD_GETATTR, (int)t, 0);
+}
+
+/**
+ * @brief 修改终端设置，输出总是直接写到控制台，各种action效果相同
+ */
+int tcsetattr (int fd, int action, const struct termios * t) {
+    return ioctl(fd, TTY_CMD_SETATTR, (int)t, 0);
+}
+
+/**
+ * @brief 设置为原始模式：无回显，无转换，每次至少读到1个字节
+ */
+void cfmakeraw (struct termios * t) {
+    t->c_iflag &= ~INLCR;
+    t->c_oflag &= ~ONLCR;
+    t->c_lflag &= ~(ECHO | ICANON);
+    t->c_cc[VMIN] = 1;
+    t->c_cc[VTIME] = 0;
+}
+
 DIR * opendir(const char * name) {
     DIR * dir = (DIR *)malloc(sizeof(DIR));
     if (dir == (DIR *)0) {
@@ -231,3 +489,41 @@ int unlink(const char *path) {
     args.arg0 = (int)path;
     return sys_call(&args);
 }
+
+int chdir(const char *path) {
+    syscall_args_t args;
+    args.id = SYS_chdir;
+    args.arg0 = (int)path;
+    return sys_call(&args);
+}
+
+char * getcwd(char * buf, int size) {
+    syscall_args_t args;
+    args.id = SYS_getcwd;
+    args.arg0 = (int)buf;
+    args.arg1 = size;
+    return sys_call(&args) < 0 ? (char *)0 : buf;
+}
+
+void * mmap(void * addr, uint32_t length, int prot, int flags, int fd, uint32_t offset) {
+    mmap_args_t mmap_args;
+    mmap_args.addr = addr;
+    mmap_args.length = length;
+    mmap_args.prot = prot;
+    mmap_args.flags = flags;
+    mmap_args.fd = fd;
+    mmap_args.offset = offset;
+
+    syscall_args_t args;
+    args.id = SYS_mmap;
+    args.arg0 = (int)&mmap_args;
+    return (void *)sys_call(&args);
+}
+
+int munmap(void * addr, uint32_t length) {
+    syscall_args_t args;
+    args.id = SYS_munmap;
+    args.arg0 = (int)addr;
+    args.arg1 = (int)length;
+    return sys_call(&args);
+}
@@ -12,8 +12,13 @@
 #include "os_cfg.h"
 #include "fs/file.h"
 #include "dev/tty.h"
+#include "core/mmap.h"
+#include "ipc/futex.h"
+#include "fs/ioring.h"
+#include "fs/poll.h"
 
 #include <sys/stat.h>
+#include <sys/select.h>
 typedef struct _syscall_args_t {
     int id;
     int arg0;
@@ -36,11 +41,22 @@ int read(int file, char *ptr, int len);
 int write(int file, char *ptr, int len);
 int close(int file);
 int lseek(int file, int ptr, int dir);
+int readv(int file, const struct iovec * iov, int iovcnt);
+int writev(int file, const struct iovec * iov, int iovcnt);
+ssize_t pread(int file, void * ptr, size_t len, off_t offset);
+ssize_t pwrite(int file, const void * ptr, size_t len, off_t offset);
 int isatty(int file);
 int fstat(int file, struct stat *st);
 void * sbrk(ptrdiff_t incr);
 int dup (int file);
+int dup2 (int file, int new_file);
+int pipe (int fd[2]);
 int ioctl(int fd, int cmd, int arg0, int arg1);
+int poll (struct pollfd * fds, int nfds, int timeout);
+int select (int nfds, fd_set * readfds, fd_set * writefds, fd_set * exceptfds, struct timeval * timeout);
+int tcgetattr (int fd, struct termios * t);
+int tcsetattr (int fd, int action, const struct termios * t);
+void cfmakeraw (struct termios * t);
 
 struct dirent {
    int index;         // 在目录中的偏移
@@ -50,6 +66,7 @@ struct dirent {
 };
 
 typedef struct _DIR {
+    int ino;                 // 目录在文件系统中的标识
     int index;               // 当前遍历的索引
     struct dirent dirent;
 }DIR;
@@ -58,5 +75,30 @@ DIR * opendir(const char * name);
 struct dirent* readdir(DIR* dir);
 int closedir(DIR *dir);
 int unlink(const char *pathname);
+int chdir(const char *path);
+char * getcwd(char * buf, int size);
+
+void * mmap(void * addr, uint32_t length, int prot, int flags, int fd, uint32_t offset);
+int munmap(void * addr, uint32_t length);
+int shm_open (const char * name, int flags, uint32_t size);
+
+int ksem_open (const char * name, int init_count);
+int ksem_wait (int id);
+int ksem_post (int id);
+int ksem_close (int id);
+int futex (int * addr, int op, int val);
+int clone (void * entry, void * stack);
+int getpid_syscall (void);
+
+// newlib未开启_POSIX_TIMERS，由lib_vdso.c提供
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_REALTIME          ((clockid_t) 1)
+#define CLOCK_MONOTONIC         ((clockid_t) 4)
+#endif
+int clock_gettime (clockid_t clock_id, struct timespec * tp);
+int ioring_enter (ioring_t * ring, int to_submit);
+
+void sys_call_init (void);
+int sys_call_use_fast (int enable);
 
 #endif //LIB_SYSCALL_H
@@ -0,0 +1,72 @@
+/**
+ * 应用程序的线程
+ *
+ * 线程由clone创建，与创建者共享地址空间和打开的文件。
+ * 线程栈由这里用匿名mmap分配，在thread_join回收线程后释放。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "lib_thread.h"
+#include "lib_syscall.h"
+
+/**
+ * @brief 线程的入口，运行func(arg)后以其返回值退出
+ */
+static void thread_entry (int (*func)(void * arg), void * arg) {
+    _exit(func(arg));
+}
+
+/**
+ * @brief 创建线程运行func(arg)，stack_size为0时使用默认大小
+ */
+int thread_create (thread_t * thread, int (*func)(void * arg), void * arg, uint32_t stack_size) {
+    if (stack_size == 0) {
+        stack_size = THREAD_STACK_SIZE;
+    }
+    stack_size = (stack_size + 4095) & ~4095;
+
+    void * stack = mmap((void *)0, stack_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (stack == MAP_FAILED) {
+        return -1;
+    }
+
+    // 在栈顶放好参数和返回地址，像被调用一样进入thread_entry
+    uint32_t * top = (uint32_t *)((char *)stack + stack_size);
+    *--top = (uint32_t)arg;
+    *--top = (uint32_t)func;
+    *--top = 0;
+
+    int pid = clone(thread_entry, top);
+    if (pid < 0) {
+        munmap(stack, stack_size);
+        return -1;
+    }
+
+    thread->pid = pid;
+    thread->stack = stack;
+    thread->stack_size = stack_size;
+    return 0;
+}
+
+/**
+ * @brief 等待线程结束并释放其栈。期间回收的其它子进程不会再被wait返回
+ */
+int thread_join (thread_t * thread, int * status) {
+    for (;;) {
+        int pid = wait(status);
+        if (pid < 0) {
+            return -1;
+        }
+
+        if (pid == thread->pid) {
+            break;
+        }
+    }
+
+    munmap(thread->stack, thread->stack_size);
+    thread->pid = -1;
+    return 0;
+}
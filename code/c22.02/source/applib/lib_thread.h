@@ -0,0 +1,27 @@
+/**
+ * 应用程序的线程
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef LIB_THREAD_H
+#define LIB_THREAD_H
+
+#include <stdint.h>
+
+#define THREAD_STACK_SIZE       (16 * 1024)     // 默认的线程栈大小
+
+/**
+ * 线程，与创建者共享地址空间和打开的文件
+ */
+typedef struct _thread_t {
+    int pid;                    // 线程的进程号
+    void * stack;               // 线程栈的起始地址
+    uint32_t stack_size;        // 线程栈大小
+}thread_t;
+
+int thread_create (thread_t * thread, int (*func)(void * arg), void * arg, uint32_t stack_size);
+int thread_join (thread_t * thread, int * status);
+
+#endif // LIB_THREAD_H
@@ -0,0 +1,84 @@
+/**
+ * 读取内核映射的只读数据页，取得时间和进程号，无需系统调用
+ *
+ * 时间从系统启动开始计算。tick之间的时间用tsc插值，tsc未校准时精度为一个tick。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "lib_syscall.h"
+#include "core/vdso.h"
+#include <time.h>
+#include <sys/time.h>
+
+#define vdso_data       ((const vdso_data_t *)VDSO_DATA_ADDR)
+#define vdso_task       ((const vdso_task_t *)VDSO_TASK_ADDR)
+
+static inline uint64_t read_tsc (void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * @brief 取启动后经过的毫秒数和不足1毫秒的纳秒数
+ */
+static void vdso_get_time (uint32_t * ms, uint32_t * ns) {
+    uint32_t seq, tick, tsc_lo, tsc_hi, mult;
+
+    // 时钟中断可能在读取过程中更新数据，seq变化时重读
+    do {
+        seq = vdso_data->seq;
+        tick = vdso_data->tick;
+        tsc_lo = vdso_data->tick_tsc_lo;
+        tsc_hi = vdso_data->tick_tsc_hi;
+        mult = vdso_data->tsc_ns_mult;
+    } while ((seq & 1) || (seq != vdso_data->seq));
+
+    uint32_t tick_ns = vdso_data->tick_ms * 1000000;
+    uint32_t delta_ns = 0;
+    if (mult) {
+        uint32_t delta = (uint32_t)(read_tsc() - (((uint64_t)tsc_hi << 32) | tsc_lo));
+        delta_ns = (uint32_t)(((uint64_t)delta * mult) >> VDSO_TSC_SHIFT);
+
+        // 时钟中断被延迟时，不超过下一个tick
+        if (delta_ns >= tick_ns) {
+            delta_ns = tick_ns - 1;
+        }
+    }
+
+    *ms = tick * vdso_data->tick_ms + delta_ns / 1000000;
+    *ns = delta_ns % 1000000;
+}
+
+/**
+ * @brief 取进程号。clone出的线程与创建者共用数据页，得到的是加载程序的进程号
+ */
+int getpid (void) {
+    return vdso_task->pid;
+}
+
+/**
+ * @brief 取时间，CLOCK_REALTIME与CLOCK_MONOTONIC相同，均从启动时开始
+ */
+int clock_gettime (clockid_t clock_id, struct timespec * tp) {
+    uint32_t ms, ns;
+
+    vdso_get_time(&ms, &ns);
+    tp->tv_sec = ms / 1000;
+    tp->tv_nsec = (ms % 1000) * 1000000 + ns;
+    return 0;
+}
+
+/**
+ * @brief 取时间，time()也通过此函数实现
+ */
+int gettimeofday (struct timeval * tv, void * tz) {
+    uint32_t ms, ns;
+
+    vdso_get_time(&ms, &ns);
+    tv->tv_sec = ms / 1000;
+    tv->tv_usec = (ms % 1000) * 1000 + ns / 1000;
+    return 0;
+}
@@ -0,0 +1,1100 @@
+/**
+ * 性能测试程序：测量文件系统、进程间通信等各部分的性能
+ * 使用方法：bench 测试名称 [参数...]
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/file.h>
+#include "lib_syscall.h"
+#include "lib_sync.h"
+#include "lib_thread.h"
+#include "lib_ioring.h"
+#include "main.h"
+
+static char bench_buf[BENCH_BUF_SIZE];
+static uint32_t tsc_per_us;         // 每微秒的tsc计数
+
+/**
+ * @brief 读取时间戳计数器
+ */
+static inline uint64_t read_tsc (void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * @brief 以msleep为基准，粗略测量tsc的频率
+ */
+static void tsc_calibrate (void) {
+    uint64_t start = read_tsc();
+    msleep(100);
+    tsc_per_us = (uint32_t)(read_tsc() - start) / (100 * 1000);
+    if (tsc_per_us == 0) {
+        tsc_per_us = 1;
+    }
+}
+
+/**
+ * @brief 计算从start开始到现在经过的微秒数
+ * 没有libgcc的64位除法，直接用divl，商不超过32位即可，约71分钟
+ */
+static uint32_t elapsed_us (uint64_t start) {
+    uint64_t cycles = read_tsc() - start;
+    uint32_t quot, rem;
+
+    __asm__ __volatile__("divl %[d]" : "=a"(quot), "=d"(rem)
+            : "a"((uint32_t)cycles), "d"((uint32_t)(cycles >> 32)), [d]"rm"(tsc_per_us));
+    return quot;
+}
+
+/**
+ * @brief 显示吞吐量
+ */
+static void show_rate (const char * what, int bytes, uint32_t us) {
+    uint32_t ms = us / 1000;
+    if (ms == 0) {
+        ms = 1;
+    }
+    printf("%s: %d KB in %d ms, %d KB/s\n", what, bytes / 1024, (int)ms, (int)(bytes / 1024 * 1000 / ms));
+}
+
+/**
+ * 追加写测试：不断向文件末尾追加数据，测量写入的吞吐量
+ */
+static int do_append (int argc, char ** argv) {
+    const char * path = argc > 1 ? argv[1] : "bench.dat";
+    int total = (argc > 2 ? atoi(argv[2]) : 1024) * 1024;
+    int chunk = argc > 3 ? atoi(argv[3]) : 4096;
+    if ((chunk <= 0) || (chunk > BENCH_BUF_SIZE)) {
+        fprintf(stderr, "chunk size error: %d\n", chunk);
+        return -1;
+    }
+
+    int fd = open(path, O_CREAT | O_TRUNC | O_WRONLY);
+    if (fd < 0) {
+        fprintf(stderr, "open file failed: %s\n", path);
+        return -1;
+    }
+
+    memset(bench_buf, 'a', chunk);
+    uint64_t start = read_tsc();
+    int written = 0;
+    while (written < total) {
+        int size = (total - written) < chunk ? (total - written) : chunk;
+        int cnt = write(fd, bench_buf, size);
+        if (cnt <= 0) {
+            fprintf(stderr, "write failed at %d bytes, disk full?\n", written);
+            break;
+        }
+        written += cnt;
+    }
+    close(fd);
+
+    show_rate("append", written, elapsed_us(start));
+    return 0;
+}
+
+/**
+ * 随机读测试：在文件中随机定位后读取，测量每次定位+读取的平均耗时
+ */
+static int do_randread (int argc, char ** argv) {
+    const char * path = argc > 1 ? argv[1] : "bench.dat";
+    int count = argc > 2 ? atoi(argv[2]) : 1000;
+    int size = argc > 3 ? atoi(argv[3]) : 512;
+    if ((size <= 0) || (size > BENCH_BUF_SIZE) || (count <= 0)) {
+        fprintf(stderr, "param error\n");
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "open file failed: %s\n", path);
+        return -1;
+    }
+
+    // 取文件大小
+    int file_size = lseek(fd, 0, SEEK_END);
+    if (file_size < size) {
+        fprintf(stderr, "file too small: %d\n", file_size);
+        close(fd);
+        return -1;
+    }
+
+    srand(file_size);
+    uint64_t start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        int offset = rand() % (file_size - size + 1);
+        if ((lseek(fd, offset, SEEK_SET) != offset) || (read(fd, bench_buf, size) != size)) {
+            fprintf(stderr, "read failed at %d\n", offset);
+            break;
+        }
+    }
+    uint32_t us = elapsed_us(start);
+    close(fd);
+
+    printf("randread: %d reads of %d bytes in %d KB file, %d us/read\n",
+                count, size, file_size / 1024, (int)(us / count));
+    return 0;
+}
+
+/**
+ * 映射读测试：分别用read和mmap读取整个文件，比较二者的吞吐量
+ * mmap读取两遍，第二遍的数据已在页缓存中
+ */
+static int do_mmap (int argc, char ** argv) {
+    const char * path = argc > 1 ? argv[1] : "bench.dat";
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "open file failed: %s\n", path);
+        return -1;
+    }
+
+    int file_size = lseek(fd, 0, SEEK_END);
+    lseek(fd, 0, SEEK_SET);
+    if (file_size <= 0) {
+        fprintf(stderr, "empty file: %s\n", path);
+        close(fd);
+        return -1;
+    }
+
+    // 用read读到缓存中，再逐字节累加，模拟对数据的使用
+    uint32_t sum = 0;
+    uint64_t start = read_tsc();
+    int cnt;
+    while ((cnt = read(fd, bench_buf, BENCH_BUF_SIZE)) > 0) {
+        for (int i = 0; i < cnt; i++) {
+            sum += (uint8_t)bench_buf[i];
+        }
+    }
+    show_rate("read", file_size, elapsed_us(start));
+
+    // 映射后直接访问
+    for (int pass = 1; pass <= 2; pass++) {
+        uint32_t map_sum = 0;
+
+        start = read_tsc();
+        uint8_t * data = (uint8_t *)mmap((void *)0, file_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            fprintf(stderr, "mmap failed\n");
+            close(fd);
+            return -1;
+        }
+        for (int i = 0; i < file_size; i++) {
+            map_sum += data[i];
+        }
+        munmap(data, file_size);
+        show_rate(pass == 1 ? "mmap" : "mmap cached", file_size, elapsed_us(start));
+
+        if (map_sum != sum) {
+            fprintf(stderr, "data mismatch: %x != %x\n", map_sum, sum);
+        }
+    }
+
+    close(fd);
+    return 0;
+}
+
+/**
+ * 分配测试：反复分配释放小块和大块内存，检查释放后堆顶是否回落
+ */
+static int do_malloc (int argc, char ** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 1000;
+    void * ptr_list[64];
+
+    char * heap_start = (char *)sbrk(0);
+
+    // 小块：一批分配后全部释放
+    uint64_t start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < 64; j++) {
+            ptr_list[j] = malloc(16 + j * 24);
+        }
+        for (int j = 0; j < 64; j++) {
+            free(ptr_list[j]);
+        }
+    }
+    printf("small: %d alloc/free in %d us\n", count * 64, elapsed_us(start));
+
+    // 大块：走mmap，只有访问到的页才会分配
+    start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        char * buf = (char *)malloc(256 * 1024);
+        if (buf == (char *)0) {
+            fprintf(stderr, "malloc failed\n");
+            return -1;
+        }
+        buf[0] = 1;
+        free(buf);
+    }
+    printf("large: %d alloc/free in %d us\n", count, elapsed_us(start));
+
+    // 大量小块释放后，堆应被收缩
+    for (int j = 0; j < 64; j++) {
+        ptr_list[j] = malloc(4000);
+    }
+    char * heap_peak = (char *)sbrk(0);
+    for (int j = 0; j < 64; j++) {
+        free(ptr_list[j]);
+    }
+    printf("heap: start %x, peak +%d KB, after free +%d KB\n", (uint32_t)heap_start,
+        (int)(heap_peak - heap_start) / 1024, (int)((char *)sbrk(0) - heap_start) / 1024);
+    return 0;
+}
+
+/**
+ * 管道吞吐测试：子进程向管道写入指定大小的数据，父进程读出
+ */
+static int do_pipe (int argc, char ** argv) {
+    int mb = argc > 1 ? atoi(argv[1]) : 4;
+    int chunk = argc > 2 ? atoi(argv[2]) : 4096;
+    if ((mb <= 0) || (chunk <= 0) || (chunk > BENCH_BUF_SIZE)) {
+        fprintf(stderr, "invalid args\n");
+        return -1;
+    }
+
+    int fd[2];
+    if (pipe(fd) < 0) {
+        fprintf(stderr, "create pipe failed\n");
+        return -1;
+    }
+
+    int total = mb * 1024 * 1024;
+    uint64_t start = read_tsc();
+
+    int pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "fork failed\n");
+        close(fd[0]);
+        close(fd[1]);
+        return -1;
+    } else if (pid == 0) {
+        // 子进程：只写
+        close(fd[0]);
+        memset(bench_buf, 0x5A, chunk);
+        for (int sent = 0; sent < total; sent += chunk) {
+            int size = (total - sent) < chunk ? total - sent : chunk;
+            if (write(fd[1], bench_buf, size) != size) {
+                exit(-1);
+            }
+        }
+        close(fd[1]);
+        exit(0);
+    }
+
+    // 父进程：读到写端关闭为止
+    close(fd[1]);
+    int recv = 0, cnt;
+    while ((cnt = read(fd[0], bench_buf, BENCH_BUF_SIZE)) > 0) {
+        recv += cnt;
+    }
+    close(fd[0]);
+
+    int status;
+    wait(&status);
+    show_rate("pipe", recv, elapsed_us(start));
+
+    if (recv != total) {
+        fprintf(stderr, "data lost: %d != %d\n", recv, total);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 显示往返延迟
+ */
+static void show_latency (const char * what, int rounds, uint32_t us) {
+    printf("%s: %d round trips in %d us, %d.%d us each\n", what, rounds, (int)us,
+        (int)(us / rounds), (int)(us * 10 / rounds % 10));
+}
+
+/**
+ * 往返延迟测试：两个进程交替递增共享计数，分别用共享内存+信号量和管道实现
+ */
+static int do_pingpong (int argc, char ** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 10000;
+    if (rounds <= 0) {
+        fprintf(stderr, "invalid args\n");
+        return -1;
+    }
+
+    // 共享内存存放计数，两个信号量轮流唤醒对方
+    int shm_fd = shm_open("bench_pingpong", O_CREAT | O_RDWR, BENCH_SHM_SIZE);
+    if (shm_fd < 0) {
+        fprintf(stderr, "shm_open failed\n");
+        return -1;
+    }
+    volatile int * counter = (volatile int *)mmap((void *)0, BENCH_SHM_SIZE, PROT_READ | PROT_WRITE,
+                                                  MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (counter == (volatile int *)MAP_FAILED) {
+        fprintf(stderr, "mmap failed\n");
+        return -1;
+    }
+    *counter = 0;
+
+    int ping = ksem_open("bench_ping", 0);
+    int pong = ksem_open("bench_pong", 0);
+    if ((ping < 0) || (pong < 0)) {
+        fprintf(stderr, "ksem_open failed\n");
+        return -1;
+    }
+
+    uint64_t start = read_tsc();
+    int pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < rounds; i++) {
+            ksem_wait(ping);
+            (*counter)++;
+            ksem_post(pong);
+        }
+        exit(0);
+    }
+    for (int i = 0; i < rounds; i++) {
+        (*counter)++;
+        ksem_post(ping);
+        ksem_wait(pong);
+    }
+    show_latency("shm+sem", rounds, elapsed_us(start));
+
+    int status;
+    wait(&status);
+    if (*counter != rounds * 2) {
+        fprintf(stderr, "counter mismatch: %d\n", *counter);
+    }
+    ksem_close(ping);
+    ksem_close(pong);
+    munmap((void *)counter, BENCH_SHM_SIZE);
+
+    // 同样的交替过程，用两个管道各传一个字节
+    int to_child[2], to_parent[2];
+    if (pipe(to_child) < 0) {
+        fprintf(stderr, "create pipe failed\n");
+        return -1;
+    }
+    if (pipe(to_parent) < 0) {
+        fprintf(stderr, "create pipe failed\n");
+        close(to_child[0]);
+        close(to_child[1]);
+        return -1;
+    }
+
+    char token = 0;
+    start = read_tsc();
+    pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < rounds; i++) {
+            read(to_child[0], &token, 1);
+            token++;
+            write(to_parent[1], &token, 1);
+        }
+        exit(0);
+    }
+    for (int i = 0; i < rounds; i++) {
+        token++;
+        write(to_child[1], &token, 1);
+        read(to_parent[0], &token, 1);
+    }
+    show_latency("pipe", rounds, elapsed_us(start));
+
+    wait(&status);
+    close(to_child[0]);
+    close(to_child[1]);
+    close(to_parent[0]);
+    close(to_parent[1]);
+    return 0;
+}
+
+/**
+ * 用户态锁测试：无竞争时的加解锁开销，以及两个进程在共享内存上竞争同一把锁
+ */
+static int do_futex (int argc, char ** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    if (count <= 0) {
+        fprintf(stderr, "invalid args\n");
+        return -1;
+    }
+
+    // 锁和计数放在共享的匿名映射中，fork后两个进程访问同一页
+    struct {
+        umutex_t mutex;
+        int counter;
+    } * shared = mmap((void *)0, BENCH_SHM_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        fprintf(stderr, "mmap failed\n");
+        return -1;
+    }
+    umutex_init(&shared->mutex);
+    shared->counter = 0;
+
+    // 无竞争，不进入内核
+    uint64_t start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        umutex_lock(&shared->mutex);
+        umutex_unlock(&shared->mutex);
+    }
+    uint32_t us = elapsed_us(start);
+    printf("uncontended: %d lock/unlock in %d us\n", count, (int)us);
+
+    // 两个进程各自累加，结果应为两倍
+    start = read_tsc();
+    int pid = fork();
+    for (int i = 0; i < count; i++) {
+        umutex_lock(&shared->mutex);
+        shared->counter++;
+        umutex_unlock(&shared->mutex);
+    }
+    if (pid == 0) {
+        exit(0);
+    }
+
+    int status;
+    wait(&status);
+    us = elapsed_us(start);
+    printf("contended: 2 x %d lock/unlock in %d us, counter %d\n", count, (int)us, shared->counter);
+
+    int err = shared->counter == count * 2 ? 0 : -1;
+    munmap(shared, BENCH_SHM_SIZE);
+    return err;
+}
+
+/**
+ * 系统调用测试：分别用调用门和sysenter循环调用getpid系统调用，测量每次系统调用的耗时
+ */
+static int do_syscall (int argc, char ** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    if (count <= 0) {
+        fprintf(stderr, "invalid args\n");
+        return -1;
+    }
+
+    static const char * mode_name[] = {"call gate", "sysenter"};
+    for (int fast = 0; fast < 2; fast++) {
+        if (sys_call_use_fast(fast) != fast) {
+            printf("%s: not supported\n", mode_name[fast]);
+            continue;
+        }
+
+        uint64_t start = read_tsc();
+        for (int i = 0; i < count; i++) {
+            getpid_syscall();
+        }
+        uint32_t us = elapsed_us(start);
+        printf("%s: %d getpid in %d us, %d ns/call\n", mode_name[fast], count, (int)us,
+                (int)(us * 1000 / count));
+    }
+
+    sys_call_use_fast(1);
+    return 0;
+}
+
+/**
+ * @brief 生成拷贝测试用的文件名
+ */
+static void copy_name (char * buf, const char * prefix, int index) {
+    sprintf(buf, "%s%d.dat", prefix, index);
+}
+
+/**
+ * @brief 逐个系统调用拷贝文件
+ */
+static int copy_plain (int count, int size) {
+    char src[32], dst[32];
+
+    for (int i = 0; i < count; i++) {
+        copy_name(src, "src", i);
+        copy_name(dst, "dst", i);
+
+        int in = open(src, O_RDONLY);
+        int out = open(dst, O_CREAT | O_TRUNC | O_WRONLY);
+        if ((in < 0) || (out < 0)) {
+            return -1;
+        }
+
+        int len = read(in, bench_buf, size);
+        if ((len <= 0) || (write(out, bench_buf, len) != len)) {
+            return -1;
+        }
+        close(in);
+        close(out);
+    }
+    return 0;
+}
+
+/**
+ * @brief 用ioring批量拷贝文件，每个文件6个操作，后面的操作引用前面的文件和读取的字节数
+ */
+static int copy_ring (int count, int size) {
+    static ioring_t ring;
+    static char src[BENCH_RING_BATCH][32], dst[BENCH_RING_BATCH][32];
+
+    ioring_init(&ring);
+    for (int i = 0; i < count; i += BENCH_RING_BATCH) {
+        int batch = count - i < BENCH_RING_BATCH ? count - i : BENCH_RING_BATCH;
+        for (int j = 0; j < batch; j++) {
+            copy_name(src[j], "src", i + j);
+            copy_name(dst[j], "dst", i + j);
+
+            ioring_prep_open(ioring_get_sqe(&ring), src[j], O_RDONLY);
+            ioring_prep_open(ioring_get_sqe(&ring), dst[j], O_CREAT | O_TRUNC | O_WRONLY);
+
+            ioring_sqe_t * sqe = ioring_get_sqe(&ring);
+            ioring_prep_read(sqe, 2, bench_buf, size);
+            sqe->flags = IOSQE_FD_REF;
+
+            sqe = ioring_get_sqe(&ring);
+            ioring_prep_write(sqe, 2, bench_buf, 1);
+            sqe->flags = IOSQE_FD_REF | IOSQE_LEN_REF;
+
+            sqe = ioring_get_sqe(&ring);
+            ioring_prep_close(sqe, 4);
+            sqe->flags = IOSQE_FD_REF;
+
+            sqe = ioring_get_sqe(&ring);
+            ioring_prep_close(sqe, 4);
+            sqe->flags = IOSQE_FD_REF;
+        }
+
+        if (ioring_submit(&ring) != batch * 6) {
+            return -1;
+        }
+
+        ioring_cqe_t * cqe;
+        int err = 0;
+        while ((cqe = ioring_peek_cqe(&ring)) != (ioring_cqe_t *)0) {
+            if (cqe->res < 0) {
+                err = -1;
+            }
+            ioring_cqe_seen(&ring);
+        }
+        if (err < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * 批量提交测试：拷贝大量小文件，对比逐个系统调用和使用ioring一次提交一批操作
+ */
+static int do_ringcopy (int argc, char ** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 50;
+    int size = argc > 2 ? atoi(argv[2]) : 512;
+    if ((count <= 0) || (size <= 0) || (size > BENCH_BUF_SIZE)) {
+        fprintf(stderr, "invalid args\n");
+        return -1;
+    }
+
+    // 准备源文件
+    char name[32];
+    memset(bench_buf, 'r', size);
+    for (int i = 0; i < count; i++) {
+        copy_name(name, "src", i);
+        int fd = open(name, O_CREAT | O_TRUNC | O_WRONLY);
+        if ((fd < 0) || (write(fd, bench_buf, size) != size)) {
+            fprintf(stderr, "create %s failed\n", name);
+            return -1;
+        }
+        close(fd);
+    }
+
+    uint64_t start = read_tsc();
+    int err = copy_plain(count, size);
+    uint32_t us = elapsed_us(start);
+    printf("syscall: copy %d files of %d bytes in %d us%s\n", count, size, (int)us, err ? ", failed" : "");
+
+    if (err == 0) {
+        start = read_tsc();
+        err = copy_ring(count, size);
+        us = elapsed_us(start);
+        printf("ioring: copy %d files of %d bytes in %d us%s\n", count, size, (int)us, err ? ", failed" : "");
+    }
+
+    for (int i = 0; i < count; i++) {
+        copy_name(name, "src", i);
+        unlink(name);
+        copy_name(name, "dst", i);
+        unlink(name);
+    }
+    return err;
+}
+
+/**
+ * 映射数据页测试：对比通过系统调用和直接读取数据页取进程号的耗时，以及取时间的耗时
+ */
+static int do_vdso (int argc, char ** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    if (count <= 0) {
+        fprintf(stderr, "invalid args\n");
+        return -1;
+    }
+
+    uint64_t start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        getpid_syscall();
+    }
+    uint32_t us = elapsed_us(start);
+    printf("getpid syscall: %d calls in %d us, %d ns/call\n", count, (int)us, (int)(us * 1000 / count));
+
+    start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        getpid();
+    }
+    us = elapsed_us(start);
+    printf("getpid vdso: %d calls in %d us, %d ns/call\n", count, (int)us, (int)(us * 1000 / count));
+
+    struct timespec ts, last = {0, 0};
+    int backwards = 0;
+    start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        if ((ts.tv_sec < last.tv_sec) || ((ts.tv_sec == last.tv_sec) && (ts.tv_nsec < last.tv_nsec))) {
+            backwards++;
+        }
+        last = ts;
+    }
+    us = elapsed_us(start);
+    printf("clock_gettime vdso: %d calls in %d us, %d ns/call, %d backwards\n",
+            count, (int)us, (int)(us * 1000 / count), backwards);
+    printf("uptime: %d.%09d s, time(): %d\n", (int)ts.tv_sec, (int)ts.tv_nsec, (int)time(NULL));
+
+    return getpid() == getpid_syscall() ? 0 : -1;
+}
+
+/**
+ * 向量读写测试：分多次write写入与writev一次写入相同的小块；lseek+read与pread随机读取
+ */
+static int do_iov (int argc, char ** argv) {
+    const char * path = argc > 1 ? argv[1] : "bench.dat";
+    int count = argc > 2 ? atoi(argv[2]) : 256;
+    int chunk = argc > 3 ? atoi(argv[3]) : 64;
+    if ((count <= 0) || (chunk <= 0) || (chunk * FILE_IOV_MAX > BENCH_BUF_SIZE)) {
+        fprintf(stderr, "invalid args\n");
+        return -1;
+    }
+
+    int fd = open(path, O_CREAT | O_TRUNC | O_RDWR);
+    if (fd < 0) {
+        fprintf(stderr, "open %s failed\n", path);
+        return -1;
+    }
+
+    // 每FILE_IOV_MAX个小块，write要调用FILE_IOV_MAX次，writev只需一次
+    int rounds = count;
+    uint64_t start = read_tsc();
+    for (int i = 0; i < rounds; i++) {
+        for (int j = 0; j < FILE_IOV_MAX; j++) {
+            write(fd, bench_buf + j * chunk, chunk);
+        }
+    }
+    uint32_t us = elapsed_us(start);
+    printf("write: %d x %d chunks of %d bytes in %d us\n", rounds, FILE_IOV_MAX, chunk, (int)us);
+
+    struct iovec iov[FILE_IOV_MAX];
+    for (int j = 0; j < FILE_IOV_MAX; j++) {
+        iov[j].iov_base = bench_buf + j * chunk;
+        iov[j].iov_len = chunk;
+    }
+
+    lseek(fd, 0, SEEK_SET);
+    start = read_tsc();
+    for (int i = 0; i < rounds; i++) {
+        if (writev(fd, iov, FILE_IOV_MAX) != chunk * FILE_IOV_MAX) {
+            fprintf(stderr, "writev failed\n");
+            close(fd);
+            return -1;
+        }
+    }
+    us = elapsed_us(start);
+    printf("writev: %d x %d chunks of %d bytes in %d us\n", rounds, FILE_IOV_MAX, chunk, (int)us);
+
+    // 随机位置读取
+    int size = rounds * FILE_IOV_MAX * chunk;
+    srand(1);
+    start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        lseek(fd, (rand() % (size / chunk)) * chunk, SEEK_SET);
+        read(fd, bench_buf, chunk);
+    }
+    us = elapsed_us(start);
+    printf("lseek+read: %d reads in %d us\n", count, (int)us);
+
+    srand(1);
+    start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        if (pread(fd, bench_buf, chunk, (rand() % (size / chunk)) * chunk) != chunk) {
+            fprintf(stderr, "pread failed\n");
+            close(fd);
+            return -1;
+        }
+    }
+    us = elapsed_us(start);
+    printf("pread: %d reads in %d us\n", count, (int)us);
+
+    close(fd);
+    return 0;
+}
+
+/**
+ * 终端输出测试：逐行printf和整块write输出大量文本，最后显示各自的耗时
+ */
+static int do_tty (int argc, char ** argv) {
+    int lines = argc > 1 ? atoi(argv[1]) : 500;
+    if (lines <= 0) {
+        fprintf(stderr, "invalid args\n");
+        return -1;
+    }
+
+    // 每行79个字符加换行，不会自动折行
+    char line[80];
+    for (int i = 0; i < sizeof(line) - 1; i++) {
+        line[i] = 'a' + i % 26;
+    }
+    line[sizeof(line) - 1] = '\0';
+
+    uint64_t start = read_tsc();
+    for (int i = 0; i < lines; i++) {
+        printf("%s\n", line);
+    }
+    fflush(stdout);
+    uint32_t printf_us = elapsed_us(start);
+
+    int size = 0;
+    for (int i = 0; (i < lines) && (size + sizeof(line) <= BENCH_BUF_SIZE); i++, size += sizeof(line)) {
+        memcpy(bench_buf + size, line, sizeof(line) - 1);
+        bench_buf[size + sizeof(line) - 1] = '\n';
+    }
+
+    start = read_tsc();
+    write(1, bench_buf, size);
+    uint32_t write_us = elapsed_us(start);
+
+    printf("printf: %d lines in %d us\n", lines, (int)printf_us);
+    printf("write: %d bytes in %d us\n", size, (int)write_us);
+    return 0;
+}
+
+/**
+ * 终端超时读测试：非规范模式下VMIN为0，无输入时每次读取等待VTIME后返回，显示实际的等待时间
+ */
+static int do_vtime (int argc, char ** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 10;
+    int vtime = argc > 2 ? atoi(argv[2]) : 1;
+    if ((count <= 0) || (vtime <= 0) || (vtime > 255)) {
+        fprintf(stderr, "invalid args\n");
+        return -1;
+    }
+
+    struct termios old, raw;
+    if (tcgetattr(0, &old) < 0) {
+        fprintf(stderr, "stdin is not a tty\n");
+        return -1;
+    }
+    raw = old;
+    raw.c_lflag &= ~(ECHO | ICANON);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = vtime;
+    tcsetattr(0, TCSANOW, &raw);
+
+    int keys = 0;
+    uint64_t start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        char ch;
+        keys += read(0, &ch, 1);
+    }
+    uint32_t us = elapsed_us(start);
+    tcsetattr(0, TCSANOW, &old);
+
+    printf("vtime: %d reads with VTIME=%d in %d us, %d us each, %d keys\n",
+            count, vtime, (int)us, (int)(us / count), keys);
+    return 0;
+}
+
+/**
+ * poll测试：无数据时的超时精度，以及用poll等待管道数据的往返延迟
+ */
+static int do_poll (int argc, char ** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 1000;
+    int timeout = argc > 2 ? atoi(argv[2]) : 100;
+    if ((rounds <= 0) || (timeout <= 0)) {
+        fprintf(stderr, "invalid args\n");
+        return -1;
+    }
+
+    int req[2], ack[2];
+    if (pipe(req) < 0) {
+        fprintf(stderr, "create pipe failed\n");
+        return -1;
+    }
+    if (pipe(ack) < 0) {
+        fprintf(stderr, "create pipe failed\n");
+        close(req[0]);
+        close(req[1]);
+        return -1;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = ack[0];
+    pfd.events = POLLIN;
+
+    uint64_t start = read_tsc();
+    int ready = poll(&pfd, 1, timeout);
+    printf("timeout: poll(%d ms) returned %d after %d us\n", timeout, ready, (int)elapsed_us(start));
+
+    int pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "fork failed\n");
+        return -1;
+    } else if (pid == 0) {
+        // 子进程：收到一个字节就回一个字节，父进程关闭请求管道后退出
+        close(req[1]);
+        close(ack[0]);
+        char c;
+        while (read(req[0], &c, 1) == 1) {
+            write(ack[1], &c, 1);
+        }
+        exit(0);
+    }
+    close(req[0]);
+    close(ack[1]);
+
+    int err = 0;
+    start = read_tsc();
+    for (int i = 0; i < rounds; i++) {
+        char c = i;
+        write(req[1], &c, 1);
+        if ((poll(&pfd, 1, -1) != 1) || !(pfd.revents & POLLIN) || (read(ack[0], &c, 1) != 1)) {
+            fprintf(stderr, "poll failed at round %d\n", i);
+            err = -1;
+            break;
+        }
+    }
+    show_latency("poll", rounds, elapsed_us(start));
+
+    close(req[1]);
+    int status;
+    wait(&status);
+    close(ack[0]);
+    return err;
+}
+
+/**
+ * 线程测试：创建线程与fork的开销对比，以及两个线程在同一地址空间中竞争同一把锁
+ */
+static umutex_t thread_mutex = UMUTEX_INITIALIZER;
+static int thread_counter;
+
+static int thread_add (void * arg) {
+    int count = (int)arg;
+    for (int i = 0; i < count; i++) {
+        umutex_lock(&thread_mutex);
+        thread_counter++;
+        umutex_unlock(&thread_mutex);
+    }
+    return 0;
+}
+
+static int thread_nop (void * arg) {
+    return 0;
+}
+
+static int do_thread (int argc, char ** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 100;
+    if (count <= 0) {
+        fprintf(stderr, "invalid args\n");
+        return -1;
+    }
+
+    thread_t thread;
+    int status;
+
+    uint64_t start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        if (thread_create(&thread, thread_nop, (void *)0, 0) < 0) {
+            fprintf(stderr, "thread_create failed\n");
+            return -1;
+        }
+        thread_join(&thread, &status);
+    }
+    printf("thread: %d create/join in %d us\n", count, (int)elapsed_us(start));
+
+    start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        int pid = fork();
+        if (pid == 0) {
+            exit(0);
+        } else if (pid < 0) {
+            fprintf(stderr, "fork failed\n");
+            return -1;
+        }
+        wait(&status);
+    }
+    printf("fork: %d fork/wait in %d us\n", count, (int)elapsed_us(start));
+
+    // 计数在共享的地址空间中，无需共享内存
+    int adds = count * 1000;
+    thread_counter = 0;
+    start = read_tsc();
+    if (thread_create(&thread, thread_add, (void *)adds, 0) < 0) {
+        fprintf(stderr, "thread_create failed\n");
+        return -1;
+    }
+    thread_add((void *)adds);
+    thread_join(&thread, &status);
+    printf("contended: 2 x %d lock/unlock in %d us, counter %d\n",
+            adds, (int)elapsed_us(start), thread_counter);
+
+    return thread_counter == adds * 2 ? 0 : -1;
+}
+
+/**
+ * 内核日志测试：日志写入环形缓存的开销，以及从/dev/kmsg读出全部日志的时间
+ */
+static int do_klog (int argc, char ** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 1000;
+    if (count <= 0) {
+        fprintf(stderr, "invalid args\n");
+        return -1;
+    }
+
+    // 控制台输出由klogd在之后完成，这里只计入格式化和写缓存
+    uint64_t start = read_tsc();
+    for (int i = 0; i < count; i++) {
+        print_msg("bench klog %d", i);
+    }
+    uint32_t us = (uint32_t)elapsed_us(start);
+    printf("log: %d messages in %d us, %d.%d us each\n", count, (int)us,
+        (int)(us / count), (int)(us * 10 / count % 10));
+
+    int fd = open("/dev/kmsg", O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "open /dev/kmsg failed\n");
+        return -1;
+    }
+
+    int total = 0, size;
+    start = read_tsc();
+    while ((size = read(fd, bench_buf, BENCH_BUF_SIZE)) > 0) {
+        total += size;
+    }
+    printf("kmsg: read %d bytes in %d us\n", total, (int)elapsed_us(start));
+    close(fd);
+    return 0;
+}
+
+static const bench_t bench_list[] = {
+    {
+        .name = "append",
+        .useage = "append [file] [kb] [chunk] -- append kb KB to file in chunk bytes writes",
+        .do_func = do_append,
+    },
+    {
+        .name = "randread",
+        .useage = "randread [file] [count] [size] -- read size bytes at count random offsets",
+        .do_func = do_randread,
+    },
+    {
+        .name = "mmap",
+        .useage = "mmap [file] -- read whole file with read() and with mmap()",
+        .do_func = do_mmap,
+    },
+    {
+        .name = "malloc",
+        .useage = "malloc [count] -- alloc/free small and large blocks, show heap size",
+        .do_func = do_malloc,
+    },
+    {
+        .name = "pipe",
+        .useage = "pipe [mb] [chunk] -- push mb MB through a pipe in chunk bytes writes",
+        .do_func = do_pipe,
+    },
+    {
+        .name = "pingpong",
+        .useage = "pingpong [rounds] -- round trip latency of shm+semaphore vs pipes",
+        .do_func = do_pingpong,
+    },
+    {
+        .name = "futex",
+        .useage = "futex [count] -- user space mutex, uncontended and between two processes",
+        .do_func = do_futex,
+    },
+    {
+        .name = "syscall",
+        .useage = "syscall [count] -- getpid cost through the call gate and sysenter",
+        .do_func = do_syscall,
+    },
+    {
+        .name = "ringcopy",
+        .useage = "ringcopy [count] [size] -- copy count small files, one syscall per op vs ioring",
+        .do_func = do_ringcopy,
+    },
+    {
+        .name = "vdso",
+        .useage = "vdso [count] -- getpid by syscall vs mapped page, clock_gettime cost",
+        .do_func = do_vdso,
+    },
+    {
+        .name = "iov",
+        .useage = "iov [file] [count] [chunk] -- write vs writev of small chunks, lseek+read vs pread",
+        .do_func = do_iov,
+    },
+    {
+        .name = "tty",
+        .useage = "tty [lines] -- print lines with printf and in one write, show the time",
+        .do_func = do_tty,
+    },
+    {
+        .name = "vtime",
+        .useage = "vtime [count] [vtime] -- raw tty reads that time out after vtime/10 s",
+        .do_func = do_vtime,
+    },
+    {
+        .name = "poll",
+        .useage = "poll [rounds] [timeout] -- poll timeout accuracy, pipe round trips woken by poll",
+        .do_func = do_poll,
+    },
+    {
+        .name = "thread",
+        .useage = "thread [count] -- thread create/join vs fork/wait, two threads sharing a lock",
+        .do_func = do_thread,
+    },
+    {
+        .name = "klog",
+        .useage = "klog [count] -- cost of a kernel log message, read back through /dev/kmsg",
+        .do_func = do_klog,
+    },
+};
+
+int main (int argc, char ** argv) {
+    const bench_t * bench = (const bench_t *)0;
+
+    if (argc >= 2) {
+        for (int i = 0; i < sizeof(bench_list) / sizeof(bench_t); i++) {
+            if (strcmp(bench_list[i].name, argv[1]) == 0) {
+                bench = bench_list + i;
+                break;
+            }
+        }
+    }
+
+    // 未指定或找不到测试项，显示用法
+    if (bench == (const bench_t *)0) {
+        puts("Usage: bench test [args...]");
+        for (int i = 0; i < sizeof(bench_list) / sizeof(bench_t); i++) {
+            printf("  %s\n", bench_list[i].useage);
+        }
+        return -1;
+    }
+
+    tsc_calibrate();
+    return bench->do_func(argc - 1, argv + 1);
+}
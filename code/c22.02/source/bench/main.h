@@ -0,0 +1,24 @@
+/**
+ * 性能测试程序：测量文件系统、进程间通信等各部分的性能
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef MAIN_H
+#define MAIN_H
+
+#define BENCH_BUF_SIZE              (64*1024)       // 读写测试用的缓存大小
+#define BENCH_SHM_SIZE              4096            // 共享内存测试的大小
+#define BENCH_RING_BATCH            10              // 批量拷贝时每批的文件数
+
+/**
+ * 测试项列表
+ */
+typedef struct _bench_t {
+    const char * name;          // 测试名称
+    const char * useage;        // 使用方法
+    int(*do_func)(int argc, char **argv);       // 测试函数
+}bench_t;
+
+#endif
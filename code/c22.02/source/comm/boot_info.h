@@ -12,6 +12,14 @@
 
 #define BOOT_RAM_REGION_MAX			10		// RAM区最大数量
 
+// 图形模式：loader选择不超过下面分辨率的最大的32位线性帧缓存模式
+#define BOOT_FB_ENABLE				0		// 为1时尝试切换到VBE图形模式，失败时仍为文本模式
+#define BOOT_FB_WIDTH				1280	// 8x16字体下为160列
+#define BOOT_FB_HEIGHT				800		// 8x16字体下为50行
+#define BOOT_FB_BIOS_FONT			0		// 为1时从BIOS复制完整的256字符字体，否则只用内核自带的ASCII字体
+#define BOOT_FONT_HEIGHT			16		// 字体每个字符的行数，宽度固定为8
+#define BOOT_FONT_SIZE				(256 * BOOT_FONT_HEIGHT)
+
 /**
  * 启动信息参数
  */
@@ -22,6 +30,15 @@ typedef struct _boot_info_t {
         uint32_t size;
     }ram_region_cfg[BOOT_RAM_REGION_MAX];
     int ram_region_count;
+
+    // 图形模式信息，fb_addr为0表示仍为文本模式
+    uint32_t fb_addr;				// 线性帧缓存的物理地址
+    uint32_t fb_width, fb_height;	// 分辨率
+    uint32_t fb_pitch;				// 每行的字节数
+    uint32_t fb_bpp;				// 每像素的位数
+#if BOOT_FB_BIOS_FONT
+    uint8_t fb_font[BOOT_FONT_SIZE];	// 从BIOS中复制的8x16字体
+#endif
 }boot_info_t;
 
 #define SECTOR_SIZE		512			// 磁盘扇区大小
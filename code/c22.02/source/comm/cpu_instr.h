@@ -78,6 +78,10 @@ static inline uint32_t read_cr3() {
     return cr3;
 }
 
+static inline void invlpg(uint32_t vaddr) {
+    __asm__ __volatile__("invlpg (%[v])"::[v]"r"(vaddr):"memory");
+}
+
 static inline uint32_t read_cr4() {
     uint32_t cr4;
     __asm__ __volatile__("mov %%cr4, %[v]":[v]"=r"(cr4));
@@ -126,4 +130,18 @@ static inline void write_eflags (uint32_t eflags) {
     __asm__ __volatile__("pushl %%eax\n\tpopfl"::"a"(eflags));
 }
 
+static inline void write_msr (uint32_t msr, uint32_t value) {
+    __asm__ __volatile__("wrmsr"::"c"(msr), "a"(value), "d"(0));
+}
+
+static inline void write_msr64 (uint32_t msr, uint64_t value) {
+    __asm__ __volatile__("wrmsr"::"c"(msr), "A"(value));
+}
+
+static inline void cpuid (uint32_t leaf, uint32_t * eax, uint32_t * ebx, uint32_t * ecx, uint32_t * edx) {
+    __asm__ __volatile__("cpuid"
+            :"=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+            :"a"(leaf), "c"(0));
+}
+
 #endif
@@ -11,10 +11,22 @@
 #include "tools/klib.h"
 #include "cpu/mmu.h"
 #include "dev/console.h"
+#include "cpu/irq.h"
+#include "core/mmap.h"
+#include "core/task.h"
+#include "ipc/sem.h"
 
 static addr_alloc_t paddr_alloc;        // 物理地址分配结构
 static pde_t kernel_page_dir[PDE_CNT] __attribute__((aligned(MEM_PAGE_SIZE))); // 内核页目录表
 
+// 预先清0的页，由后台线程在空闲时补充，缺页时直接取用
+static struct {
+    uint32_t page_tbl[MEM_ZERO_POOL_NR];
+    int count;                          // 池中页的数量
+    int filling;                        // 后台线程是否正在补充
+    sem_t sem;                          // 唤醒后台线程
+}zero_pool;
+
 /**
  * @brief 获取当前页表地址
  */
@@ -32,6 +44,7 @@ static void addr_alloc_init (addr_alloc_t * alloc, uint8_t * bits,
     alloc->start = start;
     alloc->size = size;
     alloc->page_size = page_size;
+    alloc->ref_tbl = (uint16_t *)0;
     bitmap_init(&alloc->bitmap, bits, alloc->size / page_size, 0);
 }
 
@@ -46,6 +59,13 @@ static uint32_t addr_alloc_page (addr_alloc_t * alloc, int page_count) {
     int page_index = bitmap_alloc_nbits(&alloc->bitmap, 0, page_count);
     if (page_index >= 0) {
         addr = alloc->start + page_index * alloc->page_size;
+
+        // 新分配的页只有一个使用者
+        if (alloc->ref_tbl) {
+            for (int i = 0; i < page_count; i++) {
+                alloc->ref_tbl[page_index + i] = 1;
+            }
+        }
     }
 
     mutex_unlock(&alloc->mutex);
@@ -60,10 +80,46 @@ static void addr_free_page (addr_alloc_t * alloc, uint32_t addr, int page_count)
 
     uint32_t pg_idx = (addr - alloc->start) / alloc->page_size;
     bitmap_set_bit(&alloc->bitmap, pg_idx, page_count, 0);
+    if (alloc->ref_tbl) {
+        kernel_memset(alloc->ref_tbl + pg_idx, 0, page_count * sizeof(uint16_t));
+    }
 
     mutex_unlock(&alloc->mutex);
 }
 
+/**
+ * @brief 增加物理页的引用计数，用于多个地址空间共享同一页
+ */
+void memory_page_ref (uint32_t paddr) {
+    irq_state_t state = irq_enter_protection();
+    paddr_alloc.ref_tbl[(paddr - paddr_alloc.start) / MEM_PAGE_SIZE]++;
+    irq_leave_protection(state);
+}
+
+/**
+ * @brief 减少物理页的引用计数，没有使用者时释放
+ */
+void memory_page_unref (uint32_t paddr) {
+    irq_state_t state = irq_enter_protection();
+    uint16_t * ref = paddr_alloc.ref_tbl + (paddr - paddr_alloc.start) / MEM_PAGE_SIZE;
+    int free = (*ref <= 1);
+    if (!free) {
+        (*ref)--;
+    }
+    irq_leave_protection(state);
+
+    if (free) {
+        addr_free_page(&paddr_alloc, paddr, 1);
+    }
+}
+
+/**
+ * @brief 获取物理页的引用计数
+ */
+int memory_page_ref_count (uint32_t paddr) {
+    return paddr_alloc.ref_tbl[(paddr - paddr_alloc.start) / MEM_PAGE_SIZE];
+}
+
 static void show_mem_info (boot_info_t * boot_info) {
     log_printf("mem region:");
     for (int i = 0; i < boot_info->ram_region_count; i++) {
@@ -147,10 +203,27 @@ int memory_create_map (pde_t * page_dir, uint32_t vaddr, uint32_t paddr, int cou
     return 0;
 }
 
+/**
+ * @brief 取写合并内存类型对应的页表属性。将PAT的项1由WT改为WC，用PWT位选中该项；
+ * CPU不支持PAT时返回0，按MTRR的设置访问(帧缓存一般为不缓存)
+ */
+static uint32_t memory_wc_perm (void) {
+    uint32_t eax, ebx, ecx, edx;
+
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & (1 << 16))) {
+        return 0;
+    }
+
+    // 内核中没有其它页使用PWT位，修改后不影响已有的映射
+    write_msr64(MSR_IA32_PAT, (PAT_DEFAULT & ~(0xFFULL << 8)) | ((uint64_t)PAT_WC << 8));
+    return PTE_PWT;
+}
+
 /**
  * @brief 根据内存映射表，构造内核页表
  */
-void create_kernel_table (void) {
+void create_kernel_table (boot_info_t * boot_info) {
     extern uint8_t s_text[], e_text[], s_data[], e_data[];
     extern uint8_t kernel_base[];
 
@@ -181,6 +254,13 @@ void create_kernel_table (void) {
 
         memory_create_map(kernel_page_dir, vstart, (uint32_t)map->pstart, page_count, map->perm);
     }
+
+    // 图形模式下的帧缓存映射到内核空间固定位置，按写合并方式访问
+    if (boot_info->fb_addr) {
+        uint32_t size = boot_info->fb_pitch * boot_info->fb_height;
+        int page_count = up2(size, MEM_PAGE_SIZE) / MEM_PAGE_SIZE;
+        memory_create_map(kernel_page_dir, MEM_FB_START, boot_info->fb_addr, page_count, PTE_W | memory_wc_perm());
+    }
 }
 
 /**
@@ -226,7 +306,8 @@ void memory_destroy_uvm (uint32_t page_dir) {
                 continue;
             }
 
-            addr_free_page(&paddr_alloc, pte_paddr(pte), 1);
+            // 共享的页可能还有其它使用者
+            memory_page_unref(pte_paddr(pte));
         }
 
         addr_free_page(&paddr_alloc, (uint32_t)pde_paddr(pde), 1);
@@ -263,6 +344,17 @@ uint32_t memory_copy_uvm (uint32_t page_dir) {
                 continue;
             }
 
+            // 共享的页不复制，直接映射同一物理页
+            uint32_t vaddr = (i << 22) | (j << 12);
+            if (pte->v & PTE_SHARED) {
+                int err = memory_create_map((pde_t *)to_page_dir, vaddr, pte_paddr(pte), 1, get_pte_perm(pte));
+                if (err < 0) {
+                    goto copy_uvm_failed;
+                }
+                memory_page_ref(pte_paddr(pte));
+                continue;
+            }
+
             // 分配物理内存
             uint32_t page = addr_alloc_page(&paddr_alloc, 1);
             if (page == 0) {
@@ -270,7 +362,6 @@ uint32_t memory_copy_uvm (uint32_t page_dir) {
             }
 
             // 建立映射关系
-            uint32_t vaddr = (i << 22) | (j << 12);
             int err = memory_create_map((pde_t *)to_page_dir, vaddr, page, 1, get_pte_perm(pte));
             if (err < 0) {
                 goto copy_uvm_failed;
@@ -286,7 +377,7 @@ copy_uvm_failed:
     if (to_page_dir) {
         memory_destroy_uvm(to_page_dir);
     }
-    return -1;
+    return 0;
 }
 
 /**
@@ -388,16 +479,105 @@ void memory_free_page (uint32_t addr) {
     } else {
         // 进程空间，还要释放页表
         pte_t * pte = find_pte(current_page_dir(), addr, 0);
-        ASSERT((pte == (pte_t *)0) && pte->present);
+        ASSERT((pte != (pte_t *)0) && pte->present);
 
         // 释放内存页
-        addr_free_page(&paddr_alloc, pte_paddr(pte), 1);
+        memory_page_unref(pte_paddr(pte));
 
         // 释放页表
         pte->v = 0;
+        invlpg(addr);
     }
 }
 
+/**
+ * @brief 分配连续的多页内存
+ * 用于内核中较大的缓存，如位图等
+ */
+uint32_t memory_alloc_pages (int page_count) {
+    return addr_alloc_page(&paddr_alloc, page_count);
+}
+
+/**
+ * @brief 释放连续的多页内存
+ */
+void memory_free_pages (uint32_t addr, int page_count) {
+    addr_free_page(&paddr_alloc, addr, page_count);
+}
+
+/**
+ * @brief 分配一页清0的内存，优先从预先清0的页中取
+ */
+uint32_t memory_alloc_zero_page (void) {
+    uint32_t page = 0;
+
+    irq_state_t state = irq_enter_protection();
+    if (zero_pool.count > 0) {
+        page = zero_pool.page_tbl[--zero_pool.count];
+    }
+
+    // 剩余不多时，唤醒后台线程补充
+    int refill = (zero_pool.count < MEM_ZERO_POOL_LOW) && !zero_pool.filling;
+    if (refill) {
+        zero_pool.filling = 1;
+    }
+    irq_leave_protection(state);
+
+    if (refill) {
+        sem_notify(&zero_pool.sem);
+    }
+
+    if (page == 0) {
+        page = memory_alloc_page();
+        if (page) {
+            kernel_memset((void *)page, 0, MEM_PAGE_SIZE);
+        }
+    }
+    return page;
+}
+
+/**
+ * @brief 后台线程，将清0的页补充到池中
+ */
+static void zero_page_worker (void * arg) {
+    for (;;) {
+        sem_wait(&zero_pool.sem);
+
+        while (zero_pool.count < MEM_ZERO_POOL_NR) {
+            uint32_t page = memory_alloc_page();
+            if (page == 0) {
+                break;
+            }
+            kernel_memset((void *)page, 0, MEM_PAGE_SIZE);
+
+            irq_state_t state = irq_enter_protection();
+            int full = zero_pool.count >= MEM_ZERO_POOL_NR;
+            if (!full) {
+                zero_pool.page_tbl[zero_pool.count++] = page;
+            }
+            irq_leave_protection(state);
+
+            if (full) {
+                memory_free_page(page);
+            }
+        }
+
+        zero_pool.filling = 0;
+    }
+}
+
+/**
+ * @brief 启动内存管理的后台线程，需在任务管理初始化后调用
+ */
+void memory_worker_init (void) {
+    zero_pool.count = 0;
+    zero_pool.filling = 1;
+    sem_init(&zero_pool.sem, 1);        // 启动后先填满
+
+    task_t * task = kthread_create("zero page", zero_page_worker, (void *)0);
+    ASSERT(task != (task_t *)0);
+}
+
 /**
  * @brief 初始化内存管理系统
  * 该函数的主要任务：
@@ -428,57 +608,65 @@ void memory_init (boot_info_t * boot_info) {
     ASSERT(mem_free < (uint8_t *)MEM_EBDA_START);
 
     // 创建内核页表并切换过去
-    create_kernel_table();
+    create_kernel_table(boot_info);
 
     // 先切换到当前页表
     mmu_set_page_dir((uint32_t)kernel_page_dir);
+
+    // 各物理页的引用计数表较大，放在1MB以上。表所占的页不再释放
+    int ref_bytes = paddr_alloc.size / MEM_PAGE_SIZE * sizeof(uint16_t);
+    uint16_t * ref_tbl = (uint16_t *)addr_alloc_page(&paddr_alloc, up2(ref_bytes, MEM_PAGE_SIZE) / MEM_PAGE_SIZE);
+    ASSERT(ref_tbl != (uint16_t *)0);
+    kernel_memset(ref_tbl, 0, ref_bytes);
+    paddr_alloc.ref_tbl = ref_tbl;
 }
 
 /**
  * @brief 调整堆的内存分配，返回堆之前的指针
+ * 增长时只调整边界，页在首次访问时才分配；缩小时释放不再使用的页
  */
 char * sys_sbrk(int incr) {
-    task_t * task = task_current();
-    char * pre_heap_end = (char * )task->heap_end;
-    int pre_incr = incr;
+    task_mm_t * mm = task_current()->mm;
 
-    ASSERT(incr >= 0);
+    // 与其它线程的堆缺页处理互斥
+    mutex_lock(mm->mutex);
+    char * pre_heap_end = (char * )mm->heap_end;
 
     // 如果地址为0，则返回有效的heap区域的顶端
     if (incr == 0) {
-        log_printf("sbrk(0): end = 0x%x", pre_heap_end);
-        return pre_heap_end;
-    } 
-    
-    uint32_t start = task->heap_end;
-    uint32_t end = start + incr;
-
-    // 起始偏移非0
-    int start_offset = start % MEM_PAGE_SIZE;
-    if (start_offset) {
-        // 不超过1页，只调整
-        if (start_offset + incr <= MEM_PAGE_SIZE) {
-            task->heap_end = end;
-            return pre_heap_end;
-        } else {
-            // 超过1页，先只调本页的
-            uint32_t curr_size = MEM_PAGE_SIZE - start_offset;
-            start += curr_size;
-            incr -= curr_size;
-        }
+        goto sys_sbrk_end;
     }
 
-    // 处理其余的，起始对齐的页边界的
-    if (incr) {
-        uint32_t curr_size = end - start;
-        int err = memory_alloc_page_for(start, curr_size, PTE_P | PTE_U | PTE_W);
-        if (err < 0) {
-            log_printf("sbrk: alloc mem failed.");
-            return (char *)-1;
+    uint32_t end = mm->heap_end + incr;
+    if (incr > 0) {
+        // 不能进入映射区
+        if ((end < mm->heap_end) || (end > MMAP_START)) {
+            log_printf("sbrk: out of heap space.");
+            pre_heap_end = (char *)-1;
+            goto sys_sbrk_end;
+        }
+    } else {
+        if ((end > mm->heap_end) || (end < mm->heap_start)) {
+            log_printf("sbrk: below heap start.");
+            pre_heap_end = (char *)-1;
+            goto sys_sbrk_end;
+        }
+
+        // 释放完全不再使用的页，包含heap_start的页由程序加载时分配，保留
+        uint32_t start = up2(end, MEM_PAGE_SIZE);
+        if (start < up2(mm->heap_start, MEM_PAGE_SIZE)) {
+            start = up2(mm->heap_start, MEM_PAGE_SIZE);
+        }
+        for (uint32_t addr = start; addr < mm->heap_end; addr += MEM_PAGE_SIZE) {
+            pte_t * pte = find_pte(current_page_dir(), addr, 0);
+            if (pte && pte->present) {
+                memory_free_page(addr);
+            }
         }
     }
 
-    //log_printf("sbrk(%d): end = 0x%x", pre_incr, end);
-    task->heap_end = end;
-    return (char * )pre_heap_end;        
+    mm->heap_end = end;
+sys_sbrk_end:
+    mutex_unlock(mm->mutex);
+    return pre_heap_end;
 }
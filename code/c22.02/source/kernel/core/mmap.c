@@ -0,0 +1,512 @@
+/**
+ * 内存映射
+ * 文件或匿名内存映射到进程的MMAP_START~MMAP_END区域中，映射时只记录区域，
+ * 访问时在缺页异常中再从页缓存中取页，或分配清0的页，建立映射
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "core/mmap.h"
+#include "core/task.h"
+#include "core/memory.h"
+#include "cpu/mmu.h"
+#include "cpu/irq.h"
+#include "fs/fs.h"
+#include "fs/pcache.h"
+#include "fs/shmfs/shmfs.h"
+#include "tools/klib.h"
+#include "tools/log.h"
+#include "ipc/mutex.h"
+
+static vma_t * vma_tbl;                 // 映射区域表，从物理页中分配
+static list_t vma_free_list;            // 空闲的映射区域
+static mutex_t vma_mutex;               // 分配映射区域的互斥信号量
+
+/**
+ * @brief 分配一个映射区域结构
+ */
+static vma_t * vma_alloc (void) {
+    vma_t * vma = (vma_t *)0;
+
+    mutex_lock(&vma_mutex);
+    list_node_t * node = list_remove_first(&vma_free_list);
+    if (node) {
+        vma = list_node_parent(node, vma_t, node);
+        kernel_memset(vma, 0, sizeof(vma_t));
+    }
+    mutex_unlock(&vma_mutex);
+    return vma;
+}
+
+/**
+ * @brief 释放映射区域结构，同时释放对文件的引用
+ */
+static void vma_free (vma_t * vma) {
+    if (vma->file) {
+        fs_close_file(vma->file);
+    }
+
+    mutex_lock(&vma_mutex);
+    list_insert_first(&vma_free_list, &vma->node);
+    mutex_unlock(&vma_mutex);
+}
+
+/**
+ * @brief 查找地址所在的映射区域
+ */
+static vma_t * vma_find (task_t * task, uint32_t addr) {
+    for (list_node_t * node = list_first(&task->mm->vma_list); node; node = list_node_next(node)) {
+        vma_t * vma = list_node_parent(node, vma_t, node);
+        if ((addr >= vma->start) && (addr < vma->end)) {
+            return vma;
+        }
+    }
+
+    return (vma_t *)0;
+}
+
+/**
+ * @brief 检查区域是否与已有的映射区域重叠
+ */
+static int vma_overlap (task_t * task, uint32_t start, uint32_t end) {
+    for (list_node_t * node = list_first(&task->mm->vma_list); node; node = list_node_next(node)) {
+        vma_t * vma = list_node_parent(node, vma_t, node);
+        if ((start < vma->end) && (end > vma->start)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 在映射区中找一块足够大的空闲地址
+ */
+static uint32_t vma_find_space (task_t * task, uint32_t size) {
+    uint32_t start = MMAP_START;
+
+    // 各区域按地址排列，依次检查区域之间的空隙
+    for (list_node_t * node = list_first(&task->mm->vma_list); node; node = list_node_next(node)) {
+        vma_t * vma = list_node_parent(node, vma_t, node);
+        if (vma->start - start >= size) {
+            break;
+        }
+        start = vma->end;
+    }
+
+    return (MMAP_END - start >= size) ? start : 0;
+}
+
+/**
+ * @brief 将区域按地址顺序插入到进程的映射区列表中
+ */
+static void vma_insert (task_t * task, vma_t * vma) {
+    list_t * list = &task->mm->vma_list;
+
+    // 找到第一个在其后的区域，插在它的前面
+    list_node_t * next = list_first(list);
+    while (next && (list_node_parent(next, vma_t, node)->start < vma->start)) {
+        next = list_node_next(next);
+    }
+
+    if (!next) {
+        list_insert_last(list, &vma->node);
+    } else if (next == list_first(list)) {
+        list_insert_first(list, &vma->node);
+    } else {
+        list_node_t * pre = list_node_pre(next);
+        vma->node.pre = pre;
+        vma->node.next = next;
+        pre->next = &vma->node;
+        next->pre = &vma->node;
+        list->count++;
+    }
+}
+
+/**
+ * @brief 分配一页清0的内存，映射到指定地址
+ */
+static int map_zero_page (task_t * task, uint32_t vaddr, uint32_t perm) {
+    uint32_t paddr = memory_alloc_zero_page();
+    if (paddr == 0) {
+        log_printf("no memory for page 0x%x.", vaddr);
+        return -1;
+    }
+
+    int err = memory_create_map((pde_t *)task->tss.cr3, vaddr, paddr, 1, perm);
+    if (err < 0) {
+        memory_free_page(paddr);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 为映射区域中的一页建立映射
+ * 文件映射中，只读的直接使用页缓存中的页；可写的私有映射，复制一份
+ * 私有的匿名映射使用清0的页
+ * 共享内存直接使用段中的页，各进程映射的是同一页。共享的匿名映射也由无名段提供页
+ */
+static int vma_map_page (task_t * task, vma_t * vma, uint32_t vaddr) {
+    if (!vma->file) {
+        uint32_t perm = PTE_P | PTE_U;
+        perm |= (vma->prot & PROT_WRITE) ? PTE_W : 0;
+        return map_zero_page(task, vaddr, perm);
+    }
+
+    uint32_t index = (vma->offset + vaddr - vma->start) / MEM_PAGE_SIZE;
+    if (vma->file->type == FILE_SHM) {
+        uint32_t paddr = shmfs_get_page(vma->file, index);
+        if (paddr == 0) {
+            return -1;
+        }
+
+        uint32_t perm = PTE_P | PTE_U | PTE_SHARED;
+        perm |= (vma->prot & PROT_WRITE) ? PTE_W : 0;
+        int err = memory_create_map((pde_t *)task->tss.cr3, vaddr, paddr, 1, perm);
+        if (err < 0) {
+            memory_page_unref(paddr);
+            return -1;
+        }
+        return 0;
+    }
+
+    uint32_t paddr = pcache_get(vma->file, index);
+    if (paddr == 0) {
+        return -1;
+    }
+
+    uint32_t perm = PTE_P | PTE_U;
+    if (vma->prot & PROT_WRITE) {
+        uint32_t page = memory_alloc_page();
+        if (page == 0) {
+            memory_page_unref(paddr);
+            return -1;
+        }
+
+        kernel_memcpy((void *)page, (void *)paddr, MEM_PAGE_SIZE);
+        memory_page_unref(paddr);
+        paddr = page;
+        perm |= PTE_W;
+    } else {
+        perm |= PTE_SHARED;
+    }
+
+    int err = memory_create_map((pde_t *)task->tss.cr3, vaddr, paddr, 1, perm);
+    if (err < 0) {
+        memory_page_unref(paddr);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 解除当前进程中一段地址的映射，释放对物理页的引用
+ */
+static void vma_unmap_pages (task_t * task, uint32_t start, uint32_t end) {
+    for (uint32_t vaddr = start; vaddr < end; vaddr += MEM_PAGE_SIZE) {
+        pte_t * pte = find_pte((pde_t *)task->tss.cr3, vaddr, 0);
+        if (!pte || !pte->present) {
+            continue;
+        }
+
+        memory_page_unref(pte_paddr(pte));
+        pte->v = 0;
+        invlpg(vaddr);
+    }
+}
+
+/**
+ * @brief 初始化映射区域表
+ */
+void mmap_init (void) {
+    int page_count = up2(MMAP_VMA_NR * sizeof(vma_t), MEM_PAGE_SIZE) / MEM_PAGE_SIZE;
+
+    mutex_init(&vma_mutex);
+    list_init(&vma_free_list);
+
+    vma_tbl = (vma_t *)memory_alloc_pages(page_count);
+    ASSERT(vma_tbl != (vma_t *)0);
+    for (int i = 0; i < MMAP_VMA_NR; i++) {
+        list_insert_last(&vma_free_list, &vma_tbl[i].node);
+    }
+}
+
+/**
+ * @brief 处理映射区和堆中的缺页异常，成功处理返回0
+ */
+int mmap_fault (uint32_t addr, int error_code) {
+    task_t * task = task_current();
+    if (error_code & ERR_PAGE_P) {
+        return -1;
+    }
+
+    int err = -1;
+    uint32_t vaddr = down2(addr, MEM_PAGE_SIZE);
+    mutex_lock(task->mm->mutex);
+
+    // 堆空间在sbrk时只调整边界，访问时才分配
+    vma_t * vma = (vma_t *)0;
+    if ((addr < down2(task->mm->heap_start, MEM_PAGE_SIZE)) || (addr >= task->mm->heap_end)) {
+        // 访问权限不符的，不处理
+        vma = vma_find(task, addr);
+        if (!vma || (vma->prot == PROT_NONE)) {
+            goto mmap_fault_end;
+        }
+
+        if ((error_code & ERR_PAGE_WR) && !(vma->prot & PROT_WRITE)) {
+            goto mmap_fault_end;
+        }
+    }
+
+    // 同一地址空间的其它线程可能已经处理了该页
+    pte_t * pte = find_pte((pde_t *)task->tss.cr3, vaddr, 0);
+    if (pte && pte->present) {
+        err = 0;
+    } else if (vma) {
+        err = vma_map_page(task, vma, vaddr);
+    } else {
+        err = map_zero_page(task, vaddr, PTE_P | PTE_U | PTE_W);
+    }
+mmap_fault_end:
+    mutex_unlock(task->mm->mutex);
+    return err;
+}
+
+/**
+ * @brief 预先建立一段地址中映射区及堆的页，供内核直接访问
+ * 内核写只读映射时不会触发异常，所以需写入时，检查区域是否可写。
+ * 访问文件时持有文件系统的锁，此时缺页会反过来获取mm的锁，与映射文件缺页的顺序相反，所以都要预先建立
+ */
+int mmap_prefault (uint32_t addr, uint32_t size, int write) {
+    task_t * task = task_current();
+    if (size == 0) {
+        return 0;
+    }
+
+    int err = 0;
+    mutex_lock(task->mm->mutex);
+    uint32_t heap_start = down2(task->mm->heap_start, MEM_PAGE_SIZE);
+    for (uint32_t vaddr = down2(addr, MEM_PAGE_SIZE); vaddr < addr + size; vaddr += MEM_PAGE_SIZE) {
+        // 堆中的页总是可写的
+        vma_t * vma = (vma_t *)0;
+        if ((vaddr < heap_start) || (vaddr >= task->mm->heap_end)) {
+            vma = vma_find(task, vaddr);
+            if (!vma) {
+                continue;
+            }
+
+            if (write && !(vma->prot & PROT_WRITE)) {
+                err = -1;
+                break;
+            }
+        }
+
+        pte_t * pte = find_pte((pde_t *)task->tss.cr3, vaddr, 0);
+        if (pte && pte->present) {
+            continue;
+        }
+
+        err = vma ? vma_map_page(task, vma, vaddr) : map_zero_page(task, vaddr, PTE_P | PTE_U | PTE_W);
+        if (err < 0) {
+            break;
+        }
+    }
+    mutex_unlock(task->mm->mutex);
+    return err;
+}
+
+/**
+ * @brief fork时复制映射区域。页面本身已在复制页表时处理
+ */
+int mmap_copy (task_mm_t * to, task_mm_t * from) {
+    mutex_lock(from->mutex);
+    for (list_node_t * node = list_first(&from->vma_list); node; node = list_node_next(node)) {
+        vma_t * vma = list_node_parent(node, vma_t, node);
+
+        vma_t * copy = vma_alloc();
+        if (!copy) {
+            log_printf("mmap: no free vma.");
+            mutex_unlock(from->mutex);
+            return -1;
+        }
+
+        copy->start = vma->start;
+        copy->end = vma->end;
+        copy->prot = vma->prot;
+        copy->flags = vma->flags;
+        copy->offset = vma->offset;
+        copy->file = vma->file;
+        if (copy->file) {
+            file_inc_ref(copy->file);
+        }
+        list_insert_last(&to->vma_list, &copy->node);
+    }
+    mutex_unlock(from->mutex);
+
+    return 0;
+}
+
+/**
+ * @brief 释放地址空间中所有的映射区域。页面由销毁页表时释放
+ */
+void mmap_destroy (task_mm_t * mm) {
+    mutex_lock(mm->mutex);
+    list_node_t * node;
+    while ((node = list_remove_first(&mm->vma_list)) != (list_node_t *)0) {
+        vma_free(list_node_parent(node, vma_t, node));
+    }
+    mutex_unlock(mm->mutex);
+}
+
+/**
+ * @brief 将文件或匿名内存映射到进程空间，返回映射的起始地址
+ */
+void * sys_mmap (mmap_args_t * args) {
+    task_t * task = task_current();
+
+    uint32_t size = up2(args->length, MEM_PAGE_SIZE);
+    if ((size == 0) || (args->offset % MEM_PAGE_SIZE)) {
+        return MAP_FAILED;
+    }
+
+    // 必须是共享或私有中的一种
+    int share = args->flags & (MAP_SHARED | MAP_PRIVATE);
+    if ((share != MAP_SHARED) && (share != MAP_PRIVATE)) {
+        return MAP_FAILED;
+    }
+
+    // 文件映射只支持普通文件和共享内存，共享内存只能共享映射
+    file_t * file = (file_t *)0;
+    if (!(args->flags & MAP_ANONYMOUS)) {
+        file = task_file(args->fd);
+        if (!file || ((file->type != FILE_NORMAL) && (file->type != FILE_SHM))) {
+            return MAP_FAILED;
+        }
+
+        if ((file->type == FILE_SHM) && (share != MAP_SHARED)) {
+            return MAP_FAILED;
+        }
+    }
+
+    // 页缓存中的页不会写回文件，所以不支持可写的共享文件映射
+    if (file && (file->type == FILE_NORMAL) && (share == MAP_SHARED) && (args->prot & PROT_WRITE)) {
+        log_printf("mmap: writable shared mapping not supported.");
+        return MAP_FAILED;
+    }
+
+    // 共享的匿名映射由无名的共享内存段提供页，fork前后首次访问的页各进程都是同一页
+    file_t * anon = (file_t *)0;
+    if ((args->flags & MAP_ANONYMOUS) && (share == MAP_SHARED)) {
+        anon = fs_shm_anon(size);
+        if (!anon) {
+            log_printf("mmap: no shared memory for anonymous mapping.");
+            return MAP_FAILED;
+        }
+        file = anon;
+    }
+
+    // 确定映射的地址
+    void * ret = MAP_FAILED;
+    mutex_lock(task->mm->mutex);
+    uint32_t start = (uint32_t)args->addr;
+    if (args->flags & MAP_FIXED) {
+        if ((start % MEM_PAGE_SIZE) || (start < MMAP_START) || (start + size > MMAP_END)
+                || (start + size < start) || vma_overlap(task, start, start + size)) {
+            goto sys_mmap_end;
+        }
+    } else if ((start = vma_find_space(task, size)) == 0) {
+        log_printf("mmap: no space.");
+        goto sys_mmap_end;
+    }
+
+    vma_t * vma = vma_alloc();
+    if (!vma) {
+        log_printf("mmap: no free vma.");
+        goto sys_mmap_end;
+    }
+
+    vma->start = start;
+    vma->end = start + size;
+    vma->prot = args->prot;
+    vma->flags = args->flags;
+    vma->offset = (file && !anon) ? args->offset : 0;
+    vma->file = file;
+    if (file) {
+        file_inc_ref(file);
+    }
+    vma_insert(task, vma);
+    ret = (void *)start;
+sys_mmap_end:
+    mutex_unlock(task->mm->mutex);
+
+    // 无名段此后只由映射区域持有，映射失败时在此释放
+    if (anon) {
+        fs_close_file(anon);
+    }
+    return ret;
+}
+
+/**
+ * @brief 解除映射，可以只解除区域中的一部分
+ */
+int sys_munmap (void * addr, uint32_t length) {
+    task_t * task = task_current();
+    uint32_t start = (uint32_t)addr;
+    uint32_t end = start + up2(length, MEM_PAGE_SIZE);
+
+    if ((start % MEM_PAGE_SIZE) || (end <= start)) {
+        return -1;
+    }
+
+    int err = 0;
+    mutex_lock(task->mm->mutex);
+    list_node_t * node = list_first(&task->mm->vma_list);
+    while (node) {
+        vma_t * vma = list_node_parent(node, vma_t, node);
+        node = list_node_next(node);
+
+        // 计算重叠的部分
+        uint32_t s = start > vma->start ? start : vma->start;
+        uint32_t e = end < vma->end ? end : vma->end;
+        if (s >= e) {
+            continue;
+        }
+
+        vma_unmap_pages(task, s, e);
+        if ((s == vma->start) && (e == vma->end)) {
+            // 整个区域
+            list_remove(&task->mm->vma_list, &vma->node);
+            vma_free(vma);
+        } else if (s == vma->start) {
+            // 开头的一部分
+            vma->offset += e - vma->start;
+            vma->start = e;
+        } else if (e == vma->end) {
+            // 结尾的一部分
+            vma->end = s;
+        } else {
+            // 中间的一部分，分成前后两个区域
+            vma_t * tail = vma_alloc();
+            if (!tail) {
+                log_printf("mmap: no free vma.");
+                err = -1;
+                break;
+            }
+
+            kernel_memcpy(tail, vma, sizeof(vma_t));
+            tail->start = e;
+            tail->offset = vma->offset + (e - vma->start);
+            if (tail->file) {
+                file_inc_ref(tail->file);
+            }
+            vma->end = s;
+            vma_insert(task, tail);
+        }
+    }
+
+    mutex_unlock(task->mm->mutex);
+
+    return err;
+}
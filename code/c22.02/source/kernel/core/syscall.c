@@ -11,6 +11,11 @@
 #include "tools/log.h"
 #include "core/memory.h"
 #include "fs/fs.h"
+#include "core/mmap.h"
+#include "ipc/sem.h"
+#include "ipc/futex.h"
+#include "fs/ioring.h"
+#include "fs/poll.h"
 
 // 系统调用处理函数类型
 typedef int (*syscall_handler_t)(uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3);
@@ -46,6 +51,25 @@ static const syscall_handler_t sys_table[] = {
 	[SYS_readdir] = (syscall_handler_t)sys_readdir,
 	[SYS_closedir] = (syscall_handler_t)sys_closedir,
 	[SYS_unlink] = (syscall_handler_t)sys_unlink,
+	[SYS_chdir] = (syscall_handler_t)sys_chdir,
+	[SYS_getcwd] = (syscall_handler_t)sys_getcwd,
+	[SYS_mmap] = (syscall_handler_t)sys_mmap,
+	[SYS_munmap] = (syscall_handler_t)sys_munmap,
+	[SYS_pipe] = (syscall_handler_t)sys_pipe,
+	[SYS_dup2] = (syscall_handler_t)sys_dup2,
+	[SYS_shm_open] = (syscall_handler_t)sys_shm_open,
+	[SYS_ksem_open] = (syscall_handler_t)sys_ksem_open,
+	[SYS_ksem_wait] = (syscall_handler_t)sys_ksem_wait,
+	[SYS_ksem_post] = (syscall_handler_t)sys_ksem_post,
+	[SYS_ksem_close] = (syscall_handler_t)sys_ksem_close,
+	[SYS_futex] = (syscall_handler_t)sys_futex,
+	[SYS_clone] = (syscall_handler_t)sys_clone,
+	[SYS_ioring_enter] = (syscall_handler_t)sys_ioring_enter,
+	[SYS_readv] = (syscall_handler_t)sys_readv,
+	[SYS_writev] = (syscall_handler_t)sys_writev,
+	[SYS_pread] = (syscall_handler_t)sys_pread,
+	[SYS_pwrite] = (syscall_handler_t)sys_pwrite,
+	[SYS_poll] = (syscall_handler_t)sys_poll,
 };
 
 /**
@@ -17,11 +17,20 @@
 #include "core/syscall.h"
 #include "comm/elf.h"
 #include "fs/fs.h"
+#include "core/mmap.h"
+#include "ipc/mutex.h"
+#include "core/vdso.h"
 
 static task_manager_t task_manager;     // 任务管理器
 static uint32_t idle_task_stack[IDLE_STACK_SIZE];	// 空闲任务堆栈
 static task_t task_table[TASK_NR];      // 用户进程表
 static mutex_t task_table_mutex;        // 进程表互斥访问锁
+static task_mm_t mm_table[TASK_NR + 1];         // 地址空间表，含初始任务
+static mutex_t mm_mutex_table[TASK_NR + 1];     // 各地址空间的锁
+static task_files_t files_table[TASK_NR + 1];   // 文件表，含初始任务
+static task_mm_t kernel_mm;             // 内核线程共用的地址空间
+static mutex_t kernel_mm_mutex;
+static task_files_t kernel_files;       // 内核线程共用的文件表
 
 static int tss_init (task_t * task, int flag, uint32_t entry, uint32_t esp) {
     // 为TSS分配GDT
@@ -65,13 +74,6 @@ static int tss_init (task_t * task, int flag, uint32_t entry, uint32_t esp) {
     task->tss.cs = code_sel; 
     task->tss.iomap = 0;
 
-    // 页表初始化
-    uint32_t page_dir = memory_create_uvm();
-    if (page_dir == 0) {
-        goto tss_init_failed;
-    }
-    task->tss.cr3 = page_dir;
-
     task->tss_sel = tss_sel;
     return 0;
 tss_init_failed:
@@ -83,8 +85,123 @@ tss_init_failed:
     return -1;
 }
 
+/**
+ * @brief 分配地址空间，使用页目录page_dir
+ */
+static task_mm_t * mm_alloc (uint32_t page_dir) {
+    task_mm_t * mm = (task_mm_t *)0;
+
+    mutex_lock(&task_table_mutex);
+    for (int i = 0; i < TASK_NR + 1; i++) {
+        if (mm_table[i].ref == 0) {
+            mm = mm_table + i;
+            kernel_memset(mm, 0, sizeof(task_mm_t));
+            mm->ref = 1;
+            mm->page_dir = page_dir;
+            list_init(&mm->vma_list);
+            mm->mutex = mm_mutex_table + i;
+            mutex_init(mm->mutex);
+            break;
+        }
+    }
+    mutex_unlock(&task_table_mutex);
+
+    return mm;
+}
+
+/**
+ * @brief 增加地址空间的引用
+ */
+static task_mm_t * mm_get (task_mm_t * mm) {
+    mutex_lock(&task_table_mutex);
+    mm->ref++;
+    mutex_unlock(&task_table_mutex);
+    return mm;
+}
+
+/**
+ * @brief 释放对地址空间的引用，最后一个引用释放时销毁页表。页表不能正在使用
+ */
+static void mm_put (task_mm_t * mm) {
+    mutex_lock(&task_table_mutex);
+    int ref = --mm->ref;
+    mutex_unlock(&task_table_mutex);
+
+    if (ref == 0) {
+        mmap_destroy(mm);
+        memory_destroy_uvm(mm->page_dir);
+    }
+}
+
+/**
+ * @brief 分配空的文件表
+ */
+static task_files_t * files_alloc (void) {
+    task_files_t * files = (task_files_t *)0;
+
+    mutex_lock(&task_table_mutex);
+    for (int i = 0; i < TASK_NR + 1; i++) {
+        if (files_table[i].ref == 0) {
+            files = files_table + i;
+            kernel_memset(files, 0, sizeof(task_files_t));
+            files->ref = 1;
+            kernel_strncpy(files->cwd, "/", sizeof(files->cwd));
+            break;
+        }
+    }
+    mutex_unlock(&task_table_mutex);
+
+    return files;
+}
+
+/**
+ * @brief 增加文件表的引用
+ */
+static task_files_t * files_get (task_files_t * files) {
+    mutex_lock(&task_table_mutex);
+    files->ref++;
+    mutex_unlock(&task_table_mutex);
+    return files;
+}
+
+/**
+ * @brief 释放对文件表的引用，最后一个引用释放时关闭所有文件
+ */
+static void files_put (task_files_t * files) {
+    mutex_lock(&task_table_mutex);
+    int ref = --files->ref;
+    mutex_unlock(&task_table_mutex);
+
+    if (ref == 0) {
+        for (int fd = 0; fd < TASK_OFILE_NR; fd++) {
+            file_t * file = files->file_table[fd];
+            if (file) {
+                fs_close_file(file);
+                files->file_table[fd] = (file_t *)0;
+            }
+        }
+
+        // 关闭仍打开的有名信号量
+        for (int id = 0; id < KSEM_NR; id++) {
+            if (files->ksem_ref[id]) {
+                ksem_ref_add(id, -files->ksem_ref[id]);
+                files->ksem_ref[id] = 0;
+            }
+        }
+    }
+}
+
+/**
+ * @brief 设置任务使用的地址空间
+ */
+static void task_set_mm (task_t * task, task_mm_t * mm) {
+    task->mm = mm;
+    task->tss.cr3 = mm->page_dir;
+}
+
 /**
  * @brief 初始化任务
+ * 系统任务共用内核的地址空间和文件表，其它任务的由调用者设置
  */
 int task_init (task_t *task, const char * name, int flag, uint32_t entry, uint32_t esp) {
     ASSERT(task != (task_t *)0);
@@ -99,17 +216,21 @@ int task_init (task_t *task, const char * name, int flag, uint32_t entry, uint32
     kernel_strncpy(task->name, name, TASK_NAME_SIZE);
     task->state = TASK_CREATED;
     task->sleep_ticks = 0;
+    task->wait_list = (list_t *)0;
     task->time_slice = TASK_TIME_SLICE_DEFAULT;
     task->slice_ticks = task->time_slice;
     task->parent = (task_t *)0;
-    task->heap_start = 0;
-    task->heap_end = 0;
     list_node_init(&task->all_node);
     list_node_init(&task->run_node);
     list_node_init(&task->wait_node);
 
-    // 文件相关
-    kernel_memset(task->file_table, 0, sizeof(task->file_table));
+    if (flag & TASK_FLAG_SYSTEM) {
+        task_set_mm(task, mm_get(&kernel_mm));
+        task->files = files_get(&kernel_files);
+    } else {
+        task->mm = (task_mm_t *)0;
+        task->files = (task_files_t *)0;
+    }
 
     // 插入就绪队列中和所有的任务队列中
     irq_state_t state = irq_enter_protection();
@@ -140,8 +261,12 @@ void task_uninit (task_t * task) {
         memory_free_page(task->tss.esp0 - MEM_PAGE_SIZE);
     }
 
-    if (task->tss.cr3) {
-        memory_destroy_uvm(task->tss.cr3);
+    if (task->files) {
+        files_put(task->files);
+    }
+
+    if (task->mm) {
+        mm_put(task->mm);
     }
 
     kernel_memset(task, 0, sizeof(task_t));
@@ -153,6 +278,7 @@ void simple_switch (uint32_t ** from, uint32_t * to);
  * @brief 切换至指定任务
  */
 void task_switch_from_to (task_t * from, task_t * to) {
+     cpu_set_sysenter_stack(to->tss.esp0);
      switch_to_tss(to->tss_sel);
     //simple_switch(&from->stack, to->stack);
 }
@@ -181,10 +307,15 @@ void task_first_init (void) {
 
     // 第一个任务代码量小一些，好和栈放在1个页面呢
     // 这样就不要立即考虑还要给栈分配空间的问题
-    task_init(&task_manager.first_task, "first task", 0, first_start, first_start + alloc_size);
-    task_manager.first_task.heap_start = (uint32_t)e_first_task;  // 这里不对
-    task_manager.first_task.heap_end = task_manager.first_task.heap_start;
-    task_manager.curr_task = &task_manager.first_task;
+    task_t * task = &task_manager.first_task;
+    task_init(task, "first task", 0, first_start, first_start + alloc_size);
+    task_set_mm(task, mm_alloc(memory_create_uvm()));
+    task->files = files_alloc();
+    ASSERT((task->mm != (task_mm_t *)0) && (task->mm->page_dir != 0) && (task->files != (task_files_t *)0));
+
+    task->mm->heap_start = (uint32_t)e_first_task;  // 这里不对
+    task->mm->heap_end = task->mm->heap_start;
+    task_manager.curr_task = task;
 
     // 更新页表地址为自己的
     mmu_set_page_dir(task_manager.first_task.tss.cr3);
@@ -198,6 +329,7 @@ void task_first_init (void) {
 
     // 写TR寄存器，指示当前运行的第一个任务
     write_tr(task_manager.first_task.tss_sel);
+    cpu_set_sysenter_stack(task_manager.first_task.tss.esp0);
 }
 
 /**
@@ -223,19 +355,22 @@ void task_manager_init (void) {
     kernel_memset(task_table, 0, sizeof(task_table));
     mutex_init(&task_table_mutex);
 
-    //数据段和代码段，使用DPL3，所有应用共用同一个
-    //为调试方便，暂时使用DPL0
-    int sel = gdt_alloc_desc();
-    segment_desc_set(sel, 0x00000000, 0xFFFFFFFF,
-                     SEG_P_PRESENT | SEG_DPL3 | SEG_S_NORMAL |
-                     SEG_TYPE_DATA | SEG_TYPE_RW | SEG_D);
-    task_manager.app_data_sel = sel;
+    //数据段和代码段，使用DPL3，所有应用共用同一个，在GDT中的位置固定
+    task_manager.app_data_sel = APP_SELECTOR_DS;
+    task_manager.app_code_sel = APP_SELECTOR_CS;
 
-    sel = gdt_alloc_desc();
-    segment_desc_set(sel, 0x00000000, 0xFFFFFFFF,
-                     SEG_P_PRESENT | SEG_DPL3 | SEG_S_NORMAL |
-                     SEG_TYPE_CODE | SEG_TYPE_RW | SEG_D);
-    task_manager.app_code_sel = sel;
+    // 内核线程共用的地址空间和文件表，始终保留一个引用，不会释放
+    kernel_memset(&kernel_mm, 0, sizeof(kernel_mm));
+    kernel_mm.ref = 1;
+    kernel_mm.page_dir = memory_create_uvm();
+    ASSERT(kernel_mm.page_dir != 0);
+    list_init(&kernel_mm.vma_list);
+    kernel_mm.mutex = &kernel_mm_mutex;
+    mutex_init(kernel_mm.mutex);
+
+    kernel_memset(&kernel_files, 0, sizeof(kernel_files));
+    kernel_files.ref = 1;
+    kernel_strncpy(kernel_files.cwd, "/", sizeof(kernel_files.cwd));
 
     // 各队列初始化
     list_init(&task_manager.ready_list);
@@ -318,7 +453,7 @@ task_t * task_current (void) {
  */
 file_t * task_file (int fd) {
     if ((fd >= 0) && (fd < TASK_OFILE_NR)) {
-        file_t * file = task_current()->file_table[fd];
+        file_t * file = task_current()->files->file_table[fd];
         return file;
     }
 
@@ -329,12 +464,12 @@ file_t * task_file (int fd) {
  * @brief 为指定的file分配一个新的文件id
  */
 int task_alloc_fd (file_t * file) {
-    task_t * task = task_current();
+    task_files_t * files = task_current()->files;
 
     for (int i = 0; i < TASK_OFILE_NR; i++) {
-        file_t * p = task->file_table[i];
+        file_t * p = files->file_table[i];
         if (p == (file_t *)0) {
-            task->file_table[i] = file;
+            files->file_table[i] = file;
             return i;
         }
     }
@@ -347,7 +482,7 @@ int task_alloc_fd (file_t * file) {
  */
 void task_remove_fd (int fd) {
     if ((fd >= 0) && (fd < TASK_OFILE_NR)) {
-        task_current()->file_table[fd] = (file_t *)0;
+        task_current()->files->file_table[fd] = (file_t *)0;
     }
 }
 
@@ -413,6 +548,11 @@ void task_time_tick (void) {
         task_t * task = list_node_parent(curr, task_t, run_node);
         if (--task->sleep_ticks == 0) {
             // 延时时间到达，从睡眠队列中移除，送至就绪队列
+            // 限时等待的还要移出等待队列，之后不会再被当作等待者唤醒
+            if (task->wait_list) {
+                list_remove(task->wait_list, &task->wait_node);
+                task->wait_list = (list_t *)0;
+            }
             task_set_wakeup(task);
             task_set_ready(task);
         }
@@ -476,18 +616,57 @@ void sys_msleep (uint32_t ms) {
 
 
 /**
- * @brief 从当前进程中拷贝已经打开的文件列表
+ * @brief 复制文件表，各文件增加引用
  */
-static void copy_opened_files(task_t * child_task) {
-    task_t * parent = task_current();
+static task_files_t * files_copy (task_files_t * from) {
+    task_files_t * files = files_alloc();
+    if (!files) {
+        return (task_files_t *)0;
+    }
 
     for (int i = 0; i < TASK_OFILE_NR; i++) {
-        file_t * file = parent->file_table[i];
+        file_t * file = from->file_table[i];
         if (file) {
             file_inc_ref(file);
-            child_task->file_table[i] = parent->file_table[i];
+            files->file_table[i] = file;
         }
     }
+
+    // 子进程继承已打开的有名信号量
+    for (int id = 0; id < KSEM_NR; id++) {
+        if (from->ksem_ref[id]) {
+            files->ksem_ref[id] = from->ksem_ref[id];
+            ksem_ref_add(id, from->ksem_ref[id]);
+        }
+    }
+
+    // 子进程继承当前工作目录
+    kernel_memcpy(files->cwd, from->cwd, sizeof(files->cwd));
+    return files;
+}
+
+/**
+ * @brief 复制地址空间，包括各页的内容和映射区域
+ */
+static task_mm_t * mm_copy (task_mm_t * from) {
+    uint32_t page_dir = memory_copy_uvm(from->page_dir);
+    if (page_dir == 0) {
+        return (task_mm_t *)0;
+    }
+
+    task_mm_t * mm = mm_alloc(page_dir);
+    if (!mm) {
+        memory_destroy_uvm(page_dir);
+        return (task_mm_t *)0;
+    }
+
+    mm->heap_start = from->heap_start;
+    mm->heap_end = from->heap_end;
+    if (mmap_copy(mm, from) < 0) {
+        mm_put(mm);
+        return (task_mm_t *)0;
+    }
+    return mm;
 }
 
 /**
@@ -513,7 +692,9 @@ int sys_fork (void) {
     }
 
     // 拷贝打开的文件
-    copy_opened_files(child_task);
+    if ((child_task->files = files_copy(parent_task->files)) == (task_files_t *)0) {
+        goto fork_failed;
+    }
 
     // 从父进程的栈中取部分状态，然后写入tss。
     // 注意检查esp, eip等是否在用户空间范围内，不然会造成page_fault
@@ -535,10 +716,13 @@ int sys_fork (void) {
 
     child_task->parent = parent_task;
 
-    // 复制父进程的内存空间到子进程
-    if ((child_task->tss.cr3 = memory_copy_uvm(parent_task->tss.cr3)) < 0) {
+    // 复制父进程的内存空间到子进程，映射区域也一并复制
+    task_mm_t * mm = mm_copy(parent_task->mm);
+    if (!mm) {
         goto fork_failed;
     }
+    task_set_mm(child_task, mm);
+    vdso_set_pid(mm->page_dir, child_task->pid);
 
     // 创建成功，返回子进程的pid
     task_start(child_task);
@@ -551,6 +735,68 @@ fork_failed:
     return -1;
 }
 
+/**
+ * @brief 创建线程，与当前进程共享地址空间和文件表
+ * 线程从entry开始运行，使用调用者准备好的用户栈stack
+ */
+int sys_clone (uint32_t entry, uint32_t stack) {
+    task_t * parent_task = task_current();
+
+    if ((entry < MEMORY_TASK_BASE) || (stack < MEMORY_TASK_BASE)) {
+        log_printf("clone: bad entry or stack");
+        return -1;
+    }
+
+    task_t * child_task = alloc_task();
+    if (child_task == (task_t *)0) {
+        return -1;
+    }
+
+    if (task_init(child_task, parent_task->name, 0, entry, stack) < 0) {
+        free_task(child_task);
+        return -1;
+    }
+
+    task_set_mm(child_task, mm_get(parent_task->mm));
+    child_task->files = files_get(parent_task->files);
+    child_task->parent = parent_task;
+    task_start(child_task);
+    return child_task->pid;
+}
+
+/**
+ * @brief 内核线程的入口函数返回后，从这里退出
+ */
+static void kthread_exit (void) {
+    sys_exit(0);
+}
+
+/**
+ * @brief 创建内核线程，运行entry(arg)。内核线程使用内核的地址空间，由初始任务回收
+ */
+task_t * kthread_create (const char * name, void (*entry)(void * arg), void * arg) {
+    task_t * task = alloc_task();
+    if (task == (task_t *)0) {
+        log_printf("kthread: no free task");
+        return (task_t *)0;
+    }
+
+    if (task_init(task, name, TASK_FLAG_SYSTEM, (uint32_t)entry, 0) < 0) {
+        free_task(task);
+        return (task_t *)0;
+    }
+
+    // 运行在内核栈上，在栈中放好参数和返回地址，像被调用一样进入entry
+    uint32_t * stack = (uint32_t *)task->tss.esp;
+    *--stack = (uint32_t)arg;
+    *--stack = (uint32_t)kthread_exit;
+    task->tss.esp = (uint32_t)stack;
+
+    task->parent = &task_manager.first_task;
+    task_start(task);
+    return task;
+}
+
 /**
  * @brief 加载一个程序表头的数据到内存中
  */
@@ -574,21 +820,28 @@ static int load_phdr(int file, Elf32_Phdr * phdr, uint32_t page_dir) {
     // 为段分配所有的内存空间.后续操作如果失败，将在上层释放
     // 简单起见，设置成可写模式，也许可考虑根据phdr->flags设置成只读
     // 因为没有找到该值的详细定义，所以没有加上
+    // 新页表中的各页在物理上不连续，每次用readv将多页一起读入
     uint32_t vaddr = phdr->p_vaddr;
     uint32_t size = phdr->p_filesz;
     while (size > 0) {
-        int curr_size = (size > MEM_PAGE_SIZE) ? MEM_PAGE_SIZE : size;
-
-        uint32_t paddr = memory_get_paddr(page_dir, vaddr);
+        struct iovec iov[FILE_IOV_MAX];
+        int iovcnt = 0, total = 0;
+        while ((size > 0) && (iovcnt < FILE_IOV_MAX)) {
+            int curr_size = (size > MEM_PAGE_SIZE) ? MEM_PAGE_SIZE : size;
+
+            // 注意，这里用的页表仍然是当前的
+            iov[iovcnt].iov_base = (void *)memory_get_paddr(page_dir, vaddr);
+            iov[iovcnt++].iov_len = curr_size;
+
+            total += curr_size;
+            size -= curr_size;
+            vaddr += curr_size;
+        }
 
-        // 注意，这里用的页表仍然是当前的
-        if (sys_read(file, (char *)paddr, curr_size) <  curr_size) {
+        if (sys_readv(file, iov, iovcnt) < total) {
             log_printf("read file failed");
             return -1;
         }
-
-        size -= curr_size;
-        vaddr += curr_size;
     }
 
     // bss区考虑由crt0和cstart自行清0，这样更简单一些
@@ -601,7 +854,8 @@ static int load_phdr(int file, Elf32_Phdr * phdr, uint32_t page_dir) {
 /**
  * @brief 加载elf文件到内存中
  */
-static uint32_t load_elf_file (task_t * task, const char * name, uint32_t page_dir) {
+static uint32_t load_elf_file (task_mm_t * mm, const char * name) {
+    uint32_t page_dir = mm->page_dir;
     Elf32_Ehdr elf_hdr;
     Elf32_Phdr elf_phdr;
 
@@ -641,13 +895,8 @@ static uint32_t load_elf_file (task_t * task, const char * name, uint32_t page_d
     // 然后从中加载程序头，将内容拷贝到相应的位置
     uint32_t e_phoff = elf_hdr.e_phoff;
     for (int i = 0; i < elf_hdr.e_phnum; i++, e_phoff += elf_hdr.e_phentsize) {
-        if (sys_lseek(file, e_phoff, 0) < 0) {
-            log_printf("read file failed");
-            goto load_failed;
-        }
-
         // 读取程序头后解析，这里不用读取到新进程的页表中，因为只是临时使用下
-        cnt = sys_read(file, (char *)&elf_phdr, sizeof(Elf32_Phdr));
+        cnt = sys_pread(file, (char *)&elf_phdr, sizeof(Elf32_Phdr), e_phoff);
         if (cnt < sizeof(Elf32_Phdr)) {
             log_printf("read file failed");
             goto load_failed;
@@ -667,8 +916,8 @@ static uint32_t load_elf_file (task_t * task, const char * name, uint32_t page_d
         }
 
         // 简单起见，不检查了，以最后的地址为bss的地址
-        task->heap_start = elf_phdr.p_vaddr + elf_phdr.p_memsz;
-        task->heap_end = task->heap_start;
+        mm->heap_start = elf_phdr.p_vaddr + elf_phdr.p_memsz;
+        mm->heap_end = mm->heap_start;
    }
 
     sys_close(file);
@@ -734,15 +983,21 @@ int sys_execve(char *name, char **argv, char **env) {
     // 后面会切换页表，所以先处理需要从进程空间取数据的情况
     kernel_strncpy(task->name, get_file_name(name), TASK_NAME_SIZE);
 
-    // 现在开始加载了，先准备应用页表，由于所有操作均在内核区中进行，所以可以直接先切换到新页表
-    uint32_t old_page_dir = task->tss.cr3;
+    // 现在开始加载了，先准备新的地址空间。同一进程中的其它线程仍使用原地址空间
+    task_mm_t * new_mm = (task_mm_t *)0;
     uint32_t new_page_dir = memory_create_uvm();
     if (!new_page_dir) {
         goto exec_failed;
     }
 
-    // 加载elf文件到内存中。要放在开启新页表之后，这样才能对相应的内存区域写
-    uint32_t entry = load_elf_file(task, name, new_page_dir);    // 暂时置用task->name表示
+    new_mm = mm_alloc(new_page_dir);
+    if (!new_mm) {
+        memory_destroy_uvm(new_page_dir);
+        goto exec_failed;
+    }
+
+    // 加载elf文件到内存中
+    uint32_t entry = load_elf_file(new_mm, name);
     if (entry == 0) {
         goto exec_failed;
     }
@@ -763,6 +1018,12 @@ int sys_execve(char *name, char **argv, char **env) {
         goto exec_failed;
     }
 
+    // 映射时间、进程号等只读数据，应用读取时无需系统调用
+    err = vdso_map(new_page_dir, task->pid);
+    if (err < 0) {
+        goto exec_failed;
+    }
+
     // 加载完毕，为程序的执行做必要准备
     // 注意，exec的作用是替换掉当前进程，所以只要改变当前进程的执行流即可
     // 当该进程恢复运行时，像完全重新运行一样，所以用户栈要设置成初始模式
@@ -778,23 +1039,21 @@ int sys_execve(char *name, char **argv, char **env) {
     frame->esp = stack_top - sizeof(uint32_t)*SYSCALL_PARAM_COUNT;
 
     // 切换到新的页表
-    task->tss.cr3 = new_page_dir;
+    task_mm_t * old_mm = task->mm;
+    task_set_mm(task, new_mm);
     mmu_set_page_dir(new_page_dir);   // 切换至新的页表。由于不用访问原栈及数据，所以并无问题
 
-    // 调整页表，切换成新的，同时释放掉之前的
     // 当前使用的是内核栈，而内核栈并未映射到进程地址空间中，所以下面的释放没有问题
-    memory_destroy_uvm(old_page_dir);            // 再释放掉了原进程的内容空间
+    // 原有的映射区域和内存空间，没有其它线程使用时释放
+    mm_put(old_mm);
 
     // 当从系统调用中返回时，将切换至新进程的入口地址运行，并且进程能够获取参数
     // 注意，如果用户栈设置不当，可能导致返回后运行出现异常。可在gdb中使用nexti单步观察运行流程
     return  0;
 
 exec_failed:    // 必要的资源释放
-    if (new_page_dir) {
-        // 有页表空间切换，切换至旧页表，销毁新页表
-        task->tss.cr3 = old_page_dir;
-        mmu_set_page_dir(old_page_dir);
-        memory_destroy_uvm(new_page_dir);
+    if (new_mm) {
+        mm_put(new_mm);
     }
 
     return -1;
@@ -829,9 +1088,8 @@ int sys_wait(int* status) {
 
                 *status = task->status;
 
-                memory_destroy_uvm(task->tss.cr3);
-                memory_free_page(task->tss.esp0 - MEM_PAGE_SIZE);
-                kernel_memset(task, 0, sizeof(task_t));
+                // 释放内核栈、tss及地址空间
+                task_uninit(task);
 
                 mutex_unlock(&task_table_mutex);
                 return pid;
@@ -855,19 +1113,20 @@ void sys_exit(int status) {
     task_t * curr_task = task_current();
 
     // 关闭所有已经打开的文件, 标准输入输出库会由newlib自行关闭，但这里仍然再处理下
-    for (int fd = 0; fd < TASK_OFILE_NR; fd++) {
-        file_t * file = curr_task->file_table[fd];
-        if (file) {
-            sys_close(fd);
-            curr_task->file_table[fd] = (file_t *)0;
-        }
+    // 文件表与其它线程共享时，只释放引用
+    files_put(curr_task->files);
+    curr_task->files = (task_files_t *)0;
+
+    // 映射区域持有对文件的引用，没有其它线程使用时及早释放。页表由回收时释放
+    if (curr_task->mm->ref == 1) {
+        mmap_destroy(curr_task->mm);
     }
 
     int move_child = 0;
 
     // 找所有的子进程，将其转交给init进程
     mutex_lock(&task_table_mutex);
-    for (int i = 0; i < TASK_OFILE_NR; i++) {
+    for (int i = 0; i < TASK_NR; i++) {
         task_t * task = task_table + i;
         if (task->parent == curr_task) {
             // 有子进程，则转给init_task
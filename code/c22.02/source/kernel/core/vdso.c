@@ -0,0 +1,126 @@
+/**
+ * 映射到每个进程中的只读数据页
+ *
+ * 应用读取时间、进程号等信息时，直接读取映射到自己地址空间中的数据页，无需系统调用。
+ * 共享页只有一份，由时钟中断更新tick和当时的tsc，应用用tsc差值插值出tick之间的时间；
+ * 进程页在加载程序时分配，fork时随地址空间复制，再改为子进程的进程号。
+ * 两页对应用都是只读的，内核通过物理地址写入。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "core/vdso.h"
+#include "core/memory.h"
+#include "cpu/mmu.h"
+#include "comm/cpu_instr.h"
+#include "tools/klib.h"
+#include "tools/log.h"
+#include "os_cfg.h"
+
+static vdso_data_t * vdso_data;         // 共享页
+static uint32_t calib_tsc;              // 开始校准时的tsc
+
+static inline uint64_t read_tsc (void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * @brief 初始化共享页，记录cpu信息
+ */
+void vdso_init (void) {
+    vdso_data = (vdso_data_t *)memory_alloc_page();
+    ASSERT(vdso_data != (vdso_data_t *)0);
+    kernel_memset(vdso_data, 0, MEM_PAGE_SIZE);
+
+    vdso_data->tick_ms = OS_TICK_MS;
+
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0, &eax, &ebx, &ecx, &edx);
+    kernel_memcpy(vdso_data->cpu_vendor, &ebx, 4);
+    kernel_memcpy(vdso_data->cpu_vendor + 4, &edx, 4);
+    kernel_memcpy(vdso_data->cpu_vendor + 8, &ecx, 4);
+
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    vdso_data->cpu_features = edx;
+}
+
+/**
+ * @brief 计算tsc到纳秒的换算系数，即(1000000 << VDSO_TSC_SHIFT) / tsc_per_ms
+ * 没有libgcc的64位除法，用divl计算，tsc频率高于1MHz时商不超过32位
+ */
+static uint32_t tsc_ns_mult (uint32_t tsc_per_ms) {
+    uint64_t num = (uint64_t)1000000 << VDSO_TSC_SHIFT;
+    uint32_t quot, rem;
+
+    __asm__ __volatile__("divl %[d]" : "=a"(quot), "=d"(rem)
+            : "a"((uint32_t)num), "d"((uint32_t)(num >> 32)), [d]"rm"(tsc_per_ms));
+    return quot;
+}
+
+/**
+ * @brief 时钟中断中调用，更新tick和tsc，并在启动后不久校准tsc频率
+ */
+void vdso_tick (uint32_t tick) {
+    if (!vdso_data) {
+        return;
+    }
+
+    uint64_t tsc = read_tsc();
+    if (tick == VDSO_CALIB_START) {
+        calib_tsc = (uint32_t)tsc;
+    } else if ((tick == VDSO_CALIB_START + VDSO_CALIB_TICKS) && (vdso_data->tsc_per_ms == 0)) {
+        uint32_t tsc_per_ms = ((uint32_t)tsc - calib_tsc) / (VDSO_CALIB_TICKS * OS_TICK_MS);
+        if (tsc_per_ms >= 1000) {
+            vdso_data->tsc_per_ms = tsc_per_ms;
+            vdso_data->tsc_ns_mult = tsc_ns_mult(tsc_per_ms);
+        }
+    }
+
+    vdso_data->seq++;
+    vdso_data->tick = tick;
+    vdso_data->tick_tsc_lo = (uint32_t)tsc;
+    vdso_data->tick_tsc_hi = (uint32_t)(tsc >> 32);
+    vdso_data->seq++;
+}
+
+/**
+ * @brief 将共享页和新分配的进程页映射到page_dir中，加载程序时调用
+ */
+int vdso_map (uint32_t page_dir, int pid) {
+    // 共享页，fork时不复制，内核持有的引用使其不会被释放
+    int err = memory_create_map((pde_t *)page_dir, VDSO_DATA_ADDR, (uint32_t)vdso_data, 1, PTE_U | PTE_SHARED);
+    if (err < 0) {
+        log_printf("vdso: map failed");
+        return -1;
+    }
+    memory_page_ref((uint32_t)vdso_data);
+
+    uint32_t page = memory_alloc_zero_page();
+    if (page == 0) {
+        log_printf("vdso: no memory");
+        return -1;
+    }
+
+    err = memory_create_map((pde_t *)page_dir, VDSO_TASK_ADDR, page, 1, PTE_U);
+    if (err < 0) {
+        log_printf("vdso: map failed");
+        memory_free_page(page);
+        return -1;
+    }
+
+    ((vdso_task_t *)page)->pid = pid;
+    return 0;
+}
+
+/**
+ * @brief 修改进程页中的进程号，fork复制地址空间后调用
+ */
+void vdso_set_pid (uint32_t page_dir, int pid) {
+    uint32_t page = memory_get_paddr(page_dir, VDSO_TASK_ADDR);
+    if (page) {
+        ((vdso_task_t *)page)->pid = pid;
+    }
+}
@@ -14,6 +14,7 @@
 
 static segment_desc_t gdt_table[GDT_TABLE_SIZE];
 static mutex_t mutex;
+static int sysenter_enable;         // 是否支持sysenter快速系统调用
 
 /**
  * 设置段描述符
@@ -88,6 +89,14 @@ void init_gdt(void) {
                      SEG_P_PRESENT | SEG_DPL0 | SEG_S_NORMAL | SEG_TYPE_CODE
                      | SEG_TYPE_RW | SEG_D | SEG_G);
 
+    // 应用的代码段和数据段，所有应用共用。位置固定，sysexit按内核代码段的位置推算
+    segment_desc_set(APP_SELECTOR_DS, 0x00000000, 0xFFFFFFFF,
+                     SEG_P_PRESENT | SEG_DPL3 | SEG_S_NORMAL |
+                     SEG_TYPE_DATA | SEG_TYPE_RW | SEG_D);
+    segment_desc_set(APP_SELECTOR_CS, 0x00000000, 0xFFFFFFFF,
+                     SEG_P_PRESENT | SEG_DPL3 | SEG_S_NORMAL |
+                     SEG_TYPE_CODE | SEG_TYPE_RW | SEG_D);
+
     // 调用门
     gate_desc_set((gate_desc_t *)(gdt_table + (SELECTOR_SYSCALL >> 3)),
             KERNEL_SELECTOR_CS,
@@ -105,6 +114,30 @@ void switch_to_tss (uint32_t tss_selector) {
     far_jump(tss_selector, 0);
 }
 
+/**
+ * 设置sysenter进入时使用的栈，切换任务时调用，使其指向当前任务的内核栈
+ */
+void cpu_set_sysenter_stack (uint32_t esp) {
+    if (sysenter_enable) {
+        write_msr(MSR_SYSENTER_ESP, esp);
+    }
+}
+
+/**
+ * 初始化sysenter快速系统调用，CPU不支持时只能使用调用门
+ */
+static void init_sysenter (void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if ((edx & CPUID_EDX_SEP) == 0) {
+        return;
+    }
+
+    write_msr(MSR_SYSENTER_CS, KERNEL_SELECTOR_CS);
+    write_msr(MSR_SYSENTER_EIP, (uint32_t)exception_handler_sysenter);
+    sysenter_enable = 1;
+}
+
 /**
  * CPU初始化
  */
@@ -112,4 +145,5 @@ void cpu_init (void) {
     mutex_init(&mutex);
 
     init_gdt();
+    init_sysenter();
 }
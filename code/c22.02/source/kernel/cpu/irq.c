@@ -11,6 +11,8 @@
 #include "tools/log.h"
 #include "os_cfg.h"
 #include "core/task.h"
+#include "core/memory.h"
+#include "core/mmap.h"
 
 #define IDT_TABLE_NR			128				// IDT表项数量
 
@@ -144,6 +146,23 @@ void do_handler_general_protection(exception_frame_t * frame) {
 }
 
 void do_handler_page_fault(exception_frame_t * frame) {
+    // 访问映射区或堆中尚未建立映射的页，建立后重新执行
+    uint32_t fault_addr = read_cr2();
+    if (fault_addr >= MEMORY_TASK_BASE) {
+        // 可能要读磁盘，需要开中断。但发生异常前已关中断的，不能打开
+        int irq_on = frame->eflags & EFLAGS_IF;
+        if (irq_on) {
+            irq_enable_global();
+        }
+        int err = mmap_fault(fault_addr, frame->error_code);
+        if (irq_on) {
+            irq_disable_global();
+        }
+        if (err == 0) {
+            return;
+        }
+    }
+
     log_printf("--------------------------------");
     log_printf("IRQ/Exception happend: Page fault.");
     if (frame->error_code & ERR_PAGE_P) {
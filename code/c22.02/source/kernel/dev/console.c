@@ -11,10 +11,20 @@
 #include "comm/cpu_instr.h"
 #include "dev/tty.h"
 #include "cpu/irq.h"
+#include "core/memory.h"
+#include "tools/log.h"
+#include "dev/fb.h"
 
 #define CONSOLE_NR          8           // 控制台的数量
+#define BLANK_ATTR          ((COLOR_Black << 4) | COLOR_White)  // 空白字符的属性
+#define HIST_RECORD_MAX     (2 + CONSOLE_COL_MAX * 3)           // 一行记录的最大长度
 
 static console_t console_buf[CONSOLE_NR];
+static int curr_console;            // 当前显示的控制台，图形模式下只有它画到帧缓存上
+
+// 控制台0在log_init中打开，此时还不能分配内存，影子缓存只能静态分配
+// 此时总是文本模式，进入图形模式后再换成更大的影子缓存
+static disp_char_t boot_shadow[CONSOLE_TEXT_ROWS * CONSOLE_TEXT_COLS];
 
 /**
  * @brief 读取当前光标的位置
@@ -35,6 +45,20 @@ static int read_cursor_pos (void) {
  * @brief 更新鼠标的位置
  */
 static void update_cursor_pos (console_t * console) {
+    if (fb_enabled()) {
+        if (console == console_buf + curr_console) {
+            // 回看时不显示光标
+            irq_state_t state = irq_enter_protection();
+            if (console->view) {
+                fb_set_cursor(-1, -1);
+            } else {
+                fb_set_cursor(console->cursor_row, console->cursor_col);
+            }
+            irq_leave_protection(state);
+        }
+        return;
+    }
+
 	uint16_t pos = (console - console_buf) * (console->display_cols * console->display_rows);
     pos += console->cursor_row *  console->display_cols + console->cursor_col;
 
@@ -49,6 +73,14 @@ static void update_cursor_pos (console_t * console) {
 void console_set_cursor(int idx, int visiable) {
     console_t *console = console_buf + idx;
 
+    if (fb_enabled()) {
+        irq_state_t state = irq_enter_protection();
+        fb_show_cursor(visiable);
+        irq_leave_protection(state);
+        update_cursor_pos(console);
+        return;
+    }
+
     irq_state_t state = irq_enter_protection();
     if (visiable) {
         outb(0x3D4, 0x0A);
@@ -63,12 +95,25 @@ void console_set_cursor(int idx, int visiable) {
 }
 
 
+static void console_show_view (console_t * console);
+
 void console_select(int idx) {
     console_t * console = console_buf + idx;
-    if (console->disp_base == 0) {
+    if (console->shadow == (disp_char_t *)0) {
         // 可能没有初始化，先初始化一下
         console_init(idx);
     }
+    curr_console = idx;
+
+    // 图形模式下只有一屏，重画新选中的控制台
+    if (fb_enabled()) {
+        fb_invalidate();
+        if (!console->writing) {
+            console_show_view(console);
+        }
+        update_cursor_pos(console);
+        return;
+    }
 
 	uint16_t pos = idx * console->display_cols * console->display_rows;
 
@@ -81,30 +126,257 @@ void console_select(int idx) {
     update_cursor_pos(console);
 }
 /**
- * @brief 擦除从start到end的行
+ * @brief 取屏幕上第row行在影子缓存中的起始位置
  */
-static void erase_rows (console_t * console, int start, int end) {
-    volatile disp_char_t * disp_start = console->disp_base + console->display_cols * start;
-    volatile disp_char_t * disp_end = console->disp_base + console->display_cols * (end + 1);
+static inline disp_char_t * shadow_row (console_t * console, int row) {
+    int index = (console->origin + row) % console->display_rows;
+    return console->shadow + index * console->display_cols;
+}
+
+static inline void mark_dirty (console_t * console, int row) {
+    console->dirty[row / 32] |= 1 << (row % 32);
+}
+
+static void mark_all_dirty (console_t * console) {
+    for (int row = 0; row < console->display_rows; row++) {
+        mark_dirty(console, row);
+    }
+}
+
+static void clear_dirty (console_t * console) {
+    kernel_memset(console->dirty, 0, sizeof(console->dirty));
+}
+
+static int has_dirty (console_t * console) {
+    for (int i = 0; i < sizeof(console->dirty) / sizeof(console->dirty[0]); i++) {
+        if (console->dirty[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 将一行内容写到屏幕的第row行
+ * 图形模式下只有当前控制台画到帧缓存上，其它控制台在选中时整屏重画
+ */
+static void put_row (console_t * console, int row, const disp_char_t * line) {
+    if (console->disp_base) {
+        kernel_memcpy(console->disp_base + row * console->display_cols, (void *)line,
+                    console->display_cols * sizeof(disp_char_t));
+    } else if (console == console_buf + curr_console) {
+        fb_draw_line(row, line, console->display_cols);
+    }
+}
+
+/**
+ * @brief 将改动过的行写入显存
+ */
+static void console_flush (console_t * console) {
+    for (int row = 0; row < console->display_rows; row++) {
+        uint32_t mask = 1 << (row % 32);
+        if (console->dirty[row / 32] & mask) {
+            put_row(console, row, shadow_row(console, row));
+            console->dirty[row / 32] &= ~mask;
+        }
+    }
+}
+
+/**
+ * @brief 将影子缓存中的一行压缩成回看记录，返回记录长度
+ */
+static int hist_encode (console_t * console, disp_char_t * line, uint8_t * record) {
+    // 行尾空白不记录，显示时再补上
+    int count = console->display_cols;
+    while ((count > 0) && (line[count - 1].c == ' ') && ((line[count - 1].v >> 8) == BLANK_ATTR)) {
+        count--;
+    }
+
+    // 相同属性的连续字符合并为一段
+    uint8_t * span = record + 2;
+    int span_cnt = 0;
+    for (int i = 0; i < count; i++) {
+        uint8_t attr = line[i].v >> 8;
+        if (span_cnt && (span[-1] == attr)) {
+            span[-2]++;
+        } else {
+            *span++ = 1;
+            *span++ = attr;
+            span_cnt++;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        *span++ = line[i].c;
+    }
+
+    record[0] = count;
+    record[1] = span_cnt;
+    return span - record;
+}
+
+/**
+ * @brief 将回看记录还原成一行显示内容
+ */
+static void hist_decode (console_t * console, const uint8_t * record, disp_char_t * line) {
+    const uint8_t * span = record + 2;
+    const uint8_t * chars = span + record[1] * 2;
+
+    int col = 0;
+    for (int i = 0; i < record[1]; i++, span += 2) {
+        for (int j = 0; j < span[0]; j++, col++) {
+            line[col].v = (span[1] << 8) | (uint8_t)chars[col];
+        }
+    }
+
+    for (; col < console->display_cols; col++) {
+        line[col].v = (BLANK_ATTR << 8) | ' ';
+    }
+}
+
+/**
+ * @brief 取回看记录中的第index行，0为最早的一行
+ */
+static uint8_t * hist_line (console_hist_t * hist, int index) {
+    uint32_t pos = hist->line_pos[(hist->first + index) % CONSOLE_HISTORY_LINES];
+    return hist->buf + pos % CONSOLE_HISTORY_SIZE;
+}
+
+/**
+ * @brief 将屏幕上的第row行存入回看记录
+ */
+static void hist_push (console_t * console, int row) {
+    console_hist_t * hist = &console->hist;
+
+    // 有内容滚出时才分配，行位置表紧跟在记录缓存之后
+    if (hist->buf == (uint8_t *)0) {
+        int page_count = up2(CONSOLE_HISTORY_SIZE + CONSOLE_HISTORY_LINES * sizeof(uint32_t), MEM_PAGE_SIZE) / MEM_PAGE_SIZE;
+        hist->buf = (uint8_t *)memory_alloc_pages(page_count);
+        if (hist->buf == (uint8_t *)0) {
+            return;
+        }
+        hist->line_pos = (uint32_t *)(hist->buf + CONSOLE_HISTORY_SIZE);
+    }
+
+    uint8_t record[HIST_RECORD_MAX];
+    int size = hist_encode(console, shadow_row(console, row), record);
+
+    // 记录不跨越缓存末尾，放不下时从头开始
+    uint32_t pos = hist->write_pos;
+    uint32_t offset = pos % CONSOLE_HISTORY_SIZE;
+    if (offset + size > CONSOLE_HISTORY_SIZE) {
+        pos += CONSOLE_HISTORY_SIZE - offset;
+        offset = 0;
+    }
+    hist->write_pos = pos + size;
+
+    // 丢弃被覆盖的行和超出行数的行
+    irq_state_t state = irq_enter_protection();
+    while (hist->count && ((hist->count == CONSOLE_HISTORY_LINES) ||
+            (hist->write_pos - hist->line_pos[hist->first] > CONSOLE_HISTORY_SIZE))) {
+        hist->first = (hist->first + 1) % CONSOLE_HISTORY_LINES;
+        hist->count--;
+    }
+
+    kernel_memcpy(hist->buf + offset, record, size);
+    hist->line_pos[(hist->first + hist->count) % CONSOLE_HISTORY_LINES] = pos;
+    hist->count++;
+
+    // 回看中时保持显示的内容不变
+    if (console->view) {
+        console->view++;
+    }
+    if (console->view > hist->count) {
+        console->view = hist->count;
+    }
+    irq_leave_protection(state);
+}
+
+/**
+ * @brief 按回看位置重新显示整屏，view为0时显示最新内容
+ */
+static void console_show_view (console_t * console) {
+    if (console->view == 0) {
+        mark_all_dirty(console);
+        console_flush(console);
+        return;
+    }
+
+    console_hist_t * hist = &console->hist;
+    for (int row = 0; row < console->display_rows; row++) {
+        int index = hist->count - console->view + row;
+        if (index < hist->count) {
+            disp_char_t line[CONSOLE_COL_MAX];
+            hist_decode(console, hist_line(hist, index), line);
+            put_row(console, row, line);
+        } else {
+            put_row(console, row, shadow_row(console, index - hist->count));
+        }
+    }
+
+    // 回到最新内容时会整屏重写
+    clear_dirty(console);
+}
+
+/**
+ * @brief 回看翻页，dir为1向前，-1向后，0回到最新内容。在键盘中断中调用
+ */
+void console_scroll_view (int idx, int dir) {
+    console_t * console = console_buf + idx;
+    if (console->shadow == (disp_char_t *)0) {
+        return;
+    }
+
+    irq_state_t state = irq_enter_protection();
+    int view = console->view + dir * console->display_rows / 2;
+    if ((dir == 0) || (view < 0)) {
+        view = 0;
+    } else if (view > console->hist.count) {
+        view = console->hist.count;
+    }
 
-    while (disp_start < disp_end) {
-        disp_start->c = ' ';
-        disp_start->foreground = console->foreground;
-        disp_start->background = console->background;
+    if (view != console->view) {
+        console->view = view;
 
-        disp_start++;
+        // 正在输出时影子缓存可能不完整，由输出结束时显示
+        if (console->writing) {
+            console->view_changed = 1;
+        } else {
+            console_show_view(console);
+        }
     }
+    irq_leave_protection(state);
 }
 
 /**
- * 整体屏幕上移若干行
+ * @brief 擦除从start到end的行
+ */
+static void erase_rows (console_t * console, int start, int end) {
+    disp_char_t blank;
+    blank.v = 0;
+    blank.c = ' ';
+    blank.foreground = console->foreground;
+    blank.background = console->background;
+
+    for (int row = start; row <= end; row++) {
+        disp_char_t * p = shadow_row(console, row);
+        for (int col = 0; col < console->display_cols; col++) {
+            *p++ = blank;
+        }
+        mark_dirty(console, row);
+    }
+}
+
+/**
+ * 整体屏幕上移若干行，只移动影子缓存的起始行，所有行在刷新时重写
  */
 static void scroll_up(console_t * console, int lines) {
-    // 整体上移
-    disp_char_t * dest = console->disp_base;
-    disp_char_t * src = console->disp_base + console->display_cols * lines;
-    uint32_t size = (console->display_rows - lines) * console->display_cols * sizeof(disp_char_t);
-    kernel_memcpy(dest, src, size);
+    for (int row = 0; row < lines; row++) {
+        hist_push(console, row);
+    }
+
+    console->origin = (console->origin + lines) % console->display_rows;
+    mark_all_dirty(console);
 
     // 擦除最后一行
     erase_rows(console, console->display_rows - lines, console->display_rows - 1);
@@ -148,13 +420,11 @@ static void move_forward (console_t * console, int n) {
  * 在当前位置显示一个字符
  */
 static void show_char(console_t * console, char c) {
-    // 每显示一个字符，都进行计算，效率有点低。不过这样直观简单
-    int offset = console->cursor_col + console->cursor_row * console->display_cols;
-
-    disp_char_t * p = console->disp_base + offset;
+    disp_char_t * p = shadow_row(console, console->cursor_row) + console->cursor_col;
     p->c = c;
     p->foreground = console->foreground;
     p->background = console->background;
+    mark_dirty(console, console->cursor_row);
     move_forward(console, 1);
 }
 
@@ -182,15 +452,8 @@ static int move_backword (console_t * console, int n) {
 }
 
 static void clear_display (console_t * console) {
-    int size = console->display_cols * console->display_rows;
-
-    disp_char_t * start = console->disp_base;
-    for (int i = 0; i < size; i++, start++) {
-        // 为便于理解，以下分开三步写一个字符，速度慢一些
-        start->c = ' ';
-        start->background = console->background;
-        start->foreground = console->foreground;
-    }
+    erase_rows(console, 0, console->display_rows - 1);
+    console_flush(console);
 }
 
 /**
@@ -224,19 +487,64 @@ void restore_cursor(console_t * console) {
     console->cursor_row = console->old_cursor_row;
 }
 
+/**
+ * @brief 分配一屏大小的影子缓存
+ */
+static disp_char_t * alloc_shadow (int rows, int cols) {
+    int pages = up2(rows * cols * sizeof(disp_char_t), MEM_PAGE_SIZE) / MEM_PAGE_SIZE;
+    return (disp_char_t *)memory_alloc_pages(pages);
+}
+
+/**
+ * @brief 释放控制台的影子缓存，静态分配的不用释放
+ */
+static void free_shadow (console_t * console) {
+    if (console->shadow == boot_shadow) {
+        return;
+    }
+
+    int size = console->display_rows * console->display_cols * sizeof(disp_char_t);
+    memory_free_pages((uint32_t)console->shadow, up2(size, MEM_PAGE_SIZE) / MEM_PAGE_SIZE);
+}
+
 /**
  * 初始化控制台及键盘
  */
 int console_init (int idx) {
     console_t *console = console_buf + idx;
 
-    console->display_cols = CONSOLE_COL_MAX;
-    console->display_rows = CONSOLE_ROW_MAX;
-    console->disp_base = (disp_char_t *) CONSOLE_DISP_ADDR + idx * console->display_cols * console->display_rows;
+    if (fb_enabled()) {
+        // 所有控制台共用帧缓存，只有当前控制台画到屏幕上
+        fb_get_size(&console->display_cols, &console->display_rows);
+        console->disp_base = (disp_char_t *)0;
+    } else {
+        console->display_cols = CONSOLE_TEXT_COLS;
+        console->display_rows = CONSOLE_TEXT_ROWS;
+        console->disp_base = (disp_char_t *) CONSOLE_DISP_ADDR + idx * console->display_cols * console->display_rows;
+    }
+
+    // 启动时的文本模式下，保留已经显示的内容
+    // 若loader已切换到图形模式，显存中的内容已无意义
+    int keep_boot = (idx == 0) && !fb_enabled() && !fb_present();
+
+    if ((idx == 0) && !fb_enabled()) {
+        console->shadow = boot_shadow;
+    } else if (console->shadow == (disp_char_t *)0) {
+        console->shadow = alloc_shadow(console->display_rows, console->display_cols);
+        if (console->shadow == (disp_char_t *)0) {
+            log_printf("no memory for console %d", idx);
+            return -1;
+        }
+    }
+    console->origin = 0;
+    clear_dirty(console);
 
     console->foreground = COLOR_White;
     console->background = COLOR_Black;
-    if (idx == 0) {
+    if (keep_boot) {
+        kernel_memcpy(console->shadow, console->disp_base,
+                console->display_cols * console->display_rows * sizeof(disp_char_t));
+
         int cursor_pos = read_cursor_pos();
         console->cursor_row = cursor_pos / console->display_cols;
         console->cursor_col = cursor_pos % console->display_cols;
@@ -253,6 +561,63 @@ int console_init (int idx) {
 	return 0;
 }
 
+/**
+ * @brief 开始使用帧缓存显示。已打开的控制台换成新屏幕大小的影子缓存，原有内容保留在左上角
+ * 需在内存管理初始化后调用，此时只有内核自己在运行
+ */
+int console_fb_init (void) {
+    if (fb_enable() < 0) {
+        return -1;
+    }
+
+    int cols, rows;
+    fb_get_size(&cols, &rows);
+
+    for (int idx = 0; idx < CONSOLE_NR; idx++) {
+        console_t * console = console_buf + idx;
+        if (console->shadow == (disp_char_t *)0) {
+            continue;
+        }
+
+        disp_char_t * shadow = alloc_shadow(rows, cols);
+        if (shadow == (disp_char_t *)0) {
+            // 保持原来的大小，只是不能显示出来
+            log_printf("no memory for console %d", idx);
+            continue;
+        }
+
+        int copy_cols = (cols < console->display_cols) ? cols : console->display_cols;
+        for (int row = 0; row < rows; row++) {
+            disp_char_t * line = shadow + row * cols;
+            for (int col = 0; col < cols; col++) {
+                line[col].v = (BLANK_ATTR << 8) | ' ';
+            }
+            if (row < console->display_rows) {
+                kernel_memcpy(line, shadow_row(console, row), copy_cols * sizeof(disp_char_t));
+            }
+        }
+
+        irq_state_t state = irq_enter_protection();
+        free_shadow(console);
+        console->shadow = shadow;
+        console->origin = 0;
+        console->view = 0;
+        console->display_cols = cols;
+        console->display_rows = rows;
+        console->disp_base = (disp_char_t *)0;
+        if (console->cursor_row >= rows) {
+            console->cursor_row = rows - 1;
+        }
+        if (console->cursor_col >= cols) {
+            console->cursor_col = cols - 1;
+        }
+        mark_all_dirty(console);
+        irq_leave_protection(state);
+    }
+
+    console_select(curr_console);
+    return 0;
+}
 
 /**
  * 擦除前一字符
@@ -397,6 +762,14 @@ static void move_cursor(console_t * console) {
 	if (console->curr_param_index >= 2) {
 		console->cursor_col = console->esc_param[1];
 	}
+
+	// 超出屏幕的位置限制在屏幕内，避免写到影子缓存之外
+	if (console->cursor_row >= console->display_rows) {
+		console->cursor_row = console->display_rows - 1;
+	}
+	if (console->cursor_col >= console->display_cols) {
+		console->cursor_col = console->display_cols - 1;
+	}
 }
 
 /**
@@ -460,40 +833,58 @@ static void write_esc_square (console_t * console, char c) {
  */
 int console_write (tty_t * tty) {
 	console_t * console = console_buf + tty->console_idx;
+    if (console->shadow == (disp_char_t *)0) {
+        return -1;
+    }
 
     // 下面的写序列涉及到状态机，还有多进程同时写，因此加上锁
     mutex_lock(&console->mutex);
+    console->writing = 1;
 
     int len = 0;
     do {
-        char c;
-
-        // 取字节数据
-        int err = tty_fifo_get(&tty->ofifo, &c);
-        if (err < 0) {
+        // 成批取出数据，并归还缓存空间
+        char buf[TTY_WRITE_CHUNK];
+        int count = tty_fifo_get_buf(&tty->ofifo, buf, sizeof(buf));
+        if (count <= 0) {
             break;
         }
-        sem_notify(&tty->osem);
+        sem_notify_n(&tty->osem, count);
 
         // 显示出来
-        switch (console->write_state) {
-            case CONSOLE_WRITE_NORMAL: {
-                write_normal(console, c);
-                break;
+        for (int i = 0; i < count; i++) {
+            char c = buf[i];
+            switch (console->write_state) {
+                case CONSOLE_WRITE_NORMAL: {
+                    write_normal(console, c);
+                    break;
+                }
+                case CONSOLE_WRITE_ESC:
+                    write_esc(console, c);
+                    break;
+                case CONSOLE_WRITE_SQUARE:
+                    write_esc_square(console, c);
+                    break;
             }
-            case CONSOLE_WRITE_ESC:
-                write_esc(console, c);
-                break;
-            case CONSOLE_WRITE_SQUARE:
-                write_esc_square(console, c);
-                break;
         }
-        len++;
+        len += count;
     }while (1);
 
-    mutex_unlock(&console->mutex);
-
+    // 全部显示完后，只写一次显存和更新一次光标。回看中时不改变显示的内容
+    if (console->view == 0) {
+        console_flush(console);
+    }
     update_cursor_pos(console);
+
+    irq_state_t state = irq_enter_protection();
+    console->writing = 0;
+    if (console->view_changed || (console->view && has_dirty(console) && (console->view < console->display_rows))) {
+        // 回看位置有变化，或者屏幕上还能看到最新内容中有变化的部分
+        console->view_changed = 0;
+        console_show_view(console);
+    }
+    irq_leave_protection(state);
+    mutex_unlock(&console->mutex);
     return len;
 }
 
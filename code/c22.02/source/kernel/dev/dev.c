@@ -3,16 +3,19 @@
 #include "dev/tty.h"
 #include "tools/klib.h"
 #include "dev/disk.h"
+#include "fs/poll.h"
 
 #define DEV_TABLE_SIZE          128     // 支持的设备数量
 
 extern dev_desc_t dev_tty_desc;
 extern dev_desc_t dev_disk_desc;
+extern dev_desc_t dev_kmsg_desc;
 
 // 设备描述表
 static dev_desc_t * dev_desc_tbl[] = {
     &dev_tty_desc,
     &dev_disk_desc,
+    &dev_kmsg_desc,
 };
 
 // 设备表
@@ -91,6 +94,36 @@ int dev_read (int dev_id, int addr, char * buf, int size) {
     return dev->desc->read(dev, addr, buf, size);
 }
 
+/**
+ * @brief 从pos处读取数据，并更新pos。设备不支持时按普通读取处理，pos不变
+ */
+int dev_read_pos (int dev_id, int * pos, char * buf, int size) {
+    if (is_devid_bad(dev_id)) {
+        return -1;
+    }
+
+    device_t * dev = dev_tbl + dev_id;
+    if (dev->desc->read_pos == 0) {
+        return dev->desc->read(dev, *pos, buf, size);
+    }
+    return dev->desc->read_pos(dev, pos, buf, size);
+}
+
+/**
+ * @brief 从addr起连续读取，依次放入多个缓存。设备不支持时返回-1
+ */
+int dev_readv (int dev_id, int addr, const struct iovec * iov, int iovcnt) {
+    if (is_devid_bad(dev_id)) {
+        return -1;
+    }
+
+    device_t * dev = dev_tbl + dev_id;
+    if (dev->desc->readv == 0) {
+        return -1;
+    }
+    return dev->desc->readv(dev, addr, iov, iovcnt);
+}
+
 /**
  * @brief 写指定字节的数据
  */
@@ -116,6 +149,21 @@ int dev_control (int dev_id, int cmd, int arg0, int arg1) {
     return dev->desc->control(dev, cmd, arg0, arg1);
 }
 
+/**
+ * @brief 查询设备的读写状态
+ */
+int dev_poll (int dev_id, struct _poll_table_t * table) {
+    if (is_devid_bad(dev_id)) {
+        return POLLNVAL;
+    }
+
+    device_t * dev = dev_tbl + dev_id;
+    if (dev->desc->poll == 0) {
+        return POLLIN | POLLOUT;
+    }
+    return dev->desc->poll(dev, table);
+}
+
 /**
  * @brief 关闭设备
  */
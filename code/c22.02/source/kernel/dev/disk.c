@@ -15,6 +15,7 @@
 #include "cpu/irq.h"
 #include "core/memory.h"
 #include "core/task.h"
+#include "fs/file.h"
 
 static disk_t disk_buf[DISK_CNT];  // 通道结构
 static mutex_t mutex;     // 通道信号量
@@ -129,7 +130,7 @@ static int detect_part_info(disk_t * disk) {
             part_info->disk = (disk_t *)0;
         } else {
             // 在主分区中找到，复制信息
-            kernel_sprintf(part_info->name, "%s%d", disk->name, i + 1);
+            kernel_snprintf(part_info->name, sizeof(part_info->name), "%s%d", disk->name, i + 1);
             part_info->start_sector = item->relative_sectors;
             part_info->total_sector = item->total_sectors;
             part_info->disk = disk;
@@ -167,7 +168,7 @@ static int identify_disk (disk_t * disk) {
     // 分区0保存了整个磁盘的信息
     partinfo_t * part = disk->partinfo + 0;
     part->disk = disk;
-    kernel_sprintf(part->name, "%s%d", disk->name, 0);
+    kernel_snprintf(part->name, sizeof(part->name), "%s%d", disk->name, 0);
     part->start_sector = 0;
     part->total_sector = disk->sector_count;
     part->type = FS_INVALID;
@@ -196,7 +197,7 @@ void disk_init (void) {
         disk_t * disk = disk_buf + i;
 
         // 先初始化各字段
-        kernel_sprintf(disk->name, "sd%c", i + 'a');
+        kernel_snprintf(disk->name, sizeof(disk->name), "sd%c", i + 'a');
         disk->drive = (i == 0) ? DISK_DISK_MASTER : DISK_DISK_SLAVE;
         disk->port_base = IOBASE_PRIMARY;
         disk->mutex = &mutex;
@@ -243,9 +244,9 @@ int disk_open (device_t * dev) {
 }
 
 /**
- * @brief 读磁盘
+ * @brief 读磁盘，连续的扇区用一条命令依次读入多个缓存，各缓存的长度须为扇区大小的整数倍
  */
-int disk_read (device_t * dev, int start_sector, char * buf, int count) {
+int disk_readv (device_t * dev, int start_sector, const struct iovec * iov, int iovcnt) {
     // 取分区信息
     partinfo_t * part_info = (partinfo_t *)dev->data;
     if (!part_info) {
@@ -259,32 +260,49 @@ int disk_read (device_t * dev, int start_sector, char * buf, int count) {
         return -1;
     }
 
+    int count = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        count += iov[i].iov_len / disk->sector_size;
+    }
+
     mutex_lock(disk->mutex);
     task_on_op = 1;
 
-    int cnt;
+    int cnt = 0;
     ata_send_cmd(disk, part_info->start_sector + start_sector, count, DISK_CMD_READ);
-    for (cnt = 0; cnt < count; cnt++, buf += disk->sector_size) {
-        // 利用信号量等待中断通知，然后再读取数据
-        if (task_current()) {
-            sem_wait(disk->op_sem);
+    for (int i = 0; i < iovcnt; i++) {
+        char * buf = (char *)iov[i].iov_base;
+        for (int n = iov[i].iov_len / disk->sector_size; n > 0; n--, cnt++, buf += disk->sector_size) {
+            // 利用信号量等待中断通知，然后再读取数据
+            if (task_current()) {
+                sem_wait(disk->op_sem);
+            }
+
+            // 这里虽然有调用等待，但是由于已经是操作完毕，所以并不会等
+            int err = ata_wait_data(disk);
+            if (err < 0) {
+                log_printf("disk(%s) read error: start sect %d, count %d", disk->name, start_sector, count);
+                goto read_end;
+            }
+
+            // 此处再读取数据
+            ata_read_data(disk, buf, disk->sector_size);
         }
-
-        // 这里虽然有调用等待，但是由于已经是操作完毕，所以并不会等
-        int err = ata_wait_data(disk);
-        if (err < 0) {
-            log_printf("disk(%s) read error: start sect %d, count %d", disk->name, start_sector, count);
-            break;
-        }
-
-        // 此处再读取数据
-        ata_read_data(disk, buf, disk->sector_size);
     }
 
+read_end:
     mutex_unlock(disk->mutex);
     return cnt;
 }
 
+/**
+ * @brief 读磁盘
+ */
+int disk_read (device_t * dev, int start_sector, char * buf, int count) {
+    struct iovec iov = {buf, count * SECTOR_SIZE};
+    return disk_readv(dev, start_sector, &iov, 1);
+}
+
 /**
  * @brief 写扇区
  */
@@ -360,6 +378,7 @@ dev_desc_t dev_disk_desc = {
 	.open = disk_open,
 	.read = disk_read,
 	.write = disk_write,
+	.readv = disk_readv,
 	.control = disk_control,
 	.close = disk_close,
 };
@@ -0,0 +1,235 @@
+/**
+ * 图形模式下的帧缓存显示
+ *
+ * loader切换到VBE线性帧缓存模式后，控制台的字符用8x16字体画到帧缓存上。
+ * 字体默认为内核自带的ASCII字体，也可配置为使用loader从BIOS中复制的完整字体。
+ * 帧缓存按写合并方式映射，读取很慢，所以只写不读：另存一份屏幕上已画出的字符，
+ * 刷新时逐个比较，只重画有变化的字符。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "dev/fb.h"
+#include "core/memory.h"
+#include "tools/klib.h"
+#include "tools/log.h"
+
+static fb_t fb;
+
+// VGA文本模式的16色，像素格式为0x00RRGGBB
+static const uint32_t fb_palette[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+
+/**
+ * @brief 在row行col列画出字符
+ */
+static void fb_draw_char (int row, int col, disp_char_t ch) {
+    uint32_t fg = fb_palette[ch.foreground & 0xF];
+    uint32_t bg = fb_palette[ch.background & 0x7];
+    const uint8_t * glyph = fb.font + (uint8_t)ch.c * FB_FONT_HEIGHT;
+    uint32_t * dst = fb.base + row * FB_FONT_HEIGHT * fb.pitch + col * FB_FONT_WIDTH;
+
+    // 每像素一次32位写入，展开一行的8个像素
+    for (int y = 0; y < FB_FONT_HEIGHT; y++, dst += fb.pitch) {
+        uint8_t bits = glyph[y];
+        dst[0] = (bits & 0x80) ? fg : bg;
+        dst[1] = (bits & 0x40) ? fg : bg;
+        dst[2] = (bits & 0x20) ? fg : bg;
+        dst[3] = (bits & 0x10) ? fg : bg;
+        dst[4] = (bits & 0x08) ? fg : bg;
+        dst[5] = (bits & 0x04) ? fg : bg;
+        dst[6] = (bits & 0x02) ? fg : bg;
+        dst[7] = (bits & 0x01) ? fg : bg;
+    }
+}
+
+/**
+ * @brief 用字符的前景色在底部画出光标
+ */
+static void fb_draw_cursor (int row, int col) {
+    disp_char_t ch = fb.screen[row * fb.cols + col];
+    uint32_t fg = fb_palette[ch.foreground & 0xF];
+    uint32_t * dst = fb.base + ((row + 1) * FB_FONT_HEIGHT - FB_CURSOR_HEIGHT) * fb.pitch + col * FB_FONT_WIDTH;
+
+    for (int y = 0; y < FB_CURSOR_HEIGHT; y++, dst += fb.pitch) {
+        for (int x = 0; x < FB_FONT_WIDTH; x++) {
+            dst[x] = fg;
+        }
+    }
+}
+
+/**
+ * @brief 擦除已画出的光标
+ */
+static void fb_erase_cursor (void) {
+    if (fb.cursor_row >= 0) {
+        fb_draw_char(fb.cursor_row, fb.cursor_col, fb.screen[fb.cursor_row * fb.cols + fb.cursor_col]);
+        fb.cursor_row = -1;
+    }
+}
+
+/**
+ * @brief 记录loader设置的图形模式，在内存管理初始化前调用。仍为文本模式时返回-1
+ */
+int fb_init (boot_info_t * boot_info) {
+    if ((boot_info->fb_addr == 0) || (boot_info->fb_bpp != 32)) {
+        return -1;
+    }
+
+    fb.width = boot_info->fb_width;
+    fb.height = boot_info->fb_height;
+    fb.pitch = boot_info->fb_pitch / sizeof(uint32_t);
+    fb.cols = fb.width / FB_FONT_WIDTH;
+    fb.rows = fb.height / FB_FONT_HEIGHT;
+    if (fb.cols > CONSOLE_COL_MAX) {
+        fb.cols = CONSOLE_COL_MAX;
+    }
+    if (fb.rows > CONSOLE_ROW_MAX) {
+        fb.rows = CONSOLE_ROW_MAX;
+    }
+
+#if BOOT_FB_BIOS_FONT
+    // 字体暂时使用loader中的，启用时再复制
+    fb.font = boot_info->fb_font;
+#endif
+    return 0;
+}
+
+/**
+ * @brief 用内核自带的ASCII字体生成256个字符的字体。没有点阵的字符中，
+ * 控制字符显示为空白，其余显示为方框
+ */
+static void fb_load_font (uint8_t * font) {
+    for (int c = 0; c < 256; c++) {
+        uint8_t * glyph = font + c * FB_FONT_HEIGHT;
+        if ((c >= FB_FONT_FIRST) && (c <= FB_FONT_LAST)) {
+            kernel_memcpy(glyph, (void *)(fb_font_ascii + (c - FB_FONT_FIRST) * FB_FONT_HEIGHT), FB_FONT_HEIGHT);
+        } else if (c < FB_FONT_FIRST) {
+            kernel_memset(glyph, 0, FB_FONT_HEIGHT);
+        } else {
+            for (int y = 0; y < FB_FONT_HEIGHT; y++) {
+                glyph[y] = ((y < 2) || (y > 11)) ? 0x00 : ((y == 2) || (y == 11)) ? 0x7C : 0x44;
+            }
+        }
+    }
+}
+
+/**
+ * @brief 开始使用帧缓存，需在内存管理初始化、帧缓存映射之后调用
+ */
+int fb_enable (void) {
+    if (!fb_present()) {
+        return -1;
+    }
+
+    uint8_t * font = (uint8_t *)memory_alloc_page();
+    int screen_pages = up2(fb.cols * fb.rows * sizeof(disp_char_t), MEM_PAGE_SIZE) / MEM_PAGE_SIZE;
+    fb.screen = (disp_char_t *)memory_alloc_pages(screen_pages);
+    if (!font || !fb.screen) {
+        log_printf("fb: no memory");
+        goto fb_enable_failed;
+    }
+
+    if (fb.font) {
+        // loader所在的内存以后可能被覆盖，BIOS字体复制一份
+        kernel_memcpy(font, fb.font, BOOT_FONT_SIZE);
+    } else {
+        fb_load_font(font);
+    }
+    fb.font = font;
+
+    fb.base = (uint32_t *)MEM_FB_START;
+    fb.cursor_visible = 1;
+    fb_invalidate();
+
+    log_printf("fb: %dx%d, %d cols x %d rows", fb.width, fb.height, fb.cols, fb.rows);
+    return 0;
+
+fb_enable_failed:
+    if (font) {
+        memory_free_page((uint32_t)font);
+    }
+    if (fb.screen) {
+        memory_free_pages((uint32_t)fb.screen, screen_pages);
+        fb.screen = (disp_char_t *)0;
+    }
+    return -1;
+}
+
+/**
+ * @brief loader是否已切换到图形模式
+ */
+int fb_present (void) {
+    return fb.cols != 0;
+}
+
+/**
+ * @brief 是否已开始使用帧缓存
+ */
+int fb_enabled (void) {
+    return fb.base != (uint32_t *)0;
+}
+
+/**
+ * @brief 取字符网格的大小
+ */
+void fb_get_size (int * cols, int * rows) {
+    *cols = fb.cols;
+    *rows = fb.rows;
+}
+
+/**
+ * @brief 显示第row行的count个字符，只重画与屏幕上不同的字符
+ */
+void fb_draw_line (int row, const disp_char_t * line, int count) {
+    disp_char_t * screen = fb.screen + row * fb.cols;
+
+    for (int col = 0; col < count; col++) {
+        if (screen[col].v != line[col].v) {
+            screen[col] = line[col];
+            fb_draw_char(row, col, line[col]);
+
+            // 光标所在的字符被重画，光标也被覆盖了
+            if ((row == fb.cursor_row) && (col == fb.cursor_col)) {
+                fb.cursor_row = -1;
+            }
+        }
+    }
+}
+
+/**
+ * @brief 将光标移到row行col列
+ */
+void fb_set_cursor (int row, int col) {
+    if ((row == fb.cursor_row) && (col == fb.cursor_col)) {
+        return;
+    }
+
+    fb_erase_cursor();
+    if (fb.cursor_visible && (row >= 0) && (row < fb.rows) && (col >= 0) && (col < fb.cols)) {
+        fb_draw_cursor(row, col);
+        fb.cursor_row = row;
+        fb.cursor_col = col;
+    }
+}
+
+/**
+ * @brief 显示或隐藏光标
+ */
+void fb_show_cursor (int visible) {
+    fb.cursor_visible = visible;
+    if (!visible) {
+        fb_erase_cursor();
+    }
+}
+
+/**
+ * @brief 屏幕内容全部作废，下次显示时所有字符都重画，用于切换控制台
+ */
+void fb_invalidate (void) {
+    kernel_memset(fb.screen, 0xFF, fb.cols * fb.rows * sizeof(disp_char_t));
+    fb.cursor_row = -1;
+}
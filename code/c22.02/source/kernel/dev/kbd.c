@@ -11,8 +11,12 @@
 #include "tools/log.h"
 #include "tools/klib.h"
 #include "dev/tty.h"
+#include "ipc/sem.h"
+#include "core/task.h"
 
 static kbd_state_t kbd_state;	// 键盘状态
+static kbd_ring_t kbd_ring;		// 待处理的扫描码
+static sem_t kbd_sem;			// 有新扫描码时唤醒处理线程
 
 /**
  * 键盘映射表，分3类
@@ -129,9 +133,13 @@ static void update_led_status (void) {
     int data = 0;
 
     data = (kbd_state.caps_lock ? 1 : 0) << 0;
+
+    // 关中断，避免键盘返回的应答被中断处理程序当作扫描码取走
+    irq_state_t state = irq_enter_protection();
     kbd_write(KBD_PORT_DATA, KBD_CMD_RW_LED);
     kbd_write(KBD_PORT_DATA, data);
     kbd_read();
+    irq_leave_protection(state);
 }
 
 static void do_fx_key (int key) {
@@ -141,6 +149,24 @@ static void do_fx_key (int key) {
     }
 }
 
+/**
+ * @brief shift+PgUp/PgDn回看终端的内容，已处理返回1
+ */
+static int do_scroll_key (int key) {
+    if (!kbd_state.lshift_press && !kbd_state.rshift_press) {
+        return 0;
+    }
+
+    if (key == KEY_PAGE_UP) {
+        tty_scroll_view(1);
+        return 1;
+    } else if (key == KEY_PAGE_DOWN) {
+        tty_scroll_view(-1);
+        return 1;
+    }
+    return 0;
+}
+
 /**
  * 处理单字符的标准键
  */
@@ -186,7 +212,8 @@ static void do_normal_key (uint8_t raw_code) {
     case KEY_F12:
     case KEY_SCROLL_LOCK:
     default:
-        if (is_make) {
+        // 小键盘上的PgUp/PgDn没有E0前缀
+        if (is_make && !do_scroll_key(key)) {
             // 根据shift控制取相应的字符，这里有进行大小写转换或者shif转换
             if (kbd_state.rshift_press || kbd_state.lshift_press) {
                 key = map_table[key].func;  // 第2功能
@@ -229,33 +256,25 @@ static void do_e0_key (uint8_t raw_code) {
         case KEY_ALT:
             kbd_state.ralt_press = is_make;  // 仅设置标志位
             break;
+        case KEY_PAGE_UP:
+        case KEY_PAGE_DOWN:
+            if (is_make) {
+                do_scroll_key(key);
+            }
+            break;
     }
 }
 
 /**
- * @brief 按键中断处理程序
+ * @brief 处理一个扫描码，在处理线程中调用
  */
-void do_handler_kbd(exception_frame_t *frame) {
+static void do_raw_code (uint8_t raw_code) {
     static enum {
     	NORMAL,				// 普通，无e0或e1
 		BEGIN_E0,			// 收到e0字符
 		BEGIN_E1,			// 收到e1字符
     }recv_state = NORMAL;
 
-	// 检查是否有数据，无数据则退出
-	uint8_t status = inb(KBD_PORT_STAT);
-	if (!(status & KBD_STAT_RECV_READY)) {
-        pic_send_eoi(IRQ1_KEYBOARD);
-		return;
-	}
-
-	// 读取键值
-    uint8_t raw_code = inb(KBD_PORT_DATA);
-
-	// 读取完成之后，就可以发EOI，方便后续继续响应键盘中断
-	// 否则,键值的处理过程可能略长，将导致中断响应延迟
-    pic_send_eoi(IRQ1_KEYBOARD);
-
     // 实测qemu下收不到E0和E1，估计是没有发出去
     // 方向键、HOME/END等键码和小键盘上发出来的完全一样。不清楚原因
     // 也许是键盘布局的问题？所以，这里就忽略小键盘？
@@ -281,6 +300,75 @@ void do_handler_kbd(exception_frame_t *frame) {
 	}
 }
 
+/**
+ * @brief 按键中断处理程序，只将扫描码存入缓存，由处理线程解码
+ */
+void do_handler_kbd(exception_frame_t *frame) {
+	// 检查是否有数据，无数据则退出
+	uint8_t status = inb(KBD_PORT_STAT);
+	if (!(status & KBD_STAT_RECV_READY)) {
+        pic_send_eoi(IRQ1_KEYBOARD);
+		return;
+	}
+
+	// 读取键值
+    uint8_t raw_code = inb(KBD_PORT_DATA);
+    pic_send_eoi(IRQ1_KEYBOARD);
+
+    // 缓存满时丢弃并计数
+    if (kbd_ring.head - kbd_ring.tail < KBD_RING_SIZE) {
+        kbd_ring.buf[kbd_ring.head & (KBD_RING_SIZE - 1)] = raw_code;
+        kbd_ring.head++;
+    } else {
+        kbd_ring.dropped++;
+    }
+
+    if (kbd_ring.waiting) {
+        kbd_ring.waiting = 0;
+        sem_notify(&kbd_sem);
+    }
+}
+
+/**
+ * @brief 扫描码处理线程：解码、更新按键状态、切换终端，并将字符送入tty
+ */
+static void kbd_worker (void * arg) {
+    uint32_t reported = 0;
+
+    for (;;) {
+        irq_state_t state = irq_enter_protection();
+        kbd_ring.waiting = (kbd_ring.head == kbd_ring.tail);
+        int idle = kbd_ring.waiting;
+        irq_leave_protection(state);
+
+        if (idle) {
+            sem_wait(&kbd_sem);
+            continue;
+        }
+
+        while (kbd_ring.tail != kbd_ring.head) {
+            uint8_t raw_code = kbd_ring.buf[kbd_ring.tail & (KBD_RING_SIZE - 1)];
+            kbd_ring.tail++;
+            do_raw_code(raw_code);
+        }
+
+        if (kbd_ring.dropped != reported) {
+            log_printk(LOG_WARN, "kbd: %d scancodes dropped", kbd_ring.dropped - reported);
+            reported = kbd_ring.dropped;
+        }
+    }
+}
+
+/**
+ * @brief 启动扫描码处理线程，需在任务管理初始化后调用。此前的按键暂存在缓存中
+ */
+void kbd_worker_init (void) {
+    sem_init(&kbd_sem, 0);
+
+    task_t * task = kthread_create("kbd", kbd_worker, (void *)0);
+    ASSERT(task != (task_t *)0);
+}
+
 /**
  * 键盘硬件初始化
  */
@@ -0,0 +1,74 @@
+/**
+ * 内核日志设备
+ *
+ * 以/dev/kmsg的形式读出日志缓存中的内容。每个打开的文件各自记录读位置，
+ * 读到缓存末尾时返回0，不等待新的日志。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "dev/dev.h"
+#include "tools/klib.h"
+#include "tools/log.h"
+
+#define KMSG_CHUNK_SIZE         128     // 每次从日志缓存中取出的量
+
+static int kmsg_open (device_t * dev) {
+    return 0;
+}
+
+/**
+ * @brief 不记录位置的读取，总是从最早的日志开始
+ */
+static int kmsg_read (device_t * dev, int addr, char * buf, int size) {
+    int pos = 0;
+    return log_read(&pos, buf, size);
+}
+
+/**
+ * @brief 从pos处读取日志。先取到内核栈中再复制，避免访问用户缓存时关着中断
+ */
+static int kmsg_read_pos (device_t * dev, int * pos, char * buf, int size) {
+    char chunk[KMSG_CHUNK_SIZE];
+    int total = 0;
+
+    while (total < size) {
+        int count = size - total;
+        if (count > sizeof(chunk)) {
+            count = sizeof(chunk);
+        }
+
+        count = log_read(pos, chunk, count);
+        if (count == 0) {
+            break;
+        }
+        kernel_memcpy(buf + total, chunk, count);
+        total += count;
+    }
+
+    return total;
+}
+
+static int kmsg_write (device_t * dev, int addr, char * buf, int size) {
+    return -1;
+}
+
+static int kmsg_control (device_t * dev, int cmd, int arg0, int arg1) {
+    return -1;
+}
+
+static void kmsg_close (device_t * dev) {
+}
+
+// 内核日志设备描述表
+dev_desc_t dev_kmsg_desc = {
+	.name = "kmsg",
+	.major = DEV_KMSG,
+	.open = kmsg_open,
+	.read = kmsg_read,
+	.write = kmsg_write,
+	.control = kmsg_control,
+	.close = kmsg_close,
+	.read_pos = kmsg_read_pos,
+};
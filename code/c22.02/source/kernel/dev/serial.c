@@ -0,0 +1,157 @@
+/**
+ * 串口终端
+ *
+ * 作为ttyS0接入tty，输入输出的处理与控制台终端相同。
+ * 收发都由IRQ4中断驱动：收到数据时批量取出FIFO中的字节送入tty，
+ * 发送FIFO空时一次从输出队列中取出至多16字节填满FIFO，输出队列取空后关闭发送中断。
+ * 中断未开启时(如启动早期的日志)，改为直接查询发送。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "dev/serial.h"
+#include "dev/kbd.h"
+#include "comm/cpu_instr.h"
+#include "cpu/cpu.h"
+#include "cpu/irq.h"
+#include "tools/log.h"
+
+static tty_t * serial_tty;          // 串口对应的tty，未打开时为0
+static uint8_t serial_ier;          // 当前的中断使能设置
+
+static inline uint8_t serial_inb (int reg) {
+    return inb(SERIAL_COM1_PORT + reg);
+}
+
+static inline void serial_outb (int reg, uint8_t data) {
+    outb(SERIAL_COM1_PORT + reg, data);
+}
+
+/**
+ * @brief 发送FIFO空时，从输出队列中取出数据填满FIFO。需在中断保护中调用
+ */
+static void serial_tx_fill (tty_t * tty) {
+    if (!(serial_inb(SERIAL_REG_LSR) & SERIAL_LSR_TX_EMPTY)) {
+        return;
+    }
+
+    char buf[SERIAL_FIFO_SIZE];
+    int count = tty_fifo_get_buf(&tty->ofifo, buf, sizeof(buf));
+    for (int i = 0; i < count; i++) {
+        serial_outb(SERIAL_REG_DATA, buf[i]);
+    }
+
+    if (count) {
+        sem_notify_n(&tty->osem, count);
+    } else if (serial_ier & SERIAL_IER_TX) {
+        // 没有数据可发，关闭发送中断，有新的输出时再打开
+        serial_ier &= ~SERIAL_IER_TX;
+        serial_outb(SERIAL_REG_IER, serial_ier);
+    }
+}
+
+/**
+ * @brief 启动输出队列中数据的发送
+ */
+int serial_write (tty_t * tty) {
+    irq_state_t state = irq_enter_protection();
+    if (state & EFLAGS_IF) {
+        // 打开发送中断，之后由中断逐批发送
+        serial_tx_fill(tty);
+        if (!(serial_ier & SERIAL_IER_TX)) {
+            serial_ier |= SERIAL_IER_TX;
+            serial_outb(SERIAL_REG_IER, serial_ier);
+        }
+    } else {
+        // 中断未开启，只能查询发送，避免写者一直等待输出空间
+        char c;
+        while (tty_fifo_get(&tty->ofifo, &c) == 0) {
+            while (!(serial_inb(SERIAL_REG_LSR) & SERIAL_LSR_TX_EMPTY)) {}
+            serial_outb(SERIAL_REG_DATA, c);
+            sem_notify_n(&tty->osem, 1);
+        }
+    }
+    irq_leave_protection(state);
+    return 0;
+}
+
+/**
+ * @brief 取出接收FIFO中的所有数据送入tty
+ * 终端的回车转为换行，退格转为删除，与键盘输入一致
+ */
+static void serial_rx (tty_t * tty) {
+    while (serial_inb(SERIAL_REG_LSR) & SERIAL_LSR_RX_READY) {
+        char c = serial_inb(SERIAL_REG_DATA);
+        if (c == '\r') {
+            c = '\n';
+        } else if (c == '\b') {
+            c = ASCII_DEL;
+        }
+        tty_put_in(tty, c);
+    }
+}
+
+/**
+ * @brief COM1中断处理，处理完所有待处理的中断源
+ */
+void do_handler_com1 (exception_frame_t * frame) {
+    pic_send_eoi(IRQ4_COM1);
+
+    tty_t * tty = serial_tty;
+    if (!tty) {
+        return;
+    }
+
+    uint8_t iir;
+    while (!((iir = serial_inb(SERIAL_REG_IIR)) & SERIAL_IIR_NONE)) {
+        switch (SERIAL_IIR_ID(iir)) {
+        case SERIAL_IIR_RX:
+        case SERIAL_IIR_RX_TIMEOUT:
+            serial_rx(tty);
+            break;
+        case SERIAL_IIR_TX:
+            serial_tx_fill(tty);
+            break;
+        case SERIAL_IIR_LINE:
+            serial_inb(SERIAL_REG_LSR);
+            break;
+        default:
+            serial_inb(SERIAL_REG_MSR);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 初始化COM1：38400波特率，8位数据，无校验，1位停止位，开启FIFO
+ * 先用回环模式检查串口是否存在
+ */
+int serial_init (tty_t * tty) {
+    serial_outb(SERIAL_REG_IER, 0x00);
+    serial_outb(SERIAL_REG_LCR, 0x80);      // DLAB=1，设置除数
+    serial_outb(SERIAL_REG_DATA, 0x03);     // 115200 / 3 = 38400
+    serial_outb(SERIAL_REG_IER, 0x00);
+    serial_outb(SERIAL_REG_LCR, 0x03);      // 8N1
+    serial_outb(SERIAL_REG_FCR, 0xC7);      // 开启并清空FIFO，接收14字节时中断
+
+    serial_outb(SERIAL_REG_MCR, 0x1E);      // 回环模式
+    serial_outb(SERIAL_REG_DATA, 0xAE);
+    if (serial_inb(SERIAL_REG_DATA) != 0xAE) {
+        log_printf("serial port not found");
+        return -1;
+    }
+
+    // 正常模式，OUT2打开才能产生中断
+    serial_outb(SERIAL_REG_MCR, 0x0B);
+
+    irq_state_t state = irq_enter_protection();
+    serial_tty = tty;
+    serial_ier = SERIAL_IER_RX | SERIAL_IER_LINE;
+    serial_outb(SERIAL_REG_IER, serial_ier);
+    irq_leave_protection(state);
+
+    irq_install(IRQ4_COM1, (irq_handler_t)exception_handler_com1);
+    irq_enable(IRQ4_COM1);
+    return 0;
+}
@@ -7,19 +7,30 @@
 #include "comm/cpu_instr.h"
 #include "os_cfg.h"
 #include "core/task.h"
+#include "core/vdso.h"
+#include "tools/log.h"
 
 static uint32_t sys_tick;						// 系统启动后的tick数量
 
+/**
+ * @brief 取系统启动后的tick数量
+ */
+uint32_t time_get_tick (void) {
+    return sys_tick;
+}
+
 /**
  * 定时器中断处理函数
  */
 void do_handler_timer (exception_frame_t *frame) {
     sys_tick++;
+    vdso_tick(sys_tick);
 
     // 先发EOI，而不是放在最后
     // 放最后将从任务中切换出去之后，除非任务再切换回来才能继续噢应
     pic_send_eoi(IRQ0_TIMER);
 
+    log_tick();
     task_time_tick();
 }
 
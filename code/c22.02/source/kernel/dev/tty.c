@@ -1,6 +1,6 @@
 /**
  * 终端tty
- * 目前只考虑处理cooked模式的处理
+ * 支持规范模式和非规范模式，非规范模式下按VMIN/VTIME决定读取何时返回
  *
  * 创建时间：2021年8月5日
  * 作者：李述铜
@@ -9,11 +9,14 @@
 #include "dev/tty.h"
 #include "dev/console.h"
 #include "dev/kbd.h"
+#include "dev/serial.h"
 #include "dev/dev.h"
 #include "tools/log.h"
 #include "cpu/irq.h"
+#include "tools/klib.h"
+#include "fs/poll.h"
 
-static tty_t tty_devs[TTY_NR];
+static tty_t tty_devs[TTY_NR + TTY_SERIAL_NR];
 static int curr_tty = 0;
 
 /**
@@ -63,12 +66,62 @@ int tty_fifo_put (tty_fifo_t * fifo, char c) {
 	return 0;
 }
 
+/**
+ * @brief 取出最多size字节的数据，最多分两段拷贝，返回取出的量
+ */
+int tty_fifo_get_buf (tty_fifo_t * fifo, char * buf, int size) {
+	irq_state_t state = irq_enter_protection();
+	int count = fifo->count < size ? fifo->count : size;
+
+	int first = fifo->size - fifo->read;
+	if (first > count) {
+		first = count;
+	}
+	kernel_memcpy(buf, fifo->buf + fifo->read, first);
+	kernel_memcpy(buf + first, fifo->buf, count - first);
+
+	fifo->read += count;
+	if (fifo->read >= fifo->size) {
+		fifo->read -= fifo->size;
+	}
+	fifo->count -= count;
+	irq_leave_protection(state);
+	return count;
+}
+
+/**
+ * @brief 写入最多size字节的数据，返回写入的量
+ */
+int tty_fifo_put_buf (tty_fifo_t * fifo, const char * buf, int size) {
+	irq_state_t state = irq_enter_protection();
+	int count = fifo->size - fifo->count;
+	if (count > size) {
+		count = size;
+	}
+
+	// 先写到缓存末尾，回绕的部分再从头写
+	int first = fifo->size - fifo->write;
+	if (first > count) {
+		first = count;
+	}
+	kernel_memcpy(fifo->buf + fifo->write, (void *)buf, first);
+	kernel_memcpy(fifo->buf, (void *)(buf + first), count - first);
+
+	fifo->write += count;
+	if (fifo->write >= fifo->size) {
+		fifo->write -= fifo->size;
+	}
+	fifo->count += count;
+	irq_leave_protection(state);
+	return count;
+}
+
 /**
  * @brief 判断tty是否有效
  */
 static inline tty_t * get_tty (device_t * dev) {
 	int tty = dev->minor;
-	if ((tty < 0) || (tty >= TTY_NR) || (!dev->open_count)) {
+	if ((tty < 0) || (tty >= TTY_NR + TTY_SERIAL_NR) || (!dev->open_count)) {
 		log_printf("tty is not opened. tty = %d", tty);
 		return (tty_t *)0;
 	}
@@ -81,7 +134,7 @@ static inline tty_t * get_tty (device_t * dev) {
  */
 int tty_open (device_t * dev)  {
 	int idx = dev->minor;
-	if ((idx < 0) || (idx >= TTY_NR)) {
+	if ((idx < 0) || (idx >= TTY_NR + TTY_SERIAL_NR)) {
 		log_printf("open tty failed. incorrect tty num = %d", idx);
 		return -1;
 	}
@@ -92,10 +145,22 @@ int tty_open (device_t * dev)  {
 	tty_fifo_init(&tty->ififo, tty->ibuf, TTY_IBUF_SIZE);
 	sem_init(&tty->isem, 0);
 
-	tty->iflags = TTY_INLCR | TTY_IECHO;
+	tty->iflags = TTY_INLCR | TTY_IECHO | TTY_ICANON;
 	tty->oflags = TTY_OCRLF;
+	tty->vmin = 1;
+	tty->vtime = 0;
+	tty->in_dropped = 0;
+	list_init(&tty->poll_list);
+
+	// 串口tty的输入输出都由串口中断处理
+	if (idx >= TTY_NR) {
+		tty->console_idx = -1;
+		tty->start_out = serial_write;
+		return serial_init(tty);
+	}
 
 	tty->console_idx = idx;
+	tty->start_out = console_write;
 
 	kbd_init();
 	console_init(idx);
@@ -105,6 +170,8 @@ int tty_open (device_t * dev)  {
 
 /**
  * @brief 向tty写入数据
+ * 每次预留一批输出缓存空间，转换后整批放入，缓存用完时才输出到控制台，
+ * 其余的在最后一次性输出
  */
 int tty_write (device_t * dev, int addr, char * buf, int size) {
 	if (size < 0) {
@@ -112,33 +179,82 @@ int tty_write (device_t * dev, int addr, char * buf, int size) {
 	}
 
 	tty_t * tty = get_tty(dev);
+	char chunk[TTY_WRITE_CHUNK];
 	int len = 0;
+	int cr_done = 0;			// 当前的\n前已经插入了\r
 
-	// 先将所有数据写入缓存中
-	while (size) {
-		char c = *buf++;
-
-		// 如果遇到\n，根据配置决定是否转换成\r\n
-		if (c == '\n' && (tty->oflags & TTY_OCRLF)) {
-			sem_wait(&tty->osem);
-			int err = tty_fifo_put(&tty->ofifo, '\r');
-			if (err < 0) {
-				break;
+	while (len < size) {
+		// 最多只预留剩余字节数，每个字节至少占用一个位置，预留的空间总能用完。
+		// 否则多出的空间没有人归还，缓存会越来越小
+		int need = size - len;
+		int reserved = sem_wait_n(&tty->osem, need < TTY_WRITE_CHUNK ? need : TTY_WRITE_CHUNK);
+
+		int cnt = 0;
+		while ((cnt < reserved) && (len < size)) {
+			char c = buf[len];
+
+			// 如果遇到\n，根据配置决定是否转换成\r\n
+			if ((c == '\n') && (tty->oflags & TTY_OCRLF) && !cr_done) {
+				chunk[cnt++] = '\r';
+				cr_done = 1;
+				continue;
 			}
+
+			chunk[cnt++] = c;
+			cr_done = 0;
+			len++;
+		}
+
+		// 空间已预留，一定能全部放入
+		tty_fifo_put_buf(&tty->ofifo, chunk, cnt);
+
+		// 缓存已满，先输出，腾出空间
+		if (sem_count(&tty->osem) == 0) {
+			tty->start_out(tty);
 		}
+	}
+
+	// 启动输出，控制台直接输出，串口由中断逐批发送
+	tty->start_out(tty);
+	return len;
+}
 
-		// 写入当前字符
-		sem_wait(&tty->osem);
-		int err = tty_fifo_put(&tty->ofifo, c);
-		if (err < 0) {
+/**
+ * @brief 非规范模式下读取，不处理删除键和行结束符
+ * 已读到VMIN个字节后只取已有的数据；VTIME不为0时，VMIN为0则为等待首字节的时间，
+ * 否则为字节间的间隔时间
+ */
+static int tty_read_raw (device_t * dev, tty_t * tty, char * buf, int size) {
+	int vmin = tty->vmin < size ? tty->vmin : size;
+	int len = 0;
+
+	while (len < size) {
+		if (len < vmin) {
+			// 还未读够，有间隔时间且已收到数据时限时等待，否则一直等
+			if (tty->vtime && len) {
+				if (sem_wait_timeout(&tty->isem, tty->vtime * 100) < 0) {
+					break;
+				}
+			} else {
+				sem_wait(&tty->isem);
+			}
+		} else if ((len == 0) && tty->vtime) {
+			// VMIN为0，等待首字节
+			if (sem_wait_timeout(&tty->isem, tty->vtime * 100) < 0) {
+				break;
+			}
+		} else if (sem_wait_timeout(&tty->isem, 0) < 0) {
+			// 已满足要求，只取已有的数据
 			break;
 		}
 
-		len++;
-		size--;
+		char ch;
+		tty_fifo_get(&tty->ififo, &ch);
+		buf[len++] = ch;
 
-		// 启动输出, 这里是直接由console直接输出，无需中断
-		console_write(tty);
+		if (tty->iflags & TTY_IECHO) {
+		    tty_write(dev, 0, &ch, 1);
+		}
 	}
 
 	return len;
@@ -153,6 +269,10 @@ int tty_read (device_t * dev, int addr, char * buf, int size) {
 	}
 
 	tty_t * tty = get_tty(dev);
+	if (!(tty->iflags & TTY_ICANON)) {
+		return tty_read_raw(dev, tty, buf, size);
+	}
+
 	char * pbuf = buf;
 	int len = 0;
 
@@ -199,6 +319,49 @@ int tty_read (device_t * dev, int addr, char * buf, int size) {
 	return len;
 }
 
+/**
+ * @brief 显示或隐藏控制台的光标，串口没有光标
+ */
+static void tty_set_cursor (tty_t * tty, int visiable) {
+	if (tty->console_idx >= 0) {
+		console_set_cursor(tty->console_idx, visiable);
+	}
+}
+
+/**
+ * @brief 将tty的设置转换为termios
+ */
+static void tty_get_attr (tty_t * tty, struct termios * t) {
+	kernel_memset(t, 0, sizeof(struct termios));
+	t->c_iflag = (tty->iflags & TTY_INLCR) ? INLCR : 0;
+	t->c_oflag = (tty->oflags & TTY_OCRLF) ? ONLCR : 0;
+	t->c_lflag = ((tty->iflags & TTY_IECHO) ? ECHO : 0) | ((tty->iflags & TTY_ICANON) ? ICANON : 0);
+	t->c_cc[VMIN] = tty->vmin;
+	t->c_cc[VTIME] = tty->vtime;
+}
+
+/**
+ * @brief 按termios修改tty的设置，回显关闭时同时隐藏光标
+ */
+static void tty_set_attr (tty_t * tty, const struct termios * t) {
+	int iflags = 0;
+	if (t->c_iflag & INLCR) {
+		iflags |= TTY_INLCR;
+	}
+	if (t->c_lflag & ECHO) {
+		iflags |= TTY_IECHO;
+	}
+	if (t->c_lflag & ICANON) {
+		iflags |= TTY_ICANON;
+	}
+
+	tty->iflags = iflags;
+	tty->oflags = (t->c_oflag & ONLCR) ? TTY_OCRLF : 0;
+	tty->vmin = t->c_cc[VMIN];
+	tty->vtime = t->c_cc[VTIME];
+	tty_set_cursor(tty, iflags & TTY_IECHO);
+}
+
 /**
  * @brief 向tty设备发送命令
  */
@@ -209,10 +372,10 @@ int tty_control (device_t * dev, int cmd, int arg0, int arg1) {
 	case TTY_CMD_ECHO:
 		if (arg0) {
 			tty->iflags |= TTY_IECHO;
-			console_set_cursor(tty->console_idx, 1);
+			tty_set_cursor(tty, 1);
 		} else {
 			tty->iflags &= ~TTY_IECHO;
-			console_set_cursor(tty->console_idx, 0);
+			tty_set_cursor(tty, 0);
 		}
 		break;
 	case TTY_CMD_IN_COUNT:
@@ -220,12 +383,36 @@ int tty_control (device_t * dev, int cmd, int arg0, int arg1) {
 			*(int *)arg0 = sem_count(&tty->isem);
 		}
 		break;
+	case TTY_CMD_GETATTR:
+		if (arg0) {
+			tty_get_attr(tty, (struct termios *)arg0);
+		}
+		break;
+	case TTY_CMD_SETATTR:
+		if (arg0) {
+			tty_set_attr(tty, (struct termios *)arg0);
+		}
+		break;
 	default:
 		break;
 	}
 	return 0;
 }
 
+/**
+ * @brief 查询tty的读写状态，输出直接写到控制台，总是可写
+ * 规范模式下也是有输入即可读，读取时仍可能等待一行结束
+ */
+int tty_poll (device_t * dev, poll_table_t * table) {
+	tty_t * tty = get_tty(dev);
+	if (!tty) {
+		return POLLNVAL;
+	}
+
+	poll_wait(table, &tty->poll_list);
+	return sem_count(&tty->isem) ? (POLLIN | POLLOUT) : POLLOUT;
+}
+
 /**
  * @brief 关闭tty设备
  */
@@ -234,29 +421,54 @@ void tty_close (device_t * dev) {
 }
 
 /**
- * @brief 输入tty字符
+ * @brief 键盘输入的字符，送到当前选中的tty
  */
 void tty_in (char ch) {
-	tty_t * tty = tty_devs + curr_tty;
+	// 有输入时回到最新的内容
+	console_scroll_view(curr_tty, 0);
+	tty_put_in(tty_devs + curr_tty, ch);
+}
 
-	// 辅助队列要有空闲空间可代写入
+/**
+ * @brief 向指定tty输入字符，可在中断或键盘处理线程中调用
+ */
+void tty_put_in (tty_t * tty, char ch) {
+	irq_state_t state = irq_enter_protection();
+
+	// 辅助队列要有空闲空间可代写入，否则丢弃并计数
 	if (sem_count(&tty->isem) >= TTY_IBUF_SIZE) {
+		if ((tty->in_dropped++ % TTY_IBUF_SIZE) == 0) {
+			log_printk(LOG_WARN, "tty%d: input full, %d chars dropped", tty - tty_devs, tty->in_dropped);
+		}
+		irq_leave_protection(state);
 		return;
 	}
 
 	// 写入辅助队列，通知数据到达
 	tty_fifo_put(&tty->ififo, ch);
 	sem_notify(&tty->isem);
+	poll_wakeup(&tty->poll_list);
+	irq_leave_protection(state);
 }
 
 /**
  * @brief 选择tty
  */
 void tty_select (int tty) {
+	// 键盘处理线程中调用，不能与其它进程的切换过程交错
+	irq_state_t state = irq_enter_protection();
 	if (tty != curr_tty) {
 		console_select(tty);
 		curr_tty = tty;
 	}
+	irq_leave_protection(state);
+}
+
+/**
+ * @brief 当前tty的回看翻页，dir为1向前，-1向后
+ */
+void tty_scroll_view (int dir) {
+	console_scroll_view(curr_tty, dir);
 }
 
 // 设备描述表: 描述一个设备所具备的特性
@@ -268,4 +480,5 @@ dev_desc_t dev_tty_desc = {
 	.write = tty_write,
 	.control = tty_control,
 	.close = tty_close,
+	.poll = tty_poll,
 };
\ No newline at end of file
@@ -0,0 +1,165 @@
+/**
+ * 目录项缓存
+ * 按(文件系统, 父目录, 名称)缓存路径中各级的查找结果，包括不存在的名称。
+ * 重复打开同一路径时，只需查哈希表，无需再读目录。
+ * 文件系统不区分大小写时，名称统一转为大写后再缓存，同一文件的不同写法对应同一项
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "fs/dcache.h"
+#include "fs/fs.h"
+#include "tools/klib.h"
+#include "ipc/mutex.h"
+
+static dentry_t dentry_tbl[DCACHE_NR];              // 目录项缓存表
+static list_t hash_tbl[DCACHE_HASH_SIZE];           // 哈希桶
+static list_t lru_list;                             // 替换队列，最近使用的在最前
+static mutex_t dcache_mutex;                        // 访问缓存的互斥信号量
+
+/**
+ * @brief 计算哈希值
+ */
+static int dcache_hash (struct _fs_t * fs, int parent, const char * name) {
+    uint32_t hash = (uint32_t)fs ^ (uint32_t)parent * 31;
+
+    while (*name) {
+        hash = hash * 31 + *name++;
+    }
+    return hash % DCACHE_HASH_SIZE;
+}
+
+/**
+ * @brief 取缓存中使用的名称，不区分大小写时转为大写放在buf中。名称过长不能缓存时返回0
+ */
+static const char * dcache_name (struct _fs_t * fs, const char * name, char * buf) {
+    if (kernel_strlen(name) >= DCACHE_NAME_SIZE) {
+        return (const char *)0;
+    }
+
+    if (!fs->nocase) {
+        return name;
+    }
+
+    char * dest = buf;
+    while (*name) {
+        char c = *name++;
+        *dest++ = ((c >= 'a') && (c <= 'z')) ? c - 'a' + 'A' : c;
+    }
+    *dest = '\0';
+    return buf;
+}
+
+/**
+ * @brief 查找缓存中的目录项，需在持有锁时调用
+ */
+static dentry_t * dcache_find (struct _fs_t * fs, int parent, const char * name) {
+    list_t * bucket = hash_tbl + dcache_hash(fs, parent, name);
+
+    for (list_node_t * node = list_first(bucket); node; node = list_node_next(node)) {
+        dentry_t * dentry = list_node_parent(node, dentry_t, hash_node);
+        if ((dentry->fs == fs) && (dentry->parent == parent)
+                && (kernel_strncmp(dentry->name, name, DCACHE_NAME_SIZE) == 0)) {
+            return dentry;
+        }
+    }
+
+    return (dentry_t *)0;
+}
+
+/**
+ * @brief 初始化目录项缓存
+ */
+void dcache_init (void) {
+    mutex_init(&dcache_mutex);
+    list_init(&lru_list);
+    for (int i = 0; i < DCACHE_HASH_SIZE; i++) {
+        list_init(hash_tbl + i);
+    }
+
+    // 所有项初始时都未使用，放在替换队列的末尾
+    kernel_memset(dentry_tbl, 0, sizeof(dentry_tbl));
+    for (int i = 0; i < DCACHE_NR; i++) {
+        list_insert_last(&lru_list, &dentry_tbl[i].lru_node);
+    }
+}
+
+/**
+ * @brief 查找目录项，找到时拷贝到dentry中，返回0；否则返回-1
+ */
+int dcache_lookup (struct _fs_t * fs, int parent, const char * name, dentry_t * dentry) {
+    char buf[DCACHE_NAME_SIZE];
+    int err = -1;
+
+    name = dcache_name(fs, name, buf);
+    if (!name) {
+        return -1;
+    }
+
+    mutex_lock(&dcache_mutex);
+    dentry_t * curr = dcache_find(fs, parent, name);
+    if (curr) {
+        // 移到替换队列的最前面
+        list_remove(&lru_list, &curr->lru_node);
+        list_insert_first(&lru_list, &curr->lru_node);
+
+        kernel_memcpy(dentry, curr, sizeof(dentry_t));
+        err = 0;
+    }
+    mutex_unlock(&dcache_mutex);
+    return err;
+}
+
+/**
+ * @brief 加入目录项。已存在时更新，否则替换最久未使用的项
+ */
+void dcache_add (struct _fs_t * fs, int parent, const char * name, dentry_t * dentry) {
+    char buf[DCACHE_NAME_SIZE];
+
+    name = dcache_name(fs, name, buf);
+    if (!name) {
+        return;
+    }
+
+    mutex_lock(&dcache_mutex);
+    dentry_t * curr = dcache_find(fs, parent, name);
+    if (!curr) {
+        curr = list_node_parent(list_last(&lru_list), dentry_t, lru_node);
+        if (curr->fs) {
+            list_remove(hash_tbl + dcache_hash(curr->fs, curr->parent, curr->name), &curr->hash_node);
+        }
+
+        curr->fs = fs;
+        curr->parent = parent;
+        kernel_strncpy(curr->name, name, DCACHE_NAME_SIZE);
+        list_insert_first(hash_tbl + dcache_hash(fs, parent, name), &curr->hash_node);
+    }
+
+    curr->negative = dentry->negative;
+    curr->ino = dentry->ino;
+    curr->index = dentry->index;
+    curr->type = dentry->type;
+    list_remove(&lru_list, &curr->lru_node);
+    list_insert_first(&lru_list, &curr->lru_node);
+    mutex_unlock(&dcache_mutex);
+}
+
+/**
+ * @brief 移除某一目录下的所有目录项，在目录内容发生变化时调用
+ */
+void dcache_invalidate_dir (struct _fs_t * fs, int parent) {
+    mutex_lock(&dcache_mutex);
+    for (int i = 0; i < DCACHE_NR; i++) {
+        dentry_t * curr = dentry_tbl + i;
+        if ((curr->fs == fs) && (curr->parent == parent)) {
+            list_remove(hash_tbl + dcache_hash(fs, parent, curr->name), &curr->hash_node);
+            curr->fs = (struct _fs_t *)0;
+
+            // 放到最后，优先被复用
+            list_remove(&lru_list, &curr->lru_node);
+            list_insert_last(&lru_list, &curr->lru_node);
+        }
+    }
+    mutex_unlock(&dcache_mutex);
+}
@@ -11,14 +11,26 @@
 #include "tools/klib.h"
 #include "tools/log.h"
 #include "fs/file.h"
+#include "dev/tty.h"
 
-// 设备文件系统中支持的设备
+// 设备文件系统中支持的设备，按名称前缀匹配，较长的名称要放在前面
 static devfs_type_t devfs_type_list[] = {
+    {
+        .name = "ttyS",
+        .dev_type = DEV_TTY,
+        .file_type = FILE_TTY,
+        .minor_base = TTY_NR,
+    },
     {
         .name = "tty",
         .dev_type = DEV_TTY,
         .file_type = FILE_TTY,
-    }
+    },
+    {
+        .name = "kmsg",
+        .dev_type = DEV_KMSG,
+        .file_type = FILE_DEV,
+    },
 };
 /**
  * @brief 挂载指定设备
@@ -49,7 +61,7 @@ int devfs_open (struct _fs_t * fs, const char * path, file_t * file) {
 
         // 如果存在挂载点路径，则跳过该路径，取下级子目录
         if (kernel_strncmp(path, type->name, type_name_len) == 0) {
-            int minor;
+            int minor = 0;
 
             // 转换得到设备子序号
             if ((kernel_strlen(path) > type_name_len) && (path_to_num(path + type_name_len, &minor)) < 0) {
@@ -58,7 +70,7 @@ int devfs_open (struct _fs_t * fs, const char * path, file_t * file) {
             }
 
             // 打开设备
-            int dev_id = dev_open(type->dev_type, minor, (void *)0);
+            int dev_id = dev_open(type->dev_type, minor + type->minor_base, (void *)0);
             if (dev_id < 0) {
                 log_printf("Open device failed:%s", path);
                 break;
@@ -81,7 +93,7 @@ int devfs_open (struct _fs_t * fs, const char * path, file_t * file) {
  * @brief 读写指定的文件系统
  */
 int devfs_read (char * buf, int size, file_t * file) {
-    return dev_read(file->dev_id, file->pos, buf, size);
+    return dev_read_pos(file->dev_id, &file->pos, buf, size);
 }
 
 /**
@@ -119,6 +131,13 @@ int devfs_ioctl(file_t * file, int cmd, int arg0, int arg1) {
     return dev_control(file->dev_id, cmd, arg0, arg1);
 }
 
+/**
+ * @brief 查询设备的读写状态
+ */
+int devfs_poll (file_t * file, poll_table_t * table) {
+    return dev_poll(file->dev_id, table);
+}
+
 // 设备文件系统
 fs_op_t devfs_op = {
     .mount = devfs_mount,
@@ -130,4 +149,5 @@ fs_op_t devfs_op = {
     .stat = devfs_stat,
     .close = devfs_close,
     .ioctl = devfs_ioctl,
+    .poll = devfs_poll,
 };
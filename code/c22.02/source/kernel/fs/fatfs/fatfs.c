@@ -12,6 +12,34 @@
 #include "tools/klib.h"
 #include <sys/fcntl.h>
 
+/**
+ * @brief 将缓存中被修改过的扇区写回磁盘
+ * FAT表的修改先只在缓存中进行，在切换缓存扇区或一次操作结束时统一写回，
+ * 如果是FAT表中的扇区，需要同时写入所有的FAT表
+ */
+static int fat_flush (fat_t * fat) {
+    if (!fat->dirty) {
+        return 0;
+    }
+
+    int sector = fat->curr_sector;
+    int copy_cnt = 1;
+    if ((sector >= fat->tbl_start) && (sector < fat->tbl_start + fat->tbl_sectors)) {
+        copy_cnt = fat->tbl_cnt;
+    }
+
+    for (int i = 0; i < copy_cnt; i++, sector += fat->tbl_sectors) {
+        int cnt = dev_write(fat->fs->dev_id, sector, fat->fat_buffer, 1);
+        if (cnt != 1) {
+            log_printf("write cluster failed.");
+            return -1;
+        }
+    }
+
+    fat->dirty = 0;
+    return 0;
+}
+
 /**
  * @brief 缓存读取磁盘数据，用于目录的遍历等
  */
@@ -20,11 +48,19 @@ static int bread_sector (fat_t * fat, int sector) {
         return 0;
     }
 
+    // 切换前，先将修改过的数据写回
+    int err = fat_flush(fat);
+    if (err < 0) {
+        return -1;
+    }
+
     int cnt = dev_read(fat->fs->dev_id, sector, fat->fat_buffer, 1);
     if (cnt == 1) {
         fat->curr_sector = sector;
         return 0;
     }
+
+    fat->curr_sector = -1;
     return -1;
 }
 
@@ -33,18 +69,26 @@ static int bread_sector (fat_t * fat, int sector) {
  */
 static int bwrite_secotr (fat_t * fat, int sector) {
     int cnt = dev_write(fat->fs->dev_id, sector, fat->fat_buffer, 1);
-    return (cnt == 1) ? 0 : -1;
+    if (cnt != 1) {
+        return -1;
+    }
+
+    if (sector == fat->curr_sector) {
+        fat->dirty = 0;
+    }
+    return 0;
 }
 
 /**
  * 检查指定簇是否可用，非占用或坏簇
  */
 int cluster_is_valid (cluster_t cluster) {
-    return (cluster < 0xFFF8) && (cluster >= 0x2);     // 值是否正确
+    return (cluster < 0x0FFFFFF7) && (cluster >= 0x2);     // 值是否正确
 }
 
 /**
  * 获取指定簇的下一个簇
+ * FAT16和FAT32的结束标记、坏簇标记统一转换为FAT_CLUSTER_INVALID
  */
 int cluster_get_next (fat_t * fat, cluster_t curr) {
     if (!cluster_is_valid(curr)) {
@@ -52,7 +96,7 @@ int cluster_get_next (fat_t * fat, cluster_t curr) {
     }
 
     // 取fat表中的扇区号和在扇区中的偏移
-    int offset = curr * sizeof(cluster_t);
+    int offset = curr * fat->entry_size;
     int sector = offset / fat->bytes_per_sec;
     int off_sector = offset % fat->bytes_per_sec;
     if (sector >= fat->tbl_sectors) {
@@ -66,18 +110,30 @@ int cluster_get_next (fat_t * fat, cluster_t curr) {
         return FAT_CLUSTER_INVALID;
     }
 
-    return *(cluster_t*)(fat->fat_buffer + off_sector);
+    cluster_t next;
+    if (fat->entry_size == 4) {
+        // FAT32只用低28位
+        next = *(uint32_t *)(fat->fat_buffer + off_sector) & 0x0FFFFFFF;
+    } else {
+        next = *(uint16_t *)(fat->fat_buffer + off_sector);
+        if (next >= 0xFFF7) {
+            next = FAT_CLUSTER_INVALID;
+        }
+    }
+
+    return cluster_is_valid(next) || (next == FAT_CLUSTER_FREE) ? next : FAT_CLUSTER_INVALID;
 }
 
 /**
  * @brief 设置簇的下一簇
+ * 只修改缓存，并同步更新空闲位图，由fat_flush统一写回磁盘
  */
 int cluster_set_next (fat_t * fat, cluster_t curr, cluster_t next) {
-    if (!cluster_is_valid(curr)) {
+    if (!cluster_is_valid(curr) || (curr >= fat->cluster_total)) {
         return -1;
     }
 
-    int offset = curr * sizeof(cluster_t);
+    int offset = curr * fat->entry_size;
     int sector = offset / fat->bytes_per_sec;
     int off_sector = offset % fat->bytes_per_sec;
     if (sector >= fat->tbl_sectors) {
@@ -91,17 +147,23 @@ int cluster_set_next (fat_t * fat, cluster_t curr, cluster_t next) {
         return -1;
     }
 
-    // 改next
-    *(cluster_t*)(fat->fat_buffer + off_sector) = next;
-
-    // 回写到多个表中
-    for (int i = 0; i < fat->tbl_cnt; i++) {
-        err = bwrite_secotr(fat, fat->tbl_start + sector);
-        if (err < 0) {
-            log_printf("write cluster failed.");
-            return -1;
-        }
-        sector += fat->tbl_sectors;
+    // 改next，FAT32的高4位保留不变
+    if (fat->entry_size == 4) {
+        uint32_t * entry = (uint32_t *)(fat->fat_buffer + off_sector);
+        *entry = (*entry & 0xF0000000) | (next & 0x0FFFFFFF);
+    } else {
+        *(uint16_t *)(fat->fat_buffer + off_sector) = (uint16_t)next;
+    }
+    fat->dirty = 1;
+
+    // 同步空闲位图
+    int used = bitmap_is_set(&fat->free_map, curr);
+    if ((next == FAT_CLUSTER_FREE) && used) {
+        bitmap_set_bit(&fat->free_map, curr, 1, 0);
+        fat->free_count++;
+    } else if ((next != FAT_CLUSTER_FREE) && !used) {
+        bitmap_set_bit(&fat->free_map, curr, 1, 1);
+        fat->free_count--;
     }
     return 0;
 }
@@ -118,202 +180,987 @@ void cluster_free_chain(fat_t * fat, cluster_t start) {
 }
 
 /**
- * @brief 找一个空闲的cluster
+ * @brief 在空闲位图的[start, end)区间中查找连续count个空闲簇
+ */
+static int free_map_find_run (fat_t * fat, int start, int end, int count) {
+    int run = 0;
+
+    for (int i = start; i < end; i++) {
+        // 整字节都已经占用的，直接跳过
+        if (((i & 0x7) == 0) && (i + 8 <= end) && (fat->free_map.bits[i / 8] == 0xFF)) {
+            run = 0;
+            i += 7;
+            continue;
+        }
+
+        if (bitmap_is_set(&fat->free_map, i)) {
+            run = 0;
+        } else if (++run >= count) {
+            return i - count + 1;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief 根据FAT表建立空闲簇位图
+ */
+static int free_map_init (fat_t * fat) {
+    int page_count = up2(bitmap_byte_count(fat->cluster_total), MEM_PAGE_SIZE) / MEM_PAGE_SIZE;
+    uint8_t * bits = (uint8_t *)memory_alloc_pages(page_count);
+    if (bits == (uint8_t *)0) {
+        log_printf("no memory for fat free map.");
+        return -1;
+    }
+
+    // 先全部视为已占用，再逐个检查FAT表项。由于有扇区缓存，每个扇区只读取一次
+    bitmap_init(&fat->free_map, bits, fat->cluster_total, 1);
+    fat->free_count = 0;
+    for (int i = 2; i < fat->cluster_total; i++) {
+        if (cluster_get_next(fat, i) == FAT_CLUSTER_FREE) {
+            bitmap_set_bit(&fat->free_map, i, 1, 0);
+            fat->free_count++;
+        }
+    }
+
+    fat->next_free = 2;
+    return 0;
+}
+
+/**
+ * @brief 找一个空闲的cluster
+ * 从上次分配的位置开始查找(next-fit)，优先选择连续的簇，不够时再零散分配
+ */
+cluster_t cluster_alloc_free (fat_t * fat, int cnt) {
+    cluster_t pre, start;
+
+    if (cnt > fat->free_count) {
+        return FAT_CLUSTER_INVALID;
+    }
+
+    // 先找连续的空闲区，找不到再从头开始找一次
+    int curr = free_map_find_run(fat, fat->next_free, fat->cluster_total, cnt);
+    if (curr < 0) {
+        int end = fat->next_free + cnt - 1;
+        curr = free_map_find_run(fat, 2, end < fat->cluster_total ? end : fat->cluster_total, cnt);
+        if (curr < 0) {
+            curr = fat->next_free;
+        }
+    }
+
+    pre = start = FAT_CLUSTER_INVALID;
+    while (cnt) {
+        if (curr >= fat->cluster_total) {
+            curr = 2;
+        }
+
+        // 跳过已占用的簇
+        if (bitmap_is_set(&fat->free_map, curr)) {
+            curr++;
+            continue;
+        }
+
+        // 记录首个簇
+        if (!cluster_is_valid(start)) {
+            start = curr;
+        }
+
+        // 前一簇如果有效，则设置。否则忽略掉
+        if (cluster_is_valid(pre)) {
+            // 找到空表项，设置前一表项的链接
+            int err = cluster_set_next(fat, pre, curr);
+            if (err < 0) {
+                goto alloc_failed;
+            }
+        }
+
+        pre = curr++;
+        cnt--;
+    }
+
+    // 最后的结点
+    int err = cluster_set_next(fat, pre, FAT_CLUSTER_INVALID);
+    if (err < 0) {
+        goto alloc_failed;
+    }
+
+    fat->next_free = curr < fat->cluster_total ? curr : 2;
+    return start;
+
+alloc_failed:
+    // 失败，空间不够等问题
+    cluster_free_chain(fat, start);
+    return FAT_CLUSTER_INVALID;
+}
+
+/**
+ * @brief 转换文件名为diritem中的短文件名，如a.txt 转换成a      txt
+ */
+static void to_sfn(char* dest, const char* src) {
+    kernel_memset(dest, ' ', SFN_LEN);
+
+    // 不断生成直到遇到分隔符和写完缓存
+    char * curr = dest;
+    char * end = dest + SFN_LEN;
+    while (*src && (curr < end)) {
+        char c = *src++;
+
+        switch (c) {
+        case '.':       // 隔附，跳到扩展名区，不写字符
+            curr = dest + 8;
+            break;
+        default:
+            if ((c >= 'a') && (c <= 'z')) {
+                c = c - 'a' + 'A';
+            }
+            *curr++ = c;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 判断字符是否不能用于短文件名
+ */
+static int char_is_illegal (char c) {
+    static const char illegal[] = "\"*+,/:;<=>?[\\]|";
+
+    for (const char * curr = illegal; *curr; curr++) {
+        if (*curr == c) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 判断名称是否可直接用短文件名保存：主名1-8个字符，最多一个'.'，扩展名不超过3个字符
+ */
+static int name_is_sfn (const char * name) {
+    int base_len = 0, ext_len = -1;
+
+    for (const char * c = name; *c; c++) {
+        if (*c == '.') {
+            // 多个'.'，或以'.'开头
+            if ((ext_len >= 0) || (base_len == 0)) {
+                return 0;
+            }
+            ext_len = 0;
+        } else if ((*c <= ' ') || (*c & 0x80) || char_is_illegal(*c)) {
+            return 0;
+        } else if (ext_len >= 0) {
+            ext_len++;
+        } else {
+            base_len++;
+        }
+    }
+
+    return (base_len >= 1) && (base_len <= 8) && (ext_len <= 3);
+}
+
+/**
+ * @brief 计算短文件名的校验和，保存在对应的各长文件名项中
+ */
+static uint8_t sfn_checksum (const uint8_t * sfn) {
+    uint8_t sum = 0;
+
+    for (int i = 0; i < SFN_LEN; i++) {
+        sum = ((sum & 1) ? 0x80 : 0) + (sum >> 1) + sfn[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief 计算名称的哈希值，不区分大小写
+ */
+static uint32_t name_hash (const char * name) {
+    uint32_t hash = 2166136261u;
+
+    while (*name) {
+        char c = *name++;
+        if ((c >= 'a') && (c <= 'z')) {
+            c = c - 'a' + 'A';
+        }
+        hash = (hash ^ (uint8_t)c) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief 比较两个名称是否相同，不区分大小写
+ */
+static int name_match (const char * name1, const char * name2) {
+    while (*name1 && *name2) {
+        char c1 = *name1++, c2 = *name2++;
+        if ((c1 >= 'a') && (c1 <= 'z')) {
+            c1 = c1 - 'a' + 'A';
+        }
+        if ((c2 >= 'a') && (c2 <= 'z')) {
+            c2 = c2 - 'a' + 'A';
+        }
+        if (c1 != c2) {
+            return 0;
+        }
+    }
+
+    return *name1 == *name2;
+}
+
+/**
+ * 缺省初始化driitem
+ */
+int diritem_init(diritem_t * item, uint8_t attr, const char * sfn) {
+    kernel_memcpy(item->DIR_Name, (void *)sfn, SFN_LEN);
+    item->DIR_FstClusHI = 0;
+    item->DIR_FstClusL0 = 0;
+    item->DIR_FileSize = 0;
+    item->DIR_Attr = attr;
+    item->DIR_NTRes = 0;
+
+    // 时间写固定值，简单方便
+    item->DIR_CrtTimeTeenth = 0;
+    item->DIR_CrtTime = 0;
+    item->DIR_CrtDate = 0;
+    item->DIR_WrtTime = item->DIR_CrtTime;
+    item->DIR_WrtDate = item->DIR_CrtDate;
+    item->DIR_LastAccDate = item->DIR_CrtDate;
+    return 0;
+}
+
+/**
+ * @brief 获取diritem中的名称，转换成合适
+ */
+void diritem_get_name (diritem_t * item, char * dest) {
+    char * c = dest;
+    char * ext = (char *)0;
+
+    kernel_memset(dest, 0, SFN_LEN + 1);     // 最多11个字符
+    for (int i = 0; i < 11; i++) {
+        if (item->DIR_Name[i] != ' ') {
+            *c++ = item->DIR_Name[i];
+        }
+
+        if (i == 7) {
+            ext = c;
+            *c++ = '.';
+        }
+    }
+
+    // 没有扩展名的情况
+    if (ext && (ext[1] == '\0')) {
+        ext[0] = '\0';
+    }
+}
+
+/**
+ * @brief 获取文件类型
+ */
+file_type_t diritem_get_type (diritem_t * item) {
+    file_type_t type = FILE_UNKNOWN;
+
+    // 长文件名和volum id
+    if (item->DIR_Attr & (DIRITEM_ATTR_VOLUME_ID | DIRITEM_ATTR_HIDDEN | DIRITEM_ATTR_SYSTEM)) {
+        return FILE_UNKNOWN;
+    }
+
+    return item->DIR_Attr & DIRITEM_ATTR_DIRECTORY ? FILE_DIR : FILE_NORMAL;
+}
+
+/**
+ * @brief 取长文件名项中的13个字符，非ASCII字符以'?'代替
+ */
+static void lfnitem_get_name (lfnitem_t * item, char * dest) {
+    uint16_t chars[LFN_CHARS_PER_ITEM];
+
+    kernel_memcpy(chars, item->LDIR_Name1, sizeof(item->LDIR_Name1));
+    kernel_memcpy(chars + 5, item->LDIR_Name2, sizeof(item->LDIR_Name2));
+    kernel_memcpy(chars + 11, item->LDIR_Name3, sizeof(item->LDIR_Name3));
+    for (int i = 0; i < LFN_CHARS_PER_ITEM; i++) {
+        if ((chars[i] == 0) || (chars[i] == 0xFFFF)) {
+            dest[i] = '\0';
+            break;
+        }
+        dest[i] = chars[i] < 0x80 ? (char)chars[i] : '?';
+    }
+}
+
+/**
+ * @brief 初始化长文件名项，name为该项要存放的13个字符的起始
+ */
+static void lfnitem_init (lfnitem_t * item, int ord, int last, uint8_t chksum, const char * name) {
+    uint16_t chars[LFN_CHARS_PER_ITEM];
+
+    // 名称以0结束，其后的填充0xFFFF
+    int end = 0;
+    for (int i = 0; i < LFN_CHARS_PER_ITEM; i++) {
+        if (end) {
+            chars[i] = 0xFFFF;
+        } else {
+            chars[i] = (uint8_t)name[i];
+            end = (name[i] == '\0');
+        }
+    }
+
+    item->LDIR_Ord = ord | (last ? LFN_ORD_LAST : 0);
+    item->LDIR_Attr = DIRITEM_ATTR_LONG_NAME;
+    item->LDIR_Type = 0;
+    item->LDIR_Chksum = chksum;
+    item->LDIR_FstClusLO = 0;
+    kernel_memcpy(item->LDIR_Name1, chars, sizeof(item->LDIR_Name1));
+    kernel_memcpy(item->LDIR_Name2, chars + 5, sizeof(item->LDIR_Name2));
+    kernel_memcpy(item->LDIR_Name3, chars + 11, sizeof(item->LDIR_Name3));
+}
+
+/**
+ * @brief 初始化目录遍历位置。FAT32的根目录也在数据区中，以簇链存放
+ */
+static void dir_init (fat_t * fat, fat_dir_t * dir, cluster_t start) {
+    if ((start == FAT_ROOT_CLUSTER) && (fat->entry_size == 4)) {
+        start = fat->root_cluster;
+    }
+
+    dir->start = dir->curr = start;
+    dir->curr_index = 0;
+}
+
+/**
+ * @brief 取目录中第index项所在的扇区，以及在扇区中的偏移。超出目录范围返回-1
+ */
+static int dir_entry_sector (fat_t * fat, fat_dir_t * dir, int index, int * offset) {
+    if (index < 0) {
+        return -1;
+    }
+
+    // FAT16的根目录，存放在固定的区域
+    uint32_t byte_offset = index * sizeof(diritem_t);
+    if (dir->start == FAT_ROOT_CLUSTER) {
+        if (index >= fat->root_ent_cnt) {
+            return -1;
+        }
+
+        *offset = byte_offset % fat->bytes_per_sec;
+        return fat->root_start + byte_offset / fat->bytes_per_sec;
+    }
+
+    // 沿簇链找到所在的簇。往前查找时，需要从头开始
+    int cluster_index = byte_offset / fat->cluster_byte_size;
+    if (cluster_index < dir->curr_index) {
+        dir->curr = dir->start;
+        dir->curr_index = 0;
+    }
+
+    while (dir->curr_index < cluster_index) {
+        cluster_t next = cluster_get_next(fat, dir->curr);
+        if (!cluster_is_valid(next)) {
+            return -1;
+        }
+
+        dir->curr = next;
+        dir->curr_index++;
+    }
+
+    uint32_t cluster_offset = byte_offset % fat->cluster_byte_size;
+    *offset = cluster_offset % fat->bytes_per_sec;
+    return fat->data_start + (dir->curr - 2) * fat->sec_per_cluster + cluster_offset / fat->bytes_per_sec;
+}
+
+/**
+ * @brief 在目录中读取diritem
+ */
+static diritem_t * read_dir_entry (fat_t * fat, fat_dir_t * dir, int index) {
+    int offset;
+    int sector = dir_entry_sector(fat, dir, index, &offset);
+    if (sector < 0) {
+        return (diritem_t *)0;
+    }
+
+    int err = bread_sector(fat, sector);
+    if (err < 0) {
+        return (diritem_t *)0;
+    }
+    return (diritem_t *)(fat->fat_buffer + offset);
+}
+
+/**
+ * @brief 写dir目录项
+ */
+static int write_dir_entry (fat_t * fat, fat_dir_t * dir, diritem_t * item, int index) {
+    int offset;
+    int sector = dir_entry_sector(fat, dir, index, &offset);
+    if (sector < 0) {
+        return -1;
+    }
+
+    int err = bread_sector(fat, sector);
+    if (err < 0) {
+        return -1;
+    }
+    kernel_memcpy(fat->fat_buffer + offset, item, sizeof(diritem_t));
+    return bwrite_secotr(fat, sector);
+}
+
+/**
+ * @brief 目录已满时，为其增加一个清空的簇。FAT16的根目录大小固定，不能扩充
+ */
+static int dir_expand (fat_t * fat, fat_dir_t * dir) {
+    if (dir->start == FAT_ROOT_CLUSTER) {
+        return -1;
+    }
+
+    cluster_t cluster = cluster_alloc_free(fat, 1);
+    if (!cluster_is_valid(cluster)) {
+        log_printf("no cluster for dir.");
+        return -1;
+    }
+
+    // 借用缓存清空新簇，此后缓存中不再对应任何扇区
+    if (fat_flush(fat) < 0) {
+        return -1;
+    }
+    fat->curr_sector = -1;
+    kernel_memset(fat->fat_buffer, 0, fat->bytes_per_sec);
+    int sector = fat->data_start + (cluster - 2) * fat->sec_per_cluster;
+    for (int i = 0; i < fat->sec_per_cluster; i++) {
+        if (bwrite_secotr(fat, sector + i) < 0) {
+            return -1;
+        }
+    }
+
+    // 链接到目录的最后一簇之后
+    cluster_t last = dir->start, next;
+    while (cluster_is_valid(next = cluster_get_next(fat, last))) {
+        last = next;
+    }
+    return cluster_set_next(fat, last, cluster);
+}
+
+/**
+ * @brief 从index开始，读取目录中下一个文件，取出其名称和短文件名项
+ * 长文件名项与其后的短文件名项视为一个文件，first为其中第一项的索引。
+ * 返回短文件名项的索引，到达目录末尾时返回-1
+ */
+static int dir_read_next (fat_t * fat, fat_dir_t * dir, int index, char * name, diritem_t * item, int * first) {
+    int lfn_expect = -1;            // 期望的下一个长文件名项序号，-1表示没有有效的长文件名
+    int lfn_first = -1;
+    uint8_t lfn_chksum = 0;
+
+    for (;; index++) {
+        diritem_t * curr = read_dir_entry(fat, dir, index);
+        if ((curr == (diritem_t *)0) || (curr->DIR_Name[0] == DIRITEM_NAME_END)) {
+            return -1;
+        }
+
+        // 空闲项
+        if (curr->DIR_Name[0] == DIRITEM_NAME_FREE) {
+            lfn_expect = -1;
+            continue;
+        }
+
+        // 长文件名项：存放顺序为序号从大到小，第一项带有LFN_ORD_LAST标记
+        if ((curr->DIR_Attr & DIRITEM_ATTR_LONG_NAME_MASK) == DIRITEM_ATTR_LONG_NAME) {
+            lfnitem_t * lfn = (lfnitem_t *)curr;
+            int ord = lfn->LDIR_Ord & LFN_ORD_MASK;
+            if ((ord == 0) || (ord > LFN_ITEM_MAX)) {
+                lfn_expect = -1;
+            } else if (lfn->LDIR_Ord & LFN_ORD_LAST) {
+                lfn_first = index;
+                lfn_chksum = lfn->LDIR_Chksum;
+                name[ord * LFN_CHARS_PER_ITEM] = '\0';
+                lfnitem_get_name(lfn, name + (ord - 1) * LFN_CHARS_PER_ITEM);
+                lfn_expect = ord - 1;
+            } else if ((ord == lfn_expect) && (lfn->LDIR_Chksum == lfn_chksum)) {
+                lfnitem_get_name(lfn, name + (ord - 1) * LFN_CHARS_PER_ITEM);
+                lfn_expect = ord - 1;
+            } else {
+                lfn_expect = -1;
+            }
+            continue;
+        }
+
+        // 卷标以及'.'和'..'项不作为文件
+        if ((curr->DIR_Attr & DIRITEM_ATTR_VOLUME_ID) || (curr->DIR_Name[0] == '.')) {
+            lfn_expect = -1;
+            continue;
+        }
+
+        // 长文件名各项完整且与短文件名相符时，才使用长文件名
+        kernel_memcpy(item, curr, sizeof(diritem_t));
+        if ((lfn_expect == 0) && (lfn_chksum == sfn_checksum(item->DIR_Name))) {
+            *first = lfn_first;
+        } else {
+            diritem_get_name(item, name);
+            *first = index;
+        }
+        return index;
+    }
+}
+
+/**
+ * @brief 检查目录中是否已有指定的短文件名
+ */
+static int dir_sfn_exist (fat_t * fat, fat_dir_t * dir, const char * sfn) {
+    for (int index = 0; ; index++) {
+        diritem_t * item = read_dir_entry(fat, dir, index);
+        if ((item == (diritem_t *)0) || (item->DIR_Name[0] == DIRITEM_NAME_END)) {
+            return 0;
+        }
+
+        if (((item->DIR_Attr & DIRITEM_ATTR_LONG_NAME_MASK) != DIRITEM_ATTR_LONG_NAME)
+                && (kernel_memcmp(item->DIR_Name, (void *)sfn, SFN_LEN) == 0)) {
+            return 1;
+        }
+    }
+}
+
+/**
+ * @brief 为长文件名生成目录中唯一的短文件名，形如LONGNA~1.TXT
+ */
+static int dir_make_sfn (fat_t * fat, fat_dir_t * dir, const char * name, char * sfn) {
+    char basis[8], ext[3];
+    int basis_len = 0, ext_len = 0;
+
+    // 扩展名取最后一个'.'之后的部分
+    const char * dot = (const char *)0;
+    for (const char * c = name; *c; c++) {
+        if (*c == '.') {
+            dot = c;
+        }
+    }
+
+    // 去掉空格和'.'，转成大写，非法字符用'_'代替
+    kernel_memset(ext, ' ', sizeof(ext));
+    for (const char * c = name; *c; c++) {
+        char ch = *c;
+        if ((ch == ' ') || ((ch == '.') && (c != dot))) {
+            continue;
+        } else if ((ch >= 'a') && (ch <= 'z')) {
+            ch = ch - 'a' + 'A';
+        } else if ((ch & 0x80) || char_is_illegal(ch)) {
+            ch = '_';
+        }
+
+        if (dot && (c > dot)) {
+            if (ext_len < sizeof(ext)) {
+                ext[ext_len++] = ch;
+            }
+        } else if ((c != dot) && (basis_len < sizeof(basis))) {
+            basis[basis_len++] = ch;
+        }
+    }
+
+    // 尝试添加~1、~2等后缀，直到不重复
+    for (int n = 1; n < 100000; n++) {
+        char tail[8];
+        int tail_len = kernel_snprintf(tail, sizeof(tail), "~%d", n);
+        int keep = basis_len < 8 - tail_len ? basis_len : 8 - tail_len;
+
+        kernel_memset(sfn, ' ', SFN_LEN);
+        kernel_memcpy(sfn, basis, keep);
+        kernel_memcpy(sfn + keep, tail, tail_len);
+        kernel_memcpy(sfn + 8, ext, sizeof(ext));
+        if (!dir_sfn_exist(fat, dir, sfn)) {
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief 在目录中查找连续count个空闲项，不够时扩充目录
+ */
+static int dir_alloc_entries (fat_t * fat, fat_dir_t * dir, int count) {
+    int free_cnt = 0;
+
+    for (int index = 0; ; index++) {
+        diritem_t * item = read_dir_entry(fat, dir, index);
+        if (item == (diritem_t *)0) {
+            // 目录已满，结束项之后的都是空闲项，扩充后继续
+            if (dir_expand(fat, dir) < 0) {
+                return -1;
+            }
+
+            item = read_dir_entry(fat, dir, index);
+            if (item == (diritem_t *)0) {
+                return -1;
+            }
+        }
+
+        if ((item->DIR_Name[0] == DIRITEM_NAME_FREE) || (item->DIR_Name[0] == DIRITEM_NAME_END)) {
+            if (++free_cnt >= count) {
+                return index - count + 1;
+            }
+        } else {
+            free_cnt = 0;
+        }
+    }
+}
+
+/**
+ * @brief 查找或创建目录的名称索引
+ */
+static fat_dindex_t * dindex_get (fat_t * fat, cluster_t dir_start, int create) {
+    fat_dindex_t * free = (fat_dindex_t *)0;
+
+    for (int i = 0; i < FAT_DINDEX_NR; i++) {
+        fat_dindex_t * dindex = (fat_dindex_t *)((uint8_t *)fat->dindex_tbl + i * MEM_PAGE_SIZE);
+        if (dindex->used && (dindex->dir == dir_start)) {
+            dindex->last_used = ++fat->dindex_seq;
+            return dindex;
+        }
+
+        // 记录空闲或最久未使用的一项，用于创建
+        if (!free || (free->used && (!dindex->used || (dindex->last_used < free->last_used)))) {
+            free = dindex;
+        }
+    }
+
+    if (!create) {
+        return (fat_dindex_t *)0;
+    }
+
+    free->dir = dir_start;
+    free->used = 1;
+    free->complete = 0;
+    free->last_used = ++fat->dindex_seq;
+    free->node_count = 0;
+    free->free_node = -1;
+    kernel_memset(free->bucket, 0xFF, sizeof(free->bucket));
+    return free;
+}
+
+/**
+ * @brief 向目录名称索引中加入一个文件，空间不够时返回-1
+ */
+static int dindex_insert (fat_dindex_t * dindex, uint32_t hash, int index, int first) {
+    int node_nr = (MEM_PAGE_SIZE - sizeof(fat_dindex_t)) / sizeof(fat_dnode_t);
+
+    // 优先使用回收的结点
+    int n = dindex->free_node;
+    if (n >= 0) {
+        dindex->free_node = dindex->node[n].next;
+    } else if (dindex->node_count < node_nr) {
+        n = dindex->node_count++;
+    } else {
+        dindex->complete = 0;
+        return -1;
+    }
+
+    fat_dnode_t * node = dindex->node + n;
+    int bucket = hash % FAT_DINDEX_HASH_SIZE;
+    node->hash = hash;
+    node->index = index;
+    node->first = first;
+    node->next = dindex->bucket[bucket];
+    dindex->bucket[bucket] = n;
+    return 0;
+}
+
+/**
+ * @brief 从目录名称索引中移除目录项index处的文件
+ * 调用者给出的名称可能与建立索引时的写法不同，哈希值不可靠，所以按索引在所有桶中查找
+ */
+static void dindex_remove (fat_dindex_t * dindex, int index) {
+    for (int bucket = 0; bucket < FAT_DINDEX_HASH_SIZE; bucket++) {
+        int16_t * prev = dindex->bucket + bucket;
+
+        while (*prev >= 0) {
+            fat_dnode_t * node = dindex->node + *prev;
+            if (node->index == index) {
+                // 带长文件名的文件有长、短两个名称的结点，都要移除
+                int n = *prev;
+                *prev = node->next;
+                node->next = dindex->free_node;
+                dindex->free_node = n;
+                continue;
+            }
+            prev = &node->next;
+        }
+    }
+}
+
+/**
+ * @brief 将文件加入名称索引。带长文件名的，短文件名(如LONGFI~1.TXT)也可用于查找，同样加入
+ */
+static int dindex_add_entry (fat_dindex_t * dindex, const char * name, diritem_t * item, int index, int first) {
+    if (dindex_insert(dindex, name_hash(name), index, first) < 0) {
+        return -1;
+    }
+
+    if (first != index) {
+        char sfn_name[FAT_NAME_SIZE];
+        diritem_get_name(item, sfn_name);
+        return dindex_insert(dindex, name_hash(sfn_name), index, first);
+    }
+    return 0;
+}
+
+/**
+ * @brief 比较目录项的名称，带长文件名的同时比较其短文件名
+ */
+static int dir_entry_match (const char * name, const char * curr_name, diritem_t * item, int index, int first) {
+    if (name_match(curr_name, name)) {
+        return 1;
+    }
+
+    if (first != index) {
+        char sfn_name[FAT_NAME_SIZE];
+        diritem_get_name(item, sfn_name);
+        return name_match(sfn_name, name);
+    }
+    return 0;
+}
+
+/**
+ * @brief 扫描整个目录，建立名称索引
+ */
+static fat_dindex_t * dindex_build (fat_t * fat, fat_dir_t * dir) {
+    fat_dindex_t * dindex = dindex_get(fat, dir->start, 1);
+    char name[FAT_NAME_SIZE];
+    diritem_t item;
+    int first;
+
+    for (int index = 0; (index = dir_read_next(fat, dir, index, name, &item, &first)) >= 0; index++) {
+        if (dindex_add_entry(dindex, name, &item, index, first) < 0) {
+            // 空间不够，只索引了部分文件
+            return dindex;
+        }
+    }
+
+    dindex->complete = 1;
+    return dindex;
+}
+
+/**
+ * @brief 在目录中查找指定名称的文件，名称不区分大小写，带长文件名的也可用短文件名查找
+ * 优先通过目录的名称索引查找，索引在首次查找时建立
+ */
+static int dir_find (fat_t * fat, fat_dir_t * dir, const char * name, diritem_t * item, int * index, int * first) {
+    char curr_name[FAT_NAME_SIZE];
+    uint32_t hash = name_hash(name);
+
+    fat_dindex_t * dindex = dindex_get(fat, dir->start, 0);
+    if (!dindex) {
+        dindex = dindex_build(fat, dir);
+    }
+
+    // 同一哈希桶中，哈希值相同的再比较名称
+    for (int n = dindex->bucket[hash % FAT_DINDEX_HASH_SIZE]; n >= 0; n = dindex->node[n].next) {
+        fat_dnode_t * node = dindex->node + n;
+        if (node->hash != hash) {
+            continue;
+        }
+
+        int curr = dir_read_next(fat, dir, node->first, curr_name, item, first);
+        if ((curr == node->index) && dir_entry_match(name, curr_name, item, curr, *first)) {
+            *index = curr;
+            return 0;
+        }
+    }
+
+    // 索引中包含了全部的文件，找不到就是不存在
+    if (dindex->complete) {
+        return -1;
+    }
+
+    // 逐项查找
+    for (int curr = 0; (curr = dir_read_next(fat, dir, curr, curr_name, item, first)) >= 0; curr++) {
+        if (dir_entry_match(name, curr_name, item, curr, *first)) {
+            *index = curr;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 在目录中创建新的文件。名称不符合8.3格式时，额外创建长文件名项
  */
-cluster_t cluster_alloc_free (fat_t * fat, int cnt) {
-    cluster_t pre, curr, start;
-    int c_total = fat->tbl_sectors * fat->bytes_per_sec / sizeof(cluster_t);
+static int dir_create (fat_t * fat, fat_dir_t * dir, const char * name, uint8_t attr, diritem_t * item, int * index) {
+    char sfn[SFN_LEN];
+    int lfn_cnt = 0;
 
-    pre = start = FAT_CLUSTER_INVALID;
-    for (curr = 2; (curr< c_total) && cnt; curr++) {
-        cluster_t free = cluster_get_next(fat, curr);
-        if (free == FAT_CLUSTER_FREE) {
-            // 记录首个簇
-            if (!cluster_is_valid(start)) {
-                start = curr;
-            } 
-        
-            // 前一簇如果有效，则设置。否则忽略掉
-            if (cluster_is_valid(pre)) {
-                // 找到空表项，设置前一表项的链接
-                int err = cluster_set_next(fat, pre, curr);
-                if (err < 0) {
-                    cluster_free_chain(fat, start);
-                    return FAT_CLUSTER_INVALID;
-                }
-            }
+    int name_len = kernel_strlen(name);
+    if ((name_len == 0) || (name_len >= FAT_NAME_SIZE - 1)) {
+        return -1;
+    }
 
-            pre = curr;
-            cnt--;
+    if (name_is_sfn(name)) {
+        to_sfn(sfn, name);
+    } else {
+        lfn_cnt = up2(name_len, LFN_CHARS_PER_ITEM) / LFN_CHARS_PER_ITEM;
+        if (dir_make_sfn(fat, dir, name, sfn) < 0) {
+            return -1;
         }
     }
 
-    // 最后的结点
-    if (cnt == 0) {
-        int err = cluster_set_next(fat, pre, FAT_CLUSTER_INVALID);
-        if (err == 0) {
-            return start;
-        }
+    // 分配连续的空闲项
+    int first = dir_alloc_entries(fat, dir, lfn_cnt + 1);
+    if (first < 0) {
+        log_printf("no free dir entry.");
+        return -1;
     }
 
-    // 失败，空间不够等问题
-    cluster_free_chain(fat, start);
-    return FAT_CLUSTER_INVALID;
-}
+    // 先写长文件名项，序号从大到小
+    uint8_t chksum = sfn_checksum((uint8_t *)sfn);
+    for (int i = 0; i < lfn_cnt; i++) {
+        int ord = lfn_cnt - i;
+        lfnitem_t lfn;
 
-/**
- * @brief 转换文件名为diritem中的短文件名，如a.txt 转换成a      txt
- */
-static void to_sfn(char* dest, const char* src) {
-    kernel_memset(dest, ' ', SFN_LEN);
+        lfnitem_init(&lfn, ord, i == 0, chksum, name + (ord - 1) * LFN_CHARS_PER_ITEM);
+        if (write_dir_entry(fat, dir, (diritem_t *)&lfn, first + i) < 0) {
+            return -1;
+        }
+    }
 
-    // 不断生成直到遇到分隔符和写完缓存
-    char * curr = dest;
-    char * end = dest + SFN_LEN;
-    while (*src && (curr < end)) {
-        char c = *src++;
+    // 最后写短文件名项
+    diritem_init(item, attr, sfn);
+    *index = first + lfn_cnt;
+    if (write_dir_entry(fat, dir, item, *index) < 0) {
+        return -1;
+    }
 
-        switch (c) {
-        case '.':       // 隔附，跳到扩展名区，不写字符
-            curr = dest + 8;
-            break;
-        default:
-            if ((c >= 'a') && (c <= 'z')) {
-                c = c - 'a' + 'A';
-            }
-            *curr++ = c;
-            break;
-        }
+    // 已有名称索引时，同步加入
+    fat_dindex_t * dindex = dindex_get(fat, dir->start, 0);
+    if (dindex) {
+        dindex_add_entry(dindex, name, item, *index, first);
     }
+    return 0;
 }
 
 /**
- * @brief 判断item项是否与指定的名称相匹配
+ * @brief 为打开的文件分配簇链缓存，没有空闲的则不缓存
  */
-int diritem_name_match (diritem_t * item, const char * path) {
-    char buf[SFN_LEN];
-    to_sfn(buf, path);
-    return kernel_memcmp(buf, item->DIR_Name, SFN_LEN) == 0;
+static fat_emap_t * emap_alloc (fat_t * fat) {
+    int count = MEM_PAGE_SIZE / sizeof(fat_emap_t);
+    for (int i = 0; i < count; i++) {
+        fat_emap_t * map = fat->emap_tbl + i;
+        if (!map->used) {
+            map->used = 1;
+            map->count = 0;
+            map->covered = 0;
+            return map;
+        }
+    }
+
+    return (fat_emap_t *)0;
 }
 
 /**
- * 缺省初始化driitem
+ * @brief 段数已满时隔一段丢弃一段，保留首段和最后一段
+ * 被丢弃部分的簇，以后从前一段的末尾沿簇链查找，查找距离仍受限
  */
-int diritem_init(diritem_t * item, uint8_t attr,const char * name) {
-    to_sfn((char *)item->DIR_Name, name);
-    item->DIR_FstClusHI = (uint16_t )(FAT_CLUSTER_INVALID >> 16);
-    item->DIR_FstClusL0 = (uint16_t )(FAT_CLUSTER_INVALID & 0xFFFF);
-    item->DIR_FileSize = 0;
-    item->DIR_Attr = attr;
-    item->DIR_NTRes = 0;
-
-    // 时间写固定值，简单方便
-    item->DIR_CrtTime = 0;
-    item->DIR_CrtDate = 0;
-    item->DIR_WrtTime = item->DIR_CrtTime;
-    item->DIR_WrtDate = item->DIR_CrtDate;
-    item->DIR_LastAccDate = item->DIR_CrtDate;
-    return 0;
+static void emap_thin (fat_emap_t * map) {
+    int keep = 0;
+    for (int i = 0; i < map->count; i++) {
+        if ((i % 2 == 0) || (i == map->count - 1)) {
+            map->extent[keep++] = map->extent[i];
+        }
+    }
+    map->count = keep;
 }
 
 /**
- * @brief 获取diritem中的名称，转换成合适
+ * @brief 记录文件中第index簇对应的簇号
+ * 只记录紧接在已查找部分之后的簇，与最后一段相连的直接合并
  */
-void diritem_get_name (diritem_t * item, char * dest) {
-    char * c = dest;
-    char * ext = (char *)0;
+static void emap_record (fat_emap_t * map, uint32_t index, cluster_t cluster) {
+    if (!map || (index != map->covered)) {
+        return;
+    }
 
-    kernel_memset(dest, 0, SFN_LEN + 1);     // 最多11个字符
-    for (int i = 0; i < 11; i++) {
-        if (item->DIR_Name[i] != ' ') {
-            *c++ = item->DIR_Name[i];
+    fat_extent_t * last = map->count ? map->extent + map->count - 1 : (fat_extent_t *)0;
+    if (last && (last->start + last->count == cluster)) {
+        last->count++;
+    } else {
+        if (map->count >= FAT_EXTENT_NR) {
+            emap_thin(map);
         }
 
-        if (i == 7) {
-            ext = c;
-            *c++ = '.';
-        }
+        last = map->extent + map->count++;
+        last->index = index;
+        last->start = cluster;
+        last->count = 1;
     }
 
-    // 没有扩展名的情况
-    if (ext && (ext[1] == '\0')) {
-        ext[0] = '\0';
-    }
+    map->covered++;
 }
 
 /**
- * @brief 获取文件类型
+ * @brief 在缓存中查找文件中第index簇，或其之前离它最近的已缓存簇
+ * known返回找到的簇在文件中的序号；没有缓存时返回FAT_CLUSTER_INVALID
  */
-file_type_t diritem_get_type (diritem_t * item) {
-    file_type_t type = FILE_UNKNOWN;
+static cluster_t emap_lookup (fat_emap_t * map, uint32_t index, uint32_t * known) {
+    if (!map || (map->count == 0)) {
+        return FAT_CLUSTER_INVALID;
+    }
 
-    // 长文件名和volum id
-    if (item->DIR_Attr & (DIRITEM_ATTR_VOLUME_ID | DIRITEM_ATTR_HIDDEN | DIRITEM_ATTR_SYSTEM)) {
-        return FILE_UNKNOWN;
+    // 二分查找所在的段，首段总是从文件开头开始
+    int low = 0, high = map->count - 1;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (map->extent[mid].index <= index) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
     }
 
-    return item->DIR_Attr & DIRITEM_ATTR_DIRECTORY ? FILE_DIR : FILE_NORMAL;
+    fat_extent_t * extent = map->extent + low;
+    uint32_t offset = index - extent->index;
+    if (offset >= extent->count) {
+        offset = extent->count - 1;
+    }
+    *known = extent->index + offset;
+    return extent->start + offset;
 }
 
 /**
- * @brief 在root目录中读取diritem
+ * @brief 取文件中第index簇的簇号，超出簇链时返回FAT_CLUSTER_INVALID
+ * 优先查缓存，查不到时从之前最近的已缓存簇开始沿簇链查找，并将新经过的簇加入缓存
  */
-static diritem_t * read_dir_entry (fat_t * fat, int index) {
-    if ((index < 0) || (index >= fat->root_ent_cnt)) {
-        return (diritem_t *)0;
+static cluster_t file_get_cluster (fat_t * fat, file_t * file, uint32_t index) {
+    fat_emap_t * map = (fat_emap_t *)file->data;
+    if (!cluster_is_valid(file->sblk)) {
+        return FAT_CLUSTER_INVALID;
     }
 
-    int offset = index * sizeof(diritem_t);
-    int err = bread_sector(fat, fat->root_start + offset / fat->bytes_per_sec);
-    if (err < 0) {
-        return (diritem_t *)0;
+    // 确定查找的起点
+    uint32_t curr_index = 0;
+    cluster_t cluster = emap_lookup(map, index, &curr_index);
+    if (!cluster_is_valid(cluster)) {
+        curr_index = 0;
+        cluster = file->sblk;
+        emap_record(map, 0, cluster);
     }
-    return (diritem_t *)(fat->fat_buffer + offset % fat->bytes_per_sec);
-}
 
-/**
- * @brief 写dir目录项
- */
-static int write_dir_entry (fat_t * fat, diritem_t * item, int index) {
-    if ((index < 0) || (index >= fat->root_ent_cnt)) {
-        return -1;
-    }
+    while (curr_index < index) {
+        cluster = cluster_get_next(fat, cluster);
+        if (!cluster_is_valid(cluster)) {
+            return FAT_CLUSTER_INVALID;
+        }
 
-    int offset = index * sizeof(diritem_t);
-    int sector = fat->root_start + offset / fat->bytes_per_sec;
-    int err = bread_sector(fat, sector);
-    if (err < 0) {
-        return -1;
+        emap_record(map, ++curr_index, cluster);
     }
-    kernel_memcpy(fat->fat_buffer + offset % fat->bytes_per_sec, item, sizeof(diritem_t));
-    return bwrite_secotr(fat, sector);
+    return cluster;
 }
 
-
 /**
- * @brief 更改文件大小, 此时当前族号已经到达了最后的簇号
+ * @brief 更改文件大小，为超出已分配簇的部分分配新簇并链接到簇链末尾
  */
 static int expand_file(file_t * file, int inc_bytes) {
     fat_t * fat = (fat_t *)file->fs->data;
-    
-    int cluster_cnt;
-    if ((file->size == 0) || (file->size % fat->cluster_byte_size == 0)) {
-        // 文件为空，或者刚好达到的簇的末尾
-        cluster_cnt = up2(inc_bytes, fat->cluster_byte_size) / fat->cluster_byte_size; 
-    } else {
-        // 文件非空，当前簇的空闲量，如果空间够增长，则直接退出了
-        // 例如：大小为2048，再扩充1024,簇大小为1024
-        int cfree = fat->cluster_byte_size - (file->size % fat->cluster_byte_size);
-        if (cfree >= inc_bytes) {
-            file->size += inc_bytes;
-            return 0;
-        }
 
-        // 不够，则分配新簇用来放额外的空间
-        cluster_cnt = up2(inc_bytes - cfree, fat->cluster_byte_size) / fat->cluster_byte_size; 
+    // 已分配的簇数和扩充后需要的簇数，如果已分配的簇够用，则无需处理
+    // 例如：大小为2048，再扩充1024,簇大小为4096
+    int cluster_have = up2(file->size, fat->cluster_byte_size) / fat->cluster_byte_size;
+    int cluster_need = up2(file->size + inc_bytes, fat->cluster_byte_size) / fat->cluster_byte_size;
+    if (cluster_need <= cluster_have) {
+        return 0;
     }
 
-    cluster_t start = cluster_alloc_free(fat, cluster_cnt);
+    cluster_t start = cluster_alloc_free(fat, cluster_need - cluster_have);
     if (!cluster_is_valid(start)) {
         log_printf("no cluster for file write");
         return -1;
@@ -321,34 +1168,45 @@ static int expand_file(file_t * file, int inc_bytes) {
 
     // 在文件关闭时，回写
     if (!cluster_is_valid(file->sblk)) {
-        file->cblk = file->sblk = start;
+        file->sblk = start;
     } else {
-        // 建立链接关系
-        int err = cluster_set_next(fat, file->cblk, start);
+        // 找到簇链的最后一簇，建立链接关系
+        cluster_t last = file_get_cluster(fat, file, cluster_have ? cluster_have - 1 : 0);
+        cluster_t next;
+        while (cluster_is_valid(next = cluster_get_next(fat, last))) {
+            last = next;
+        }
+
+        int err = cluster_set_next(fat, last, start);
         if (err < 0) {
             return -1;
         }
     }
 
+    // 当前位置已经走到了原簇链之外，则正好落在新分配的第一簇上
+    if (!cluster_is_valid(file->cblk)) {
+        file->cblk = start;
+    }
     return 0;
 }
 
 /**
- * @brief 移动文件指针
+ * @brief 移动文件指针，可一次跨越多个簇
  */
 static int move_file_pos(file_t* file, fat_t * fat, uint32_t move_bytes, int expand) {
 	uint32_t c_offset = file->pos % fat->cluster_byte_size;
 
-    // 跨簇，则调整curr_cluster。注意，如果已经是最后一个簇了，则curr_cluster不会调整
+    // 跨簇，则调整curr_cluster。注意，如果已经是最后一个簇了，curr_cluster将变为无效
 	if (c_offset + move_bytes >= fat->cluster_byte_size) {
-        cluster_t next = cluster_get_next(fat, file->cblk);
+        uint32_t index = (file->pos + move_bytes) / fat->cluster_byte_size;
+        cluster_t next = file_get_cluster(fat, file, index);
 		if ((next == FAT_CLUSTER_INVALID) && expand) {
             int err = expand_file(file, fat->cluster_byte_size);
             if (err < 0) {
                 return -1;
             }
 
-            next = cluster_get_next(fat, file->cblk);
+            next = file_get_cluster(fat, file, index);
         }
 
         file->cblk = next;
@@ -358,6 +1216,42 @@ static int move_file_pos(file_t* file, fat_t * fat, uint32_t move_bytes, int exp
 	return 0;
 }
 
+/**
+ * @brief 计算文件当前位置所在的扇区号
+ */
+static int file_curr_sector (fat_t * fat, file_t * file) {
+    uint32_t cluster_offset = file->pos % fat->cluster_byte_size;
+    return fat->data_start + (file->cblk - 2) * fat->sec_per_cluster + cluster_offset / fat->bytes_per_sec;   // 从2开始
+}
+
+/**
+ * @brief 从当前位置起，计算簇链中物理上连续的扇区数量，最多不超过max_sectors
+ * 当前位置必须在扇区边界上，由此可以将多个连续簇合并成一次磁盘读写
+ */
+static int file_run_sectors (fat_t * fat, file_t * file, int max_sectors) {
+    if (max_sectors > FAT_RUN_MAX_SECTORS) {
+        max_sectors = FAT_RUN_MAX_SECTORS;
+    }
+
+    // 先取当前簇中剩余的扇区
+    int sectors = fat->sec_per_cluster - (file->pos % fat->cluster_byte_size) / fat->bytes_per_sec;
+
+    // 不够，再看后续的簇是否紧挨着当前簇
+    cluster_t curr = file->cblk;
+    uint32_t index = file->pos / fat->cluster_byte_size;
+    while (sectors < max_sectors) {
+        cluster_t next = file_get_cluster(fat, file, ++index);
+        if (!cluster_is_valid(next) || (next != curr + 1)) {
+            break;
+        }
+
+        sectors += fat->sec_per_cluster;
+        curr = next;
+    }
+
+    return sectors > max_sectors ? max_sectors : sectors;
+}
+
 /**
  * @brief 挂载fat文件系统
  */
@@ -388,33 +1282,73 @@ int fatfs_mount (struct _fs_t * fs, int dev_major, int dev_minor) {
     fat->fat_buffer = (uint8_t *)dbr;
     fat->bytes_per_sec = dbr->BPB_BytsPerSec;
     fat->tbl_start = dbr->BPB_RsvdSecCnt;
-    fat->tbl_sectors = dbr->BPB_FATSz16;
+    fat->tbl_sectors = dbr->BPB_FATSz16 ? dbr->BPB_FATSz16 : dbr->fat32.BPB_FATSz32;
     fat->tbl_cnt = dbr->BPB_NumFATs;
     fat->root_ent_cnt = dbr->BPB_RootEntCnt;
     fat->sec_per_cluster = dbr->BPB_SecPerClus;
     fat->cluster_byte_size = fat->sec_per_cluster * dbr->BPB_BytsPerSec;
 	fat->root_start = fat->tbl_start + fat->tbl_sectors * fat->tbl_cnt;
-    fat->data_start = fat->root_start + fat->root_ent_cnt * 32 / SECTOR_SIZE;
+    fat->data_start = fat->root_start + up2(fat->root_ent_cnt * sizeof(diritem_t), fat->bytes_per_sec) / fat->bytes_per_sec;
     fat->curr_sector = -1;
+    fat->dirty = 0;
     fat->fs = fs;
     mutex_init(&fat->mutex);
     fs->mutex = &fat->mutex;
+    fs->nocase = 1;
 
-	// 简单检查是否是fat16文件系统, 可以在下边做进一步的更多检查。此处只检查做一点点检查
-	if (fat->tbl_cnt != 2) {
+	// 简单检查是否是fat文件系统, 可以在下边做进一步的更多检查。此处只检查做一点点检查
+	if ((fat->tbl_cnt != 2) || (fat->sec_per_cluster == 0) || (fat->tbl_sectors == 0)) {
         log_printf("fat table num error, major: %x, minor: %x", dev_major, dev_minor);
 		goto mount_failed;
 	}
 
-    if (kernel_memcmp(dbr->BS_FileSysType, "FAT16", 5) != 0) {
-        log_printf("not a fat16 file system, major: %x, minor: %x", dev_major, dev_minor);
+    // 按规范，FAT类型只由数据区的簇数量决定，与BS_FileSysType中的字符串无关
+    uint32_t total_sectors = dbr->BPB_TotSec16 ? dbr->BPB_TotSec16 : dbr->BPB_TotSec32;
+    uint32_t data_clusters = (total_sectors - fat->data_start) / fat->sec_per_cluster;
+    if (data_clusters < FAT12_CLUSTER_MAX) {
+        log_printf("fat12 not supported, major: %x, minor: %x", dev_major, dev_minor);
         goto mount_failed;
+    } else if (data_clusters < FAT16_CLUSTER_MAX) {
+        fat->entry_size = 2;
+        fat->root_cluster = FAT_ROOT_CLUSTER;
+        fs->type = FS_FAT16;
+    } else {
+        fat->entry_size = 4;
+        fat->root_cluster = dbr->fat32.BPB_RootClus;
+        fs->type = FS_FAT32;
+    }
+
+    // 簇总数：不超过数据区的大小，也不超过FAT表能记录的数量
+    fat->cluster_total = data_clusters + 2;
+    if (fat->cluster_total > fat->tbl_sectors * fat->bytes_per_sec / fat->entry_size) {
+        fat->cluster_total = fat->tbl_sectors * fat->bytes_per_sec / fat->entry_size;
     }
 
     // 记录相关的打开信息
-    fs->type = FS_FAT16;
     fs->data = &fs->fat_data;
     fs->dev_id = dev_id;
+
+    // 建立空闲簇位图，此后分配簇时无需再扫描FAT表
+    if (free_map_init(fat) < 0) {
+        goto mount_failed;
+    }
+
+    // 打开文件的簇链缓存
+    fat->emap_tbl = (fat_emap_t *)memory_alloc_page();
+    if (!fat->emap_tbl) {
+        log_printf("no memory for fat extent map.");
+        goto mount_failed;
+    }
+    kernel_memset(fat->emap_tbl, 0, MEM_PAGE_SIZE);
+
+    // 目录名称索引表
+    fat->dindex_tbl = (fat_dindex_t *)memory_alloc_pages(FAT_DINDEX_NR);
+    if (!fat->dindex_tbl) {
+        log_printf("no memory for fat dir index.");
+        goto mount_failed;
+    }
+    kernel_memset(fat->dindex_tbl, 0, FAT_DINDEX_NR * MEM_PAGE_SIZE);
+    fat->dindex_seq = 0;
     return 0;
 
 mount_failed:
@@ -431,78 +1365,101 @@ mount_failed:
 void fatfs_unmount (struct _fs_t * fs) {
     fat_t * fat = (fat_t *)fs->data;
 
+    fat_flush(fat);
     dev_close(fs->dev_id);
+    memory_free_pages((uint32_t)fat->free_map.bits,
+            up2(bitmap_byte_count(fat->cluster_total), MEM_PAGE_SIZE) / MEM_PAGE_SIZE);
+    memory_free_page((uint32_t)fat->emap_tbl);
+    memory_free_pages((uint32_t)fat->dindex_tbl, FAT_DINDEX_NR);
     memory_free_page((uint32_t)fat->fat_buffer);
 }
 
 /**
  * @brief 从diritem中读取相应的文件信息
  */
-static void read_from_diritem (fat_t * fat, file_t * file, diritem_t * item, int index) {
+static void read_from_diritem (fat_t * fat, file_t * file, diritem_t * item, fat_dir_t * dir, int index) {
     file->type = diritem_get_type(item);
     file->size = (int)item->DIR_FileSize;
     file->pos = 0;
     file->sblk = (item->DIR_FstClusHI << 16) | item->DIR_FstClusL0;
+    if (!cluster_is_valid(file->sblk)) {
+        file->sblk = FAT_CLUSTER_INVALID;
+    }
     file->cblk = file->sblk;
+    file->pblk = dir->start;
     file->p_index = index;
+    if (!file->data) {
+        file->data = emap_alloc(fat);
+    }
 }
 
 /**
- * @brief 打开指定的文件
+ * @brief 在目录中查找文件
  */
-int fatfs_open (struct _fs_t * fs, const char * path, file_t * file) {
+int fatfs_lookup (struct _fs_t * fs, int dir_start, const char * name, dentry_t * dentry) {
     fat_t * fat = (fat_t *)fs->data;
-    diritem_t * file_item = (diritem_t *)0;
-    int p_index = -1;
-
-    // 遍历根目录的数据区，找到已经存在的匹配项
-    for (int i = 0; i < fat->root_ent_cnt; i++) {
-        diritem_t * item = read_dir_entry(fat, i);
-        if (item == (diritem_t *)0) {
-            return -1;
-        }
+    fat_dir_t dir;
+    diritem_t item;
+    int index, first;
 
-         // 结束项，不需要再扫描了，同时index也不能往前走
-        if (item->DIR_Name[0] == DIRITEM_NAME_END) {
-            p_index = i;
-            break;
-        }
+    dir_init(fat, &dir, dir_start);
+    if (dir_find(fat, &dir, name, &item, &index, &first) < 0) {
+        return -1;
+    }
 
-        // 只显示普通文件和目录，其它的不显示
-        if (item->DIR_Name[0] == DIRITEM_NAME_FREE) {
-            p_index = i;
-            continue;
-        }
+    dentry->ino = (item.DIR_FstClusHI << 16) | item.DIR_FstClusL0;
+    dentry->index = index;
+    dentry->type = diritem_get_type(&item);
+    return 0;
+}
 
-        // 找到要打开的目录
-        if (diritem_name_match(item, path)) {
-            file_item = item;
-            p_index = i;
-            break;
+/**
+ * @brief 打开指定的文件
+ * file->pblk为所在的目录；file->p_index不小于0时，为已知的目录项位置，无需再查找
+ */
+int fatfs_open (struct _fs_t * fs, const char * path, file_t * file) {
+    fat_t * fat = (fat_t *)fs->data;
+    fat_dir_t dir;
+    diritem_t item;
+    int index = file->p_index, first;
+
+    dir_init(fat, &dir, file->pblk);
+    int found = 0;
+    if (index >= 0) {
+        diritem_t * curr = read_dir_entry(fat, &dir, index);
+        if (curr) {
+            kernel_memcpy(&item, curr, sizeof(diritem_t));
+            found = 1;
         }
+    } else {
+        found = dir_find(fat, &dir, path, &item, &index, &first) == 0;
     }
 
-    if (file_item) {
-        read_from_diritem(fat, file, file_item, p_index);
+    if (found) {
+        read_from_diritem(fat, file, &item, &dir, index);
 
         // 如果要截断，则清空
         if (file->mode & O_TRUNC) {
             cluster_free_chain(fat, file->sblk);
             file->cblk = file->sblk = FAT_CLUSTER_INVALID;
             file->size = 0;
+            if (file->data) {
+                ((fat_emap_t *)file->data)->count = 0;
+                ((fat_emap_t *)file->data)->covered = 0;
+            }
+            return fat_flush(fat);
         }
         return 0;
-    } else if ((file->mode & O_CREAT) && (p_index >= 0)) {
-        // 创建一个空闲的diritem项
-        diritem_t item;
-        diritem_init(&item, 0, path);
-        int err = write_dir_entry(fat, &item, p_index);
+    } else if (file->mode & O_CREAT) {
+        // 创建新的目录项，名称不符合8.3格式时带长文件名
+        int err = dir_create(fat, &dir, path, 0, &item, &index);
+        fat_flush(fat);
         if (err < 0) {
             log_printf("create file failed.");
             return -1;
         }
 
-        read_from_diritem(fat, file, &item, p_index);
+        read_from_diritem(fat, file, &item, &dir, index);
         return 0;
     }
 
@@ -511,6 +1468,7 @@ int fatfs_open (struct _fs_t * fs, const char * path, file_t * file) {
 
 /**
  * @brief 读了文件
+ * 扇区对齐的部分按连续的簇合并，直接读到buf中；只有首尾不完整的扇区经fat_buffer中转
  */
 int fatfs_read (char * buf, int size, file_t * file) {
     fat_t * fat = (fat_t *)file->fs->data;
@@ -523,31 +1481,32 @@ int fatfs_read (char * buf, int size, file_t * file) {
 
     uint32_t total_read = 0;
     while (nbytes > 0) {
-        uint32_t curr_read = nbytes;
-		uint32_t cluster_offset = file->pos % fat->cluster_byte_size;
-        uint32_t start_sector = fat->data_start + (file->cblk - 2)* fat->sec_per_cluster;  // 从2开始
-
-        // 如果是整簇, 只读一簇
-        if ((cluster_offset == 0) && (nbytes == fat->cluster_byte_size)) {
-            int err = dev_read(fat->fs->dev_id, start_sector, buf, fat->sec_per_cluster);
-            if (err < 0) {
+        uint32_t curr_read;
+        uint32_t sector_offset = file->pos % fat->bytes_per_sec;
+        int sector = file_curr_sector(fat, file);
+
+        if ((sector_offset == 0) && (nbytes >= fat->bytes_per_sec)) {
+            // 完整的扇区，一次性读取尽可能多的连续扇区
+            int sectors = file_run_sectors(fat, file, nbytes / fat->bytes_per_sec);
+            int cnt = dev_read(fat->fs->dev_id, sector, buf, sectors);
+            if (cnt <= 0) {
                 return total_read;
             }
 
-            curr_read = fat->cluster_byte_size;
+            curr_read = cnt * fat->bytes_per_sec;
         } else {
-            // 如果跨簇，只读第一个簇内的一部分
-            if (cluster_offset + curr_read > fat->cluster_byte_size) {
-                curr_read = fat->cluster_byte_size - cluster_offset;
+            // 不完整的扇区，只读该扇区内的一部分
+            curr_read = fat->bytes_per_sec - sector_offset;
+            if (curr_read > nbytes) {
+                curr_read = nbytes;
             }
 
-            // 读取整个簇，然后从中拷贝
-            fat->curr_sector = -1;
-            int err = dev_read(fat->fs->dev_id, start_sector, fat->fat_buffer, fat->sec_per_cluster);
+            // 读取整个扇区，然后从中拷贝
+            int err = bread_sector(fat, sector);
             if (err < 0) {
                 return total_read;
             }
-            kernel_memcpy(buf, fat->fat_buffer + cluster_offset, curr_read);
+            kernel_memcpy(buf, fat->fat_buffer + sector_offset, curr_read);
         }
 
         buf += curr_read;
@@ -564,8 +1523,97 @@ int fatfs_read (char * buf, int size, file_t * file) {
     return total_read;
 }
 
+/**
+ * @brief 依次读入多个缓存
+ * 位置在扇区边界上时，从当前缓存起收集各缓存中整扇区的部分，与簇链中物理连续的扇区对应，
+ * 用一次磁盘读取分散放入各缓存；不完整的扇区仍按fatfs_read处理
+ */
+int fatfs_readv (const struct iovec * iov, int iovcnt, file_t * file) {
+    fat_t * fat = (fat_t *)file->fs->data;
+    int total_read = 0;
+    int i = 0;
+    uint32_t offset = 0;            // iov[i]中已读入的量
+
+    while ((i < iovcnt) && (file->pos < file->size)) {
+        uint32_t left = iov[i].iov_len - offset;
+        if (left == 0) {
+            i++;
+            offset = 0;
+            continue;
+        }
+
+        uint32_t curr_read;
+        uint32_t file_left = file->size - file->pos;
+        if ((file->pos % fat->bytes_per_sec == 0) && (left >= fat->bytes_per_sec) && (file_left >= fat->bytes_per_sec)) {
+            struct iovec seg[FILE_IOV_MAX];
+            int seg_cnt = 0, sectors = 0;
+            int max_sectors = file_run_sectors(fat, file, file_left / fat->bytes_per_sec);
+            for (int j = i; (j < iovcnt) && (sectors < max_sectors); j++) {
+                uint32_t seg_offset = (j == i) ? offset : 0;
+                int n = (iov[j].iov_len - seg_offset) / fat->bytes_per_sec;
+                if (n > max_sectors - sectors) {
+                    n = max_sectors - sectors;
+                }
+                if (n == 0) {
+                    break;
+                }
+
+                seg[seg_cnt].iov_base = (char *)iov[j].iov_base + seg_offset;
+                seg[seg_cnt++].iov_len = n * fat->bytes_per_sec;
+                sectors += n;
+
+                // 余下不足一个扇区，之后单独读取
+                if ((iov[j].iov_len - seg_offset) % fat->bytes_per_sec) {
+                    break;
+                }
+            }
+
+            int cnt = dev_readv(fat->fs->dev_id, file_curr_sector(fat, file), seg, seg_cnt);
+            if (cnt <= 0) {
+                return total_read;
+            }
+
+            curr_read = cnt * fat->bytes_per_sec;
+            if (move_file_pos(file, fat, curr_read, 0) < 0) {
+                return total_read + curr_read;
+            }
+        } else {
+            // 不完整的扇区，只读到扇区末尾
+            curr_read = fat->bytes_per_sec - file->pos % fat->bytes_per_sec;
+            if (curr_read > left) {
+                curr_read = left;
+            }
+
+            int cnt = fatfs_read((char *)iov[i].iov_base + offset, curr_read, file);
+            if (cnt <= 0) {
+                return total_read;
+            }
+            curr_read = cnt;
+        }
+
+        // 跳过已读入的各缓存
+        total_read += curr_read;
+        while (curr_read > 0) {
+            uint32_t n = iov[i].iov_len - offset;
+            if (n > curr_read) {
+                n = curr_read;
+            }
+
+            offset += n;
+            curr_read -= n;
+            if (offset == iov[i].iov_len) {
+                i++;
+                offset = 0;
+            }
+        }
+    }
+
+    return total_read;
+}
+
 /**
  * @brief 写文件数据
+ * 与读相同，扇区对齐的部分直接从buf写入，只有首尾不完整的扇区需要先读后写
  */
 int fatfs_write (char * buf, int size, file_t * file) {
     fat_t * fat = (fat_t *)file->fs->data;
@@ -582,34 +1630,37 @@ int fatfs_write (char * buf, int size, file_t * file) {
     uint32_t nbytes = size;
     uint32_t total_write = 0;
 	while (nbytes) {
-        // 每次写的数据量取决于当前簇中剩余的空间，以及size的量综合
-        uint32_t curr_write = nbytes;
-		uint32_t cluster_offset = file->pos % fat->cluster_byte_size;
-        uint32_t start_sector = fat->data_start + (file->cblk - 2)* fat->sec_per_cluster;  // 从2开始
-
-        // 如果是整簇, 写整簇
-        if ((cluster_offset == 0) && (nbytes == fat->cluster_byte_size)) {
-            int err = dev_write(fat->fs->dev_id, start_sector, buf, fat->sec_per_cluster);
-            if (err < 0) {
+        uint32_t curr_write;
+        uint32_t sector_offset = file->pos % fat->bytes_per_sec;
+        int sector = file_curr_sector(fat, file);
+
+        if ((sector_offset == 0) && (nbytes >= fat->bytes_per_sec)) {
+            // 完整的扇区，一次性写入尽可能多的连续扇区
+            int sectors = file_run_sectors(fat, file, nbytes / fat->bytes_per_sec);
+            int cnt = dev_write(fat->fs->dev_id, sector, buf, sectors);
+            if (cnt <= 0) {
                 return total_write;
             }
 
-            curr_write = fat->cluster_byte_size;
+            // 缓存的扇区被覆盖了，使其失效
+            if ((fat->curr_sector >= sector) && (fat->curr_sector < sector + cnt)) {
+                fat->curr_sector = -1;
+            }
+            curr_write = cnt * fat->bytes_per_sec;
         } else {
-            // 如果跨簇，只写第一个簇内的一部分
-            if (cluster_offset + curr_write > fat->cluster_byte_size) {
-                curr_write = fat->cluster_byte_size - cluster_offset;
+            // 不完整的扇区，只写该扇区内的一部分
+            curr_write = fat->bytes_per_sec - sector_offset;
+            if (curr_write > nbytes) {
+                curr_write = nbytes;
             }
 
-            fat->curr_sector = -1;
-            int err = dev_read(fat->fs->dev_id, start_sector, fat->fat_buffer, fat->sec_per_cluster);
+            // 读取整个扇区，修改后再写回
+            int err = bread_sector(fat, sector);
             if (err < 0) {
                 return total_write;
             }
-            kernel_memcpy(fat->fat_buffer + cluster_offset, buf, curr_write);        
-            
-            // 写整个簇，然后从中拷贝
-            err = dev_write(fat->fs->dev_id, start_sector, fat->fat_buffer, fat->sec_per_cluster);
+            kernel_memcpy(fat->fat_buffer + sector_offset, buf, curr_write);
+            err = bwrite_secotr(fat, sector);
             if (err < 0) {
                 return total_write;
             }
@@ -618,15 +1669,20 @@ int fatfs_write (char * buf, int size, file_t * file) {
         buf += curr_write;
         nbytes -= curr_write;
         total_write += curr_write;
-        file->size += curr_write;
 
-        // 前移文件指针
-		int err = move_file_pos(file, fat, curr_write, 1);
+        // 前移文件指针，簇已经预先分配好，无需再扩充
+		int err = move_file_pos(file, fat, curr_write, 0);
 		if (err < 0) {
             return total_write;
         }
+
+        if (file->pos > file->size) {
+            file->size = file->pos;
+        }
     }
 
+    // FAT表的修改统一在此写回
+    fat_flush(fat);
     return total_write;
 }
 
@@ -634,63 +1690,71 @@ int fatfs_write (char * buf, int size, file_t * file) {
  * @brief 关闭文件
  */
 void fatfs_close (file_t * file) {
+    fat_t * fat = (fat_t *)file->fs->data;
+
+    // 释放簇链缓存
+    if (file->data) {
+        ((fat_emap_t *)file->data)->used = 0;
+        file->data = (void *)0;
+    }
+
     if (file->mode == O_RDONLY) {
         return;
     }
 
-    fat_t * fat = (fat_t *)file->fs->data;
-
-    diritem_t * item = read_dir_entry(fat, file->p_index);
+    fat_dir_t dir;
+    dir_init(fat, &dir, file->pblk);
+    diritem_t * item = read_dir_entry(fat, &dir, file->p_index);
     if (item == (diritem_t *)0) {
         return;
     }
 
+    // 没有分配簇的文件，起始簇号记为0
+    cluster_t sblk = cluster_is_valid(file->sblk) ? file->sblk : 0;
     item->DIR_FileSize = file->size;
-    item->DIR_FstClusHI = (uint16_t )(file->sblk >> 16);
-    item->DIR_FstClusL0 = (uint16_t )(file->sblk & 0xFFFF);
-    write_dir_entry(fat, item, file->p_index);
+    item->DIR_FstClusHI = (uint16_t )(sblk >> 16);
+    item->DIR_FstClusL0 = (uint16_t )(sblk & 0xFFFF);
+    write_dir_entry(fat, &dir, item, file->p_index);
+    fat_flush(fat);
 }
 
 /**
- * @brief 文件读写位置的调整
+ * @brief 文件读写位置的调整，返回调整后的位置
+ * 簇号通过簇链缓存查找，无需每次从文件开头遍历簇链
  */
 int fatfs_seek (file_t * file, uint32_t offset, int dir) {
-     // 只支持基于文件开头的定位
-    if (dir != 0) {
-        return -1;
-    }
-
     fat_t * fat = (fat_t *)file->fs->data;
-    cluster_t curr_cluster = file->sblk;
-    uint32_t curr_pos = 0;
-    uint32_t offset_to_move = offset;
-
-    while (offset_to_move > 0) {
-        uint32_t c_off = curr_pos % fat->cluster_byte_size;
-        uint32_t curr_move = offset_to_move;
 
-        // 不超过一簇，直接调整位置，无需跑到下一簇
-        if (c_off + curr_move < fat->cluster_byte_size) {
-            curr_pos += curr_move;
-            break;
-        }
+    int pos;
+    switch (dir) {
+    case SEEK_SET:
+        pos = (int)offset;
+        break;
+    case SEEK_CUR:
+        pos = file->pos + (int)offset;
+        break;
+    case SEEK_END:
+        pos = file->size + (int)offset;
+        break;
+    default:
+        return -1;
+    }
 
-        // 超过一簇，只在当前簇内移动
-        curr_move = fat->cluster_byte_size - c_off;
-        curr_pos += curr_move;
-        offset_to_move -= curr_move;
+    // 不允许超出文件范围
+    if ((pos < 0) || (pos > file->size)) {
+        return -1;
+    }
 
-        // 取下一簇
-        curr_cluster = cluster_get_next(fat, curr_cluster);
-        if (!cluster_is_valid(curr_cluster)) {
-            return -1;
-        }
+    // 恰好在文件末尾且为簇边界时，没有对应的簇，允许当前簇无效
+    cluster_t cluster = file_get_cluster(fat, file, pos / fat->cluster_byte_size);
+    if (!cluster_is_valid(cluster) && (pos < file->size)) {
+        return -1;
     }
 
     // 最后记录一下位置
-    file->pos = curr_pos;
-    file->cblk = curr_cluster;
-    return 0;
+    file->pos = pos;
+    file->cblk = cluster;
+    return pos;
 }
 
 int fatfs_stat (file_t * file, struct stat *st) {
@@ -698,7 +1762,7 @@ int fatfs_stat (file_t * file, struct stat *st) {
 }
 
 /**
- * @brief 打开目录。只是简单地读取位置重设为0
+ * @brief 打开目录。目录已由dir->ino指定，只是简单地读取位置重设为0
  */
 int fatfs_opendir (struct _fs_t * fs,const char * name, DIR * dir) {
     dir->index = 0;
@@ -710,29 +1774,21 @@ int fatfs_opendir (struct _fs_t * fs,const char * name, DIR * dir) {
  */
 int fatfs_readdir (struct _fs_t * fs,DIR* dir, struct dirent * dirent) {
     fat_t * fat = (fat_t *)fs->data;
+    char name[FAT_NAME_SIZE];
+    fat_dir_t fat_dir;
+    diritem_t item;
+    int first;
 
-    // 做一些简单的判断，检查
-    while (dir->index < fat->root_ent_cnt) {
-        diritem_t * item = read_dir_entry(fat, dir->index);
-        if (item == (diritem_t *)0) {
-            return -1;
-        }
-
-        // 结束项，不需要再扫描了，同时index也不能往前走
-        if (item->DIR_Name[0] == DIRITEM_NAME_END) {
-            break;
-        }
-
+    dir_init(fat, &fat_dir, dir->ino);
+    while ((dir->index = dir_read_next(fat, &fat_dir, dir->index, name, &item, &first)) >= 0) {
         // 只显示普通文件和目录，其它的不显示
-        if (item->DIR_Name[0] != DIRITEM_NAME_FREE) {
-            file_type_t type = diritem_get_type(item);
-            if ((type == FILE_NORMAL) || (type == FILE_DIR)) {
-                dirent->index = dir->index++;
-                dirent->type = diritem_get_type(item);
-                dirent->size = item->DIR_FileSize;
-                diritem_get_name(item, dirent->name);
-                return 0;
-            }
+        file_type_t type = diritem_get_type(&item);
+        if ((type == FILE_NORMAL) || (type == FILE_DIR)) {
+            dirent->index = dir->index++;
+            dirent->type = type;
+            dirent->size = item.DIR_FileSize;
+            kernel_strncpy(dirent->name, name, sizeof(dirent->name));
+            return 0;
         }
 
         dir->index++;
@@ -751,40 +1807,47 @@ int fatfs_closedir (struct _fs_t * fs,DIR *dir) {
 /**
  * @brief 删除文件
  */
-int fatfs_unlink (struct _fs_t * fs, const char * path) {
+int fatfs_unlink (struct _fs_t * fs, int dir_start, const char * path) {
     fat_t * fat = (fat_t *)fs->data;
+    fat_dir_t dir;
+    diritem_t item;
+    int index, first;
 
-    // 遍历根目录的数据区，找到已经存在的匹配项
-    for (int i = 0; i < fat->root_ent_cnt; i++) {
-        diritem_t * item = read_dir_entry(fat, i);
-        if (item == (diritem_t *)0) {
-            return -1;
-        }
+    dir_init(fat, &dir, dir_start);
+    if (dir_find(fat, &dir, path, &item, &index, &first) < 0) {
+        return -1;
+    }
 
-         // 结束项，不需要再扫描了，同时index也不能往前走
-        if (item->DIR_Name[0] == DIRITEM_NAME_END) {
-            break;
-        }
+    // 目录不能直接删除
+    if (item.DIR_Attr & DIRITEM_ATTR_DIRECTORY) {
+        log_printf("%s is a directory.", path);
+        return -1;
+    }
 
-        // 只显示普通文件和目录，其它的不显示
-        if (item->DIR_Name[0] == DIRITEM_NAME_FREE) {
-            continue;
+    // 释放簇
+    cluster_free_chain(fat, (item.DIR_FstClusHI << 16) | item.DIR_FstClusL0);
+
+    // 长文件名项和短文件名项都标记为空闲。不能清成结束项，否则其后的文件将无法访问
+    int err = 0;
+    for (int i = first; (i <= index) && (err == 0); i++) {
+        diritem_t * curr = read_dir_entry(fat, &dir, i);
+        if (curr == (diritem_t *)0) {
+            err = -1;
+            break;
         }
 
-        // 找到要打开的目录
-        if (diritem_name_match(item, path)) {
-            // 释放簇
-            int cluster = (item->DIR_FstClusHI << 16) | item->DIR_FstClusL0;
-            cluster_free_chain(fat, cluster);
+        diritem_t free_item = *curr;
+        free_item.DIR_Name[0] = DIRITEM_NAME_FREE;
+        err = write_dir_entry(fat, &dir, &free_item, i);
+    }
 
-            // 写diritem项
-            diritem_t item;
-            kernel_memset(&item, 0, sizeof(diritem_t));
-            return write_dir_entry(fat, &item, i);
-        }
+    fat_dindex_t * dindex = dindex_get(fat, dir.start, 0);
+    if (dindex) {
+        dindex_remove(dindex, index);
     }
 
-    return -1;
+    fat_flush(fat);
+    return err;
 }
 
 fs_op_t fatfs_op = {
@@ -793,6 +1856,7 @@ fs_op_t fatfs_op = {
     .open = fatfs_open,
     .read = fatfs_read,
     .write = fatfs_write,
+    .readv = fatfs_readv,
     .seek = fatfs_seek,
     .stat = fatfs_stat,
     .close = fatfs_close,
@@ -801,4 +1865,5 @@ fs_op_t fatfs_op = {
     .readdir = fatfs_readdir,
     .closedir = fatfs_closedir,
     .unlink = fatfs_unlink,
+    .lookup = fatfs_lookup,
 };
\ No newline at end of file
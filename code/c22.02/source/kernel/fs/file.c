@@ -8,8 +8,9 @@
 #include "fs/file.h"
 #include "tools/klib.h"
 #include "ipc/mutex.h"
+#include "core/memory.h"
 
-static file_t file_table[FILE_TABLE_SIZE];      // 系统中可打开的文件表
+static file_t * file_table;                     // 系统中可打开的文件表，从物理页中分配
 static mutex_t file_alloc_mutex;                // 访问file_table的互斥信号量
 
 /**
@@ -56,7 +57,10 @@ void file_inc_ref (file_t * file) {
  * @brief 文件表初始化
  */
 void file_table_init (void) {
-	// 文件描述符表初始化
-	kernel_memset(&file_table, 0, sizeof(file_table));
+	// 文件描述符表初始化。表较大，不放在内核映像中，以免占用低端1MB内的空间
+	int page_count = up2(FILE_TABLE_SIZE * sizeof(file_t), MEM_PAGE_SIZE) / MEM_PAGE_SIZE;
+	file_table = (file_t *)memory_alloc_pages(page_count);
+	ASSERT(file_table != (file_t *)0);
+	kernel_memset(file_table, 0, FILE_TABLE_SIZE * sizeof(file_t));
 	mutex_init(&file_alloc_mutex);
 }
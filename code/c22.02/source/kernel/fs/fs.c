@@ -18,6 +18,10 @@
 #include <sys/file.h>
 #include "dev/disk.h"
 #include "os_cfg.h"
+#include "fs/pcache.h"
+#include "core/mmap.h"
+#include "fs/pipefs/pipefs.h"
+#include "fs/shmfs/shmfs.h"
 
 #define FS_TABLE_SIZE		10		// 文件系统表数量
 
@@ -25,15 +29,19 @@ static list_t mounted_list;			// 已挂载的文件系统
 static list_t free_list;				// 空闲fs列表
 static fs_t fs_tbl[FS_TABLE_SIZE];		// 空闲文件系统列表大小
 static fs_t * root_fs;				// 根文件系统
+static fs_t * pipe_fs;				// 管道所在的文件系统
+static fs_t * shm_fs;				// 共享内存所在的文件系统
 
 extern fs_op_t devfs_op;
 extern fs_op_t fatfs_op;
+extern fs_op_t pipefs_op;
+extern fs_op_t shmfs_op;
 
 /**
  * @brief 判断文件描述符是否正确
  */
 static int is_fd_bad (int file) {
-	if ((file < 0) && (file >= TASK_OFILE_NR)) {
+	if ((file < 0) || (file >= TASK_OFILE_NR)) {
 		return 1;
 	}
 
@@ -46,9 +54,14 @@ static int is_fd_bad (int file) {
 static fs_op_t * get_fs_op (fs_type_t type, int major) {
 	switch (type) {
 	case FS_FAT16:
+	case FS_FAT32:
 		return &fatfs_op;
 	case FS_DEVFS:
 		return &devfs_op;
+	case FS_PIPEFS:
+		return &pipefs_op;
+	case FS_SHMFS:
+		return &shmfs_op;
 	default:
 		return (fs_op_t *)0;
 	}
@@ -126,6 +139,8 @@ static void mount_list_init (void) {
 void fs_init (void) {
 	mount_list_init();
     file_table_init();
+	dcache_init();
+	pcache_init();
 
 	// 磁盘检查
 	disk_init();
@@ -134,6 +149,14 @@ void fs_init (void) {
 	fs_t * fs = mount(FS_DEVFS, "/dev", 0, 0);
 	ASSERT(fs != (fs_t *)0);
 
+	// 管道没有可访问的文件，挂载只是为了提供读写接口
+	pipe_fs = mount(FS_PIPEFS, "/pipe", 0, 0);
+	ASSERT(pipe_fs != (fs_t *)0);
+
+	// 共享内存段可以通过/shm/名称打开，但只能用shm_open创建
+	shm_fs = mount(FS_SHMFS, "/shm", 0, 0);
+	ASSERT(shm_fs != (fs_t *)0);
+
 	// 挂载根文件系统
 	root_fs = mount(FS_FAT16, "/home", ROOT_DEV);
 	ASSERT(root_fs != (fs_t *)0);
@@ -154,46 +177,176 @@ int path_to_num (const char * path, int * num) {
 	return 0;
 }
 
+static void fs_protect (fs_t * fs) {
+	if (fs->mutex) {
+		mutex_lock(fs->mutex);
+	}
+}
+
+static void fs_unprotect (fs_t * fs) {
+	if (fs->mutex) {
+		mutex_unlock(fs->mutex);
+	}
+}
+
 /**
- * @brief 判断路径是否以xx开头
+ * @brief 将路径转换为规范的绝对路径
+ * 相对路径以当前工作目录为基准，去掉多余的'/'，并处理'.'和'..'
  */
-int path_begin_with (const char * path, const char * str) {
-	const char * s1 = path, * s2 = str;
-	while (*s1 && *s2 && (*s1 == *s2)) {
-		s1++;
-		s2++;
+static int path_normalize (const char * path, char * buf) {
+	int len = 0;
+
+	// 相对路径从当前目录开始。根目录"/"记为空串，便于后续拼接
+	if (*path != '/') {
+		const char * cwd = task_current()->files->cwd;
+		len = kernel_strlen(cwd);
+		kernel_memcpy(buf, (void *)cwd, len);
+		if (len == 1) {
+			len = 0;
+		}
+	}
+
+	while (*path) {
+		// 跳过分隔符，取出下一级名称
+		while (*path == '/') {
+			path++;
+		}
+		const char * start = path;
+		while (*path && (*path != '/')) {
+			path++;
+		}
+		int name_len = path - start;
+
+		if ((name_len == 0) || ((name_len == 1) && (start[0] == '.'))) {
+			continue;
+		} else if ((name_len == 2) && (start[0] == '.') && (start[1] == '.')) {
+			// 回到上一级，根目录的上一级仍为根目录
+			while ((len > 0) && (buf[--len] != '/')) {}
+		} else {
+			if (len + name_len + 1 >= FILE_PATH_SIZE) {
+				return -1;
+			}
+			buf[len++] = '/';
+			kernel_memcpy(buf + len, (void *)start, name_len);
+			len += name_len;
+		}
 	}
 
-	return *s2 == '\0';
+	if (len == 0) {
+		buf[len++] = '/';
+	}
+	buf[len] = '\0';
+	return 0;
 }
 
 /**
- * @brief 获取下一级子目录
+ * @brief 查找路径所在的文件系统，sub返回在该文件系统内的路径
+ * 挂载点需与路径中完整的若干级目录相同，取最长的匹配。都不匹配时，属于根文件系统
  */
-const char * path_next_child (const char * path) {
-   const char * c = path;
+static fs_t * path_to_fs (const char * path, const char ** sub) {
+	fs_t * fs = (fs_t *)0;
+	int match_len = 0;
+
+	list_node_t * node = list_first(&mounted_list);
+	while (node) {
+		fs_t * curr = list_node_parent(node, fs_t, node);
+		int len = kernel_strlen(curr->mount_point);
+		if ((len > match_len) && (kernel_strncmp(path, curr->mount_point, len) == 0)
+				&& ((path[len] == '/') || (path[len] == '\0'))) {
+			fs = curr;
+			match_len = len;
+		}
+		node = list_node_next(node);
+	}
 
-    while (*c && (*c++ == '/')) {}
-    while (*c && (*c++ != '/')) {}
-    return *c ? c : (const char *)0;
+	if (!fs) {
+		fs = root_fs;
+	}
+
+	path += match_len;
+	while (*path == '/') {
+		path++;
+	}
+	*sub = path;
+	return fs;
 }
 
-static void fs_protect (fs_t * fs) {
-	if (fs->mutex) {
-		mutex_lock(fs->mutex);
+/**
+ * @brief 在目录中查找名称，优先查目录项缓存，找不到的名称也会缓存
+ * 名称存在时返回0，否则返回-1
+ */
+static int fs_lookup (fs_t * fs, int dir, const char * name, dentry_t * dentry) {
+	if (dcache_lookup(fs, dir, name, dentry) < 0) {
+		dentry->negative = fs->op->lookup(fs, dir, name, dentry) < 0;
+		dcache_add(fs, dir, name, dentry);
 	}
+
+	return dentry->negative ? -1 : 0;
 }
 
-static void fs_unprotect (fs_t * fs) {
-	if (fs->mutex) {
-		mutex_unlock(fs->mutex);
+/**
+ * @brief 沿路径逐级查找，返回最后一级名称所在目录的标识，name返回最后一级的名称
+ * 文件系统不支持逐级查找时，直接返回根目录，name为整个路径
+ */
+static int path_walk_parent (fs_t * fs, const char * path, char * name) {
+	int dir = FS_ROOT_INO;
+
+	if (!fs->op->lookup) {
+		kernel_strncpy(name, path, FILE_PATH_SIZE);
+		return dir;
+	}
+
+	for (;;) {
+		// 取出下一级名称
+		const char * end = path;
+		while (*end && (*end != '/')) {
+			end++;
+		}
+		kernel_memcpy(name, (void *)path, end - path);
+		name[end - path] = '\0';
+
+		// 已是最后一级
+		if (*end == '\0') {
+			return dir;
+		}
+
+		// 中间的各级必须是已经存在的目录
+		dentry_t dentry;
+		if ((fs_lookup(fs, dir, name, &dentry) < 0) || (dentry.type != FILE_DIR)) {
+			return -1;
+		}
+		dir = dentry.ino;
+		path = end + 1;
 	}
 }
 
+/**
+ * @brief 解析路径，找到其对应的目录的标识。路径为文件系统根目录时，返回FS_ROOT_INO
+ */
+static int path_walk_dir (fs_t * fs, const char * path) {
+	char name[FILE_PATH_SIZE];
+
+	if (*path == '\0') {
+		return FS_ROOT_INO;
+	} else if (!fs->op->lookup) {
+		return -1;
+	}
+
+	dentry_t dentry;
+	int dir = path_walk_parent(fs, path, name);
+	if ((dir < 0) || (fs_lookup(fs, dir, name, &dentry) < 0) || (dentry.type != FILE_DIR)) {
+		return -1;
+	}
+	return dentry.ino;
+}
+
 /**
  * 打开文件
  */
 int sys_open(const char *name, int flags, ...) {
+	char path[FILE_PATH_SIZE];
+	char child[FILE_PATH_SIZE];
+
 	// 分配文件描述符链接
 	file_t * file = file_alloc();
 	if (!file) {
@@ -205,39 +358,60 @@ int sys_open(const char *name, int flags, ...) {
 		goto sys_open_failed;
 	}
 
-	// 检查名称是否以挂载点开头，如果没有，则认为name在根目录下
-	// 即只允许根目录下的遍历
-	fs_t * fs = (fs_t *)0;
-	list_node_t * node = list_first(&mounted_list);
-	while (node) {
-		fs_t * curr = list_node_parent(node, fs_t, node);
-		if (path_begin_with(name, curr->mount_point)) {
-			fs = curr;
-			break;
-		}
-		node = list_node_next(node);
+	// 转换为绝对路径，再找到所在的文件系统
+	if (path_normalize(name, path) < 0) {
+		log_printf("path too long: %s", name);
+		goto sys_open_failed;
 	}
 
-	if (fs) {
-		name = path_next_child(name);
-	} else {
-		fs = root_fs;
-	}
+	const char * sub;
+	fs_t * fs = path_to_fs(path, &sub);
 
 	file->mode = flags;
 	file->fs = fs;
-	kernel_strncpy(file->file_name, name, FILE_NAME_SIZE);
+	kernel_strncpy(file->file_name, get_file_name(path), FILE_NAME_SIZE);
 
 	fs_protect(fs);
-	int err = fs->op->open(fs, name, file);
-	if (err < 0) {
+
+	// 逐级找到最后一级所在的目录
+	int dir = path_walk_parent(fs, sub, child);
+	if (dir < 0) {
 		fs_unprotect(fs);
+		goto sys_open_failed;
+	}
 
-		log_printf("open %s failed.", name);
-		return -1;
+	// 已经查找过的文件，可直接告知其所在的位置；确定不存在的文件，无需再读目录
+	file->pblk = dir;
+	file->p_index = -1;
+	int exist = 0;
+	dentry_t dentry;
+	if (fs->op->lookup) {
+		exist = fs_lookup(fs, dir, child, &dentry) == 0;
+		if (exist) {
+			file->p_index = dentry.index;
+		} else if (!(flags & O_CREAT)) {
+			fs_unprotect(fs);
+			goto sys_open_failed;
+		}
+	}
+
+	int err = fs->op->open(fs, child, file);
+	if ((err == 0) && fs->op->lookup && !exist) {
+		// 创建了新文件，目录内容有变化
+		dcache_invalidate_dir(fs, dir);
 	}
 	fs_unprotect(fs);
 
+	if (err < 0) {
+		log_printf("open %s failed.", name);
+		goto sys_open_failed;
+	}
+
+	// 截断后原有数据不再有效
+	if (exist && (flags & O_TRUNC)) {
+		pcache_invalidate(fs, file->pblk, file->p_index);
+	}
+
 	return fd;
 
 sys_open_failed:
@@ -274,6 +448,118 @@ int sys_dup (int file) {
     return -1;
 }
 
+/**
+ * @brief 复制文件描述符到指定的new_file。new_file已打开时，先将其关闭
+ */
+int sys_dup2 (int file, int new_file) {
+	if (is_fd_bad(file) || is_fd_bad(new_file)) {
+        log_printf("file(%d) is not valid.", is_fd_bad(file) ? file : new_file);
+		return -1;
+	}
+
+	file_t * p_file = task_file(file);
+	if (!p_file) {
+		log_printf("file not opened");
+		return -1;
+	}
+
+	if (file == new_file) {
+		return new_file;
+	}
+
+	if (task_file(new_file)) {
+		sys_close(new_file);
+	}
+
+	file_inc_ref(p_file);
+	task_current()->files->file_table[new_file] = p_file;
+	return new_file;
+}
+
+/**
+ * @brief 创建管道，fd[0]为读端，fd[1]为写端
+ */
+int sys_pipe (int * fd) {
+	int rfd = -1, wfd = -1;
+
+	file_t * rfile = file_alloc();
+	file_t * wfile = file_alloc();
+	if (!rfile || !wfile) {
+		log_printf("no file for pipe");
+		goto sys_pipe_failed;
+	}
+
+	rfd = task_alloc_fd(rfile);
+	wfd = task_alloc_fd(wfile);
+	if ((rfd < 0) || (wfd < 0)) {
+		log_printf("No task file avaliable");
+		goto sys_pipe_failed;
+	}
+
+	if (pipefs_create(pipe_fs, rfile, wfile) < 0) {
+		goto sys_pipe_failed;
+	}
+
+	fd[0] = rfd;
+	fd[1] = wfd;
+	return 0;
+
+sys_pipe_failed:
+	if (rfile) {
+		file_free(rfile);
+		task_remove_fd(rfd);
+	}
+	if (wfile) {
+		file_free(wfile);
+		task_remove_fd(wfd);
+	}
+	return -1;
+}
+
+/**
+ * @brief 打开或创建共享内存段，返回的文件可用mmap映射
+ */
+int sys_shm_open (const char * name, int flags, uint32_t size) {
+	file_t * file = file_alloc();
+	if (!file) {
+		return -1;
+	}
+
+	int fd = task_alloc_fd(file);
+	if (fd < 0) {
+		log_printf("No task file avaliable");
+		goto sys_shm_open_failed;
+	}
+
+	file->mode = O_RDWR;
+	if (shmfs_create(shm_fs, name, flags, size, file) < 0) {
+		goto sys_shm_open_failed;
+	}
+	return fd;
+
+sys_shm_open_failed:
+	file_free(file);
+	task_remove_fd(fd);
+	return -1;
+}
+
+/**
+ * @brief 创建无名的共享内存段，供共享的匿名映射使用。返回的文件不在进程的文件表中
+ */
+file_t * fs_shm_anon (uint32_t size) {
+	file_t * file = file_alloc();
+	if (!file) {
+		return (file_t *)0;
+	}
+
+	file->mode = O_RDWR;
+	if (shmfs_create(shm_fs, (const char *)0, O_CREAT, size, file) < 0) {
+		file_free(file);
+		return (file_t *)0;
+	}
+	return file;
+}
+
 /**
  * @brief IO设备控制
  */
@@ -314,6 +600,11 @@ int sys_read(int file, char *ptr, int len) {
 		return -1;
 	}
 
+	// 缓冲区可能位于尚未访问的映射区，先建立映射，避免在文件系统内部发生缺页
+	if (mmap_prefault((uint32_t)ptr, len, 1) < 0) {
+		return -1;
+	}
+
 	// 读取文件
 	fs_t * fs = p_file->fs;
 	fs_protect(fs);
@@ -341,14 +632,206 @@ int sys_write(int file, char *ptr, int len) {
 		return -1;
 	}
 
+	if (mmap_prefault((uint32_t)ptr, len, 0) < 0) {
+		return -1;
+	}
+
 	// 写入文件
 	fs_t * fs = p_file->fs;
 	fs_protect(fs);
+	uint32_t pos = p_file->pos;
 	int err = fs->op->write(ptr, len, p_file);
 	fs_unprotect(fs);
+
+	// 同步更新页缓存中的内容
+	if ((err > 0) && (p_file->type == FILE_NORMAL)) {
+		pcache_update(p_file, pos, ptr, err);
+	}
+	return err;
+}
+
+/**
+ * @brief 取出要读写的文件，并检查读写模式
+ */
+static file_t * rw_file (int file, int write) {
+	if (is_fd_bad(file)) {
+		return (file_t *)0;
+	}
+
+	file_t * p_file = task_file(file);
+	if (!p_file) {
+		log_printf("file not opened");
+		return (file_t *)0;
+	}
+
+	if (p_file->mode == (write ? O_RDONLY : O_WRONLY)) {
+		log_printf("file is %s only", write ? "read" : "write");
+		return (file_t *)0;
+	}
+
+	return p_file;
+}
+
+/**
+ * @brief 依次读写多个缓存，需在fs_protect中调用。文件系统不支持时逐个调用read/write
+ * 遇到出错或者读写量不足时停止，返回已读写的总量
+ */
+static int file_rw_iov (file_t * file, const struct iovec * iov, int iovcnt, int write) {
+	fs_op_t * op = file->fs->op;
+	if (write && op->writev) {
+		return op->writev(iov, iovcnt, file);
+	} else if (!write && op->readv) {
+		return op->readv(iov, iovcnt, file);
+	}
+
+	int total = 0;
+	for (int i = 0; i < iovcnt; i++) {
+		if (iov[i].iov_len == 0) {
+			continue;
+		}
+
+		int cnt = write ? op->write(iov[i].iov_base, iov[i].iov_len, file)
+						: op->read(iov[i].iov_base, iov[i].iov_len, file);
+		if (cnt < 0) {
+			return total ? total : -1;
+		}
+
+		total += cnt;
+		if (cnt < iov[i].iov_len) {
+			break;
+		}
+	}
+	return total;
+}
+
+/**
+ * @brief readv/writev的公共部分。先将缓存描述拷贝到内核中，避免读写过程中被修改
+ */
+static int sys_rw_iov (int file, const struct iovec * iov, int iovcnt, int write) {
+	if (!iov || (iovcnt <= 0) || (iovcnt > FILE_IOV_MAX)) {
+		return -1;
+	}
+
+	file_t * p_file = rw_file(file, write);
+	if (!p_file) {
+		return -1;
+	}
+
+	struct iovec kiov[FILE_IOV_MAX];
+	kernel_memcpy(kiov, (void *)iov, iovcnt * sizeof(struct iovec));
+	for (int i = 0; i < iovcnt; i++) {
+		if (mmap_prefault((uint32_t)kiov[i].iov_base, kiov[i].iov_len, !write) < 0) {
+			return -1;
+		}
+	}
+
+	fs_t * fs = p_file->fs;
+	fs_protect(fs);
+	uint32_t pos = p_file->pos;
+	int err = file_rw_iov(p_file, kiov, iovcnt, write);
+	fs_unprotect(fs);
+
+	// 同步更新页缓存中写入的各段
+	if (write && (err > 0) && (p_file->type == FILE_NORMAL)) {
+		int left = err;
+		for (int i = 0; (i < iovcnt) && (left > 0); i++) {
+			int size = kiov[i].iov_len < left ? kiov[i].iov_len : left;
+			pcache_update(p_file, pos, kiov[i].iov_base, size);
+			pos += size;
+			left -= size;
+		}
+	}
+	return err;
+}
+
+/**
+ * 从多个缓存中依次读取
+ */
+int sys_readv(int file, const struct iovec * iov, int iovcnt) {
+	return sys_rw_iov(file, iov, iovcnt, 0);
+}
+
+/**
+ * 将多个缓存中的数据依次写入
+ */
+int sys_writev(int file, const struct iovec * iov, int iovcnt) {
+	return sys_rw_iov(file, iov, iovcnt, 1);
+}
+
+/**
+ * @brief 从文件末尾起写入0，直到文件大小为size。文件系统不允许定位到末尾之后，pwrite需先扩展文件
+ */
+static int file_extend_zero (file_t * file, uint32_t size) {
+	char zero[256];
+	kernel_memset(zero, 0, sizeof(zero));
+
+	if (file->fs->op->seek(file, 0, SEEK_END) < 0) {
+		return -1;
+	}
+
+	while (file->size < size) {
+		int len = (size - file->size < sizeof(zero)) ? size - file->size : sizeof(zero);
+		if (file->fs->op->write(zero, len, file) < len) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief pread/pwrite的公共部分。临时移动读写位置，完成后恢复，整个过程在文件系统锁中
+ * pwrite的位置超出文件末尾时，中间部分填0
+ */
+static int sys_rw_at (int file, char * ptr, int len, int offset, int write) {
+	if (!ptr || (len <= 0) || (offset < 0)) {
+		return len == 0 ? 0 : -1;
+	}
+
+	file_t * p_file = rw_file(file, write);
+	if (!p_file) {
+		return -1;
+	}
+
+	if (mmap_prefault((uint32_t)ptr, len, !write) < 0) {
+		return -1;
+	}
+
+	fs_t * fs = p_file->fs;
+	fs_protect(fs);
+	int pos = p_file->pos;
+	int err = 0;
+	if (write && (p_file->type == FILE_NORMAL) && (offset > p_file->size)) {
+		err = file_extend_zero(p_file, offset);
+	}
+	if (err >= 0) {
+		err = fs->op->seek(p_file, offset, SEEK_SET);
+	}
+	if (err >= 0) {
+		err = write ? fs->op->write(ptr, len, p_file) : fs->op->read(ptr, len, p_file);
+		fs->op->seek(p_file, pos, SEEK_SET);
+	}
+	fs_unprotect(fs);
+
+	if (write && (err > 0) && (p_file->type == FILE_NORMAL)) {
+		pcache_update(p_file, offset, ptr, err);
+	}
 	return err;
 }
 
+/**
+ * 从指定位置读取，不改变文件的读写位置。不支持定位的文件返回-1
+ */
+int sys_pread(int file, char *ptr, int len, int offset) {
+	return sys_rw_at(file, ptr, len, offset, 0);
+}
+
+/**
+ * 写入到指定位置，不改变文件的读写位置
+ */
+int sys_pwrite(int file, char *ptr, int len, int offset) {
+	return sys_rw_at(file, ptr, len, offset, 1);
+}
+
 /**
  * 文件访问位置定位
  */
@@ -387,19 +870,42 @@ int sys_close(int file) {
 		return -1;
 	}
 
-	ASSERT(p_file->ref > 0);
+	fs_close_file(p_file);
+	task_remove_fd(file);
+	return 0;
+}
+
+/**
+ * @brief 释放对文件的一个引用，最后一个引用释放时关闭文件
+ */
+void fs_close_file (file_t * file) {
+	ASSERT(file->ref > 0);
 
-	if (p_file->ref-- == 1) {
-		fs_t * fs = p_file->fs;
+	if (file->ref-- == 1) {
+		fs_t * fs = file->fs;
 
 		fs_protect(fs);
-		fs->op->close(p_file);
+		fs->op->close(file);
 		fs_unprotect(fs);
-	    file_free(p_file);
+	    file_free(file);
 	}
+}
 
-	task_remove_fd(file);
-	return 0;
+/**
+ * @brief 从文件的指定位置读取，不改变文件当前的读写位置
+ */
+int fs_read_file_at (file_t * file, uint32_t offset, char * buf, int size) {
+	fs_t * fs = file->fs;
+	int err = -1;
+
+	fs_protect(fs);
+	int pos = file->pos;
+	if (fs->op->seek(file, offset, SEEK_SET) >= 0) {
+		err = fs->op->read(buf, size, file);
+		fs->op->seek(file, pos, SEEK_SET);
+	}
+	fs_unprotect(fs);
+	return err;
 }
 
 
@@ -442,10 +948,29 @@ int sys_fstat(int file, struct stat *st) {
 	return err;
 }
 
+/**
+ * @brief 打开目录。readdir和closedir只针对根文件系统
+ */
 int sys_opendir(const char * name, DIR * dir) {
-	fs_protect(root_fs);
-	int err = root_fs->op->opendir(root_fs, name, dir);
-	fs_unprotect(root_fs);
+	char path[FILE_PATH_SIZE];
+
+	if (path_normalize(name, path) < 0) {
+		return -1;
+	}
+
+	const char * sub;
+	fs_t * fs = path_to_fs(path, &sub);
+	if ((fs != root_fs) || !fs->op->opendir) {
+		return -1;
+	}
+
+	fs_protect(fs);
+	int err = -1;
+	dir->ino = path_walk_dir(fs, sub);
+	if (dir->ino >= 0) {
+		err = fs->op->opendir(fs, sub, dir);
+	}
+	fs_unprotect(fs);
 	return err;
 }
 
@@ -463,9 +988,75 @@ int sys_closedir(DIR *dir) {
 	return err;
 }
 
+/**
+ * @brief 删除文件
+ */
 int sys_unlink (const char * path) {
-	fs_protect(root_fs);
-	int err = root_fs->op->unlink(root_fs, path);
-	fs_unprotect(root_fs);
+	char abs_path[FILE_PATH_SIZE];
+	char name[FILE_PATH_SIZE];
+
+	if (path_normalize(path, abs_path) < 0) {
+		return -1;
+	}
+
+	const char * sub;
+	fs_t * fs = path_to_fs(abs_path, &sub);
+	if (!fs->op->unlink) {
+		return -1;
+	}
+
+	fs_protect(fs);
+	int err = -1;
+	dentry_t dentry;
+	int dir = path_walk_parent(fs, sub, name);
+	if ((dir >= 0) && (!fs->op->lookup || (fs_lookup(fs, dir, name, &dentry) == 0))) {
+		err = fs->op->unlink(fs, dir, name);
+		dcache_invalidate_dir(fs, dir);
+	}
+	fs_unprotect(fs);
+
+	// 文件的缓存页不再有效
+	if ((err == 0) && fs->op->lookup) {
+		pcache_invalidate(fs, dir, dentry.index);
+	}
 	return err;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 切换当前工作目录
+ */
+int sys_chdir (const char * path) {
+	char abs_path[FILE_PATH_SIZE];
+
+	if (path_normalize(path, abs_path) < 0) {
+		return -1;
+	}
+
+	// 检查目录是否存在
+	const char * sub;
+	fs_t * fs = path_to_fs(abs_path, &sub);
+	fs_protect(fs);
+	int dir = path_walk_dir(fs, sub);
+	fs_unprotect(fs);
+	if (dir < 0) {
+		return -1;
+	}
+
+	task_t * task = task_current();
+	kernel_strncpy(task->files->cwd, abs_path, sizeof(task->files->cwd));
+	return 0;
+}
+
+/**
+ * @brief 获取当前工作目录
+ */
+int sys_getcwd (char * buf, int size) {
+	task_t * task = task_current();
+
+	if (!buf || (kernel_strlen(task->files->cwd) >= size)) {
+		return -1;
+	}
+
+	kernel_strncpy(buf, task->files->cwd, size);
+	return 0;
+}
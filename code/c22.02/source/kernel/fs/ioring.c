@@ -0,0 +1,105 @@
+/**
+ * 批量提交的文件操作环
+ *
+ * 应用在自己的内存中准备好一批open/read/write/close等操作，
+ * 一次系统调用由内核依次执行，并把各操作的结果写入完成队列，
+ * 省去每个操作单独进出内核的开销。后面的操作可以引用前面操作的结果，
+ * 如用刚打开的文件读写，或写入刚读到的字节数，从而一批完成整个文件的拷贝。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "fs/ioring.h"
+#include "fs/fs.h"
+#include "core/memory.h"
+#include "core/mmap.h"
+#include "tools/log.h"
+
+/**
+ * @brief 执行一个提交项。results为本批已完成项的结果，count为其数量
+ */
+static int ioring_do_sqe (ioring_sqe_t * sqe, const int * results, int count) {
+    int fd = sqe->fd;
+    uint32_t len = sqe->len;
+
+    // 引用前面的结果，前面的操作失败时本项也失败
+    if (sqe->flags & IOSQE_FD_REF) {
+        if ((fd <= 0) || (fd > count) || (results[count - fd] < 0)) {
+            return -1;
+        }
+        fd = results[count - fd];
+    }
+
+    if (sqe->flags & IOSQE_LEN_REF) {
+        if ((len == 0) || (len > count) || (results[count - len] < 0)) {
+            return -1;
+        }
+        len = results[count - len];
+    }
+
+    switch (sqe->op) {
+    case IORING_OP_NOP:
+        return 0;
+    case IORING_OP_OPEN:
+        return sys_open((const char *)sqe->addr, (int)len);
+    case IORING_OP_READ:
+        return sys_read(fd, (char *)sqe->addr, (int)len);
+    case IORING_OP_WRITE:
+        return len ? sys_write(fd, (char *)sqe->addr, (int)len) : 0;
+    case IORING_OP_CLOSE:
+        return sys_close(fd);
+    case IORING_OP_LSEEK:
+        return sys_lseek(fd, (int)len, 0);
+    default:
+        log_printf("ioring: unknown op %d", sqe->op);
+        return -1;
+    }
+}
+
+/**
+ * @brief 处理提交队列中最多to_submit项，结果写入完成队列。
+ * 完成队列已满时停止，返回已处理的项数
+ */
+int sys_ioring_enter (ioring_t * ring, int to_submit) {
+    if (((uint32_t)ring < MEMORY_TASK_BASE) || (to_submit < 0)) {
+        log_printf("ioring: bad args");
+        return -1;
+    }
+
+    // 环可能位于映射区中，先建立好映射，内核访问时不会出错
+    if (mmap_prefault((uint32_t)ring, sizeof(ioring_t), 1) < 0) {
+        return -1;
+    }
+
+    int results[IORING_ENTRIES];
+    int count = 0;
+
+    uint32_t pending = ring->sq_tail - ring->sq_head;
+    if (pending > IORING_ENTRIES) {
+        log_printf("ioring: bad sq index");
+        return -1;
+    }
+    if (to_submit > pending) {
+        to_submit = pending;
+    }
+
+    while (count < to_submit) {
+        // 完成队列满，等应用取走后再继续
+        if (ring->cq_tail - ring->cq_head >= IORING_ENTRIES) {
+            break;
+        }
+
+        ioring_sqe_t * sqe = ring->sqes + (ring->sq_head & (IORING_ENTRIES - 1));
+        int res = ioring_do_sqe(sqe, results, count);
+        results[count++] = res;
+
+        ioring_cqe_t * cqe = ring->cqes + (ring->cq_tail & (IORING_ENTRIES - 1));
+        cqe->user_data = sqe->user_data;
+        cqe->res = res;
+        ring->cq_tail++;
+        ring->sq_head++;
+    }
+
+    return count;
+}
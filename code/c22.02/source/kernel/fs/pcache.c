@@ -0,0 +1,188 @@
+/**
+ * 文件页缓存
+ * 按(文件, 页序号)缓存文件内容，每项占一个物理页，供mmap映射到进程空间。
+ * 文件用其目录项的位置标识，写入或截断后起始块会变化，而目录项的位置不变。
+ * 缓存本身持有页的一个引用，每个映射再各持有一个，所以同一文件的同一页在各进程间共享。
+ * 替换时只选择未被映射的页
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "fs/pcache.h"
+#include "fs/fs.h"
+#include "core/memory.h"
+#include "tools/klib.h"
+#include "tools/log.h"
+#include "ipc/mutex.h"
+
+static pcache_page_t * page_tbl;                    // 缓存页表，从物理页中分配
+static list_t hash_tbl[PCACHE_HASH_SIZE];           // 哈希桶
+static list_t lru_list;                             // 替换队列，最近使用的在最前
+static mutex_t pcache_mutex;                        // 访问缓存的互斥信号量
+
+/**
+ * @brief 计算哈希值
+ */
+static int pcache_hash (struct _fs_t * fs, int dir, int slot, uint32_t index) {
+    return ((uint32_t)fs ^ (uint32_t)dir * 31 ^ (uint32_t)slot * 131 ^ index * 2654435761u) % PCACHE_HASH_SIZE;
+}
+
+/**
+ * @brief 查找缓存页，需在持有锁时调用
+ */
+static pcache_page_t * pcache_find (struct _fs_t * fs, int dir, int slot, uint32_t index) {
+    list_t * bucket = hash_tbl + pcache_hash(fs, dir, slot, index);
+
+    for (list_node_t * node = list_first(bucket); node; node = list_node_next(node)) {
+        pcache_page_t * page = list_node_parent(node, pcache_page_t, hash_node);
+        if ((page->fs == fs) && (page->dir == dir) && (page->slot == slot) && (page->index == index)) {
+            return page;
+        }
+    }
+
+    return (pcache_page_t *)0;
+}
+
+/**
+ * @brief 移除缓存页，并释放缓存对物理页的引用
+ */
+static void pcache_remove (pcache_page_t * page) {
+    list_remove(hash_tbl + pcache_hash(page->fs, page->dir, page->slot, page->index), &page->hash_node);
+    memory_page_unref(page->paddr);
+    page->fs = (struct _fs_t *)0;
+
+    // 放到最后，优先被复用
+    list_remove(&lru_list, &page->lru_node);
+    list_insert_last(&lru_list, &page->lru_node);
+}
+
+/**
+ * @brief 找一个可用的缓存项：未使用的，或者最久未使用且没有被映射的
+ */
+static pcache_page_t * pcache_alloc (void) {
+    for (list_node_t * node = list_last(&lru_list); node; node = list_node_pre(node)) {
+        pcache_page_t * page = list_node_parent(node, pcache_page_t, lru_node);
+        if (page->fs == (struct _fs_t *)0) {
+            return page;
+        }
+
+        // 只有缓存自身引用，可以替换
+        if (memory_page_ref_count(page->paddr) == 1) {
+            pcache_remove(page);
+            return page;
+        }
+    }
+
+    return (pcache_page_t *)0;
+}
+
+/**
+ * @brief 初始化页缓存
+ */
+void pcache_init (void) {
+    mutex_init(&pcache_mutex);
+    list_init(&lru_list);
+    for (int i = 0; i < PCACHE_HASH_SIZE; i++) {
+        list_init(hash_tbl + i);
+    }
+
+    int page_count = up2(PCACHE_NR * sizeof(pcache_page_t), MEM_PAGE_SIZE) / MEM_PAGE_SIZE;
+    page_tbl = (pcache_page_t *)memory_alloc_pages(page_count);
+    ASSERT(page_tbl != (pcache_page_t *)0);
+    kernel_memset(page_tbl, 0, PCACHE_NR * sizeof(pcache_page_t));
+    for (int i = 0; i < PCACHE_NR; i++) {
+        list_insert_last(&lru_list, &page_tbl[i].lru_node);
+    }
+}
+
+/**
+ * @brief 获取文件第index页所在的物理页，同时为调用者增加一个引用
+ * 缓存满且各页都在使用时，返回一个不缓存的页，由调用者独占。失败返回0
+ */
+uint32_t pcache_get (file_t * file, uint32_t index) {
+    uint32_t paddr = 0;
+
+    mutex_lock(&pcache_mutex);
+
+    // 已经缓存
+    pcache_page_t * page = pcache_find(file->fs, file->pblk, file->p_index, index);
+    if (page) {
+        list_remove(&lru_list, &page->lru_node);
+        list_insert_first(&lru_list, &page->lru_node);
+
+        paddr = page->paddr;
+        memory_page_ref(paddr);
+        goto get_end;
+    }
+
+    // 从文件中读取，文件末尾之后的部分清0
+    paddr = memory_alloc_page();
+    if (paddr == 0) {
+        log_printf("pcache: no memory.");
+        goto get_end;
+    }
+
+    kernel_memset((void *)paddr, 0, MEM_PAGE_SIZE);
+    if (fs_read_file_at(file, index * MEM_PAGE_SIZE, (char *)paddr, MEM_PAGE_SIZE) < 0) {
+        memory_free_page(paddr);
+        paddr = 0;
+        goto get_end;
+    }
+
+    // 加入缓存，缓存和调用者各持有一个引用
+    page = pcache_alloc();
+    if (page) {
+        page->fs = file->fs;
+        page->dir = file->pblk;
+        page->slot = file->p_index;
+        page->index = index;
+        page->paddr = paddr;
+        list_insert_first(hash_tbl + pcache_hash(page->fs, page->dir, page->slot, index), &page->hash_node);
+        list_remove(&lru_list, &page->lru_node);
+        list_insert_first(&lru_list, &page->lru_node);
+        memory_page_ref(paddr);
+    }
+
+get_end:
+    mutex_unlock(&pcache_mutex);
+    return paddr;
+}
+
+/**
+ * @brief 文件写入后，同步更新已缓存的页，使映射中的内容与文件一致
+ */
+void pcache_update (file_t * file, uint32_t pos, const char * buf, int size) {
+    mutex_lock(&pcache_mutex);
+    while (size > 0) {
+        uint32_t offset = pos % MEM_PAGE_SIZE;
+        int curr_size = MEM_PAGE_SIZE - offset;
+        if (curr_size > size) {
+            curr_size = size;
+        }
+
+        pcache_page_t * page = pcache_find(file->fs, file->pblk, file->p_index, pos / MEM_PAGE_SIZE);
+        if (page) {
+            kernel_memcpy((uint8_t *)page->paddr + offset, (void *)buf, curr_size);
+        }
+
+        pos += curr_size;
+        buf += curr_size;
+        size -= curr_size;
+    }
+    mutex_unlock(&pcache_mutex);
+}
+
+/**
+ * @brief 文件被截断或删除后，丢弃其所有缓存页。已映射的页由映射继续持有，直到解除映射
+ */
+void pcache_invalidate (struct _fs_t * fs, int dir, int slot) {
+    mutex_lock(&pcache_mutex);
+    for (int i = 0; i < PCACHE_NR; i++) {
+        pcache_page_t * page = page_tbl + i;
+        if ((page->fs == fs) && (page->dir == dir) && (page->slot == slot)) {
+            pcache_remove(page);
+        }
+    }
+    mutex_unlock(&pcache_mutex);
+}
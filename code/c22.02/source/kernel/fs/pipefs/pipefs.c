@@ -0,0 +1,307 @@
+/**
+ * 管道文件系统
+ *
+ * 管道的数据存放在一页大小的环形缓存中，读写时一次拷贝尽可能多的连续数据，
+ * 缓存回绕时最多分两段拷贝。读端在缓存空时阻塞，写端在缓存满时阻塞。
+ * 管道没有挂载点下的文件，只能通过pipe()创建。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "fs/pipefs/pipefs.h"
+#include "fs/fs.h"
+#include "core/task.h"
+#include "cpu/irq.h"
+#include "tools/klib.h"
+#include "tools/log.h"
+#include "fs/poll.h"
+#include <sys/file.h>
+
+static pipe_t pipe_tbl[PIPE_NR];
+
+/**
+ * @brief 阻塞当前进程，直到被pipe_wakeup唤醒。需在中断保护中调用
+ */
+static void pipe_wait (list_t * wait_list) {
+    task_t * curr = task_current();
+    task_set_block(curr);
+    list_insert_last(wait_list, &curr->wait_node);
+    task_dispatch();
+}
+
+/**
+ * @brief 唤醒等待队列中的所有进程。需在中断保护中调用
+ */
+static void pipe_wakeup (list_t * wait_list) {
+    while (list_count(wait_list)) {
+        list_node_t * node = list_remove_first(wait_list);
+        task_t * task = list_node_parent(node, task_t, wait_node);
+        task_set_ready(task);
+    }
+}
+
+/**
+ * @brief 唤醒等待读或写的进程，以及poll等待的进程。需在中断保护中调用
+ */
+static void pipe_wakeup_all (pipe_t * pipe, list_t * wait_list) {
+    pipe_wakeup(wait_list);
+    poll_wakeup(&pipe->poll_list);
+}
+
+/**
+ * @brief 从缓存中取出最多size字节的数据
+ */
+static int pipe_copy_out (pipe_t * pipe, char * buf, int size) {
+    uint32_t count = pipe->write_cnt - pipe->read_cnt;
+    if (count > size) {
+        count = size;
+    }
+
+    // 先拷贝到缓存末尾，回绕的部分再从头拷贝
+    uint32_t offset = pipe->read_cnt % PIPE_BUF_SIZE;
+    uint32_t first = PIPE_BUF_SIZE - offset;
+    if (first > count) {
+        first = count;
+    }
+    kernel_memcpy(buf, pipe->buf + offset, first);
+    kernel_memcpy(buf + first, pipe->buf, count - first);
+
+    pipe->read_cnt += count;
+    return count;
+}
+
+/**
+ * @brief 向缓存中写入最多size字节的数据
+ */
+static int pipe_copy_in (pipe_t * pipe, const char * buf, int size) {
+    uint32_t count = PIPE_BUF_SIZE - (pipe->write_cnt - pipe->read_cnt);
+    if (count > size) {
+        count = size;
+    }
+
+    uint32_t offset = pipe->write_cnt % PIPE_BUF_SIZE;
+    uint32_t first = PIPE_BUF_SIZE - offset;
+    if (first > count) {
+        first = count;
+    }
+    kernel_memcpy(pipe->buf + offset, (void *)buf, first);
+    kernel_memcpy(pipe->buf, (void *)(buf + first), count - first);
+
+    pipe->write_cnt += count;
+    return count;
+}
+
+/**
+ * @brief 创建管道，rfile为读端，wfile为写端
+ */
+int pipefs_create (fs_t * fs, file_t * rfile, file_t * wfile) {
+    uint32_t buf = memory_alloc_page();
+    if (buf == 0) {
+        log_printf("no memory for pipe");
+        return -1;
+    }
+
+    irq_state_t state = irq_enter_protection();
+    pipe_t * pipe = (pipe_t *)0;
+    for (int i = 0; i < PIPE_NR; i++) {
+        if (pipe_tbl[i].buf == (char *)0) {
+            pipe = pipe_tbl + i;
+            pipe->buf = (char *)buf;
+            break;
+        }
+    }
+    irq_leave_protection(state);
+
+    if (!pipe) {
+        log_printf("no free pipe");
+        memory_free_page(buf);
+        return -1;
+    }
+
+    pipe->read_cnt = pipe->write_cnt = 0;
+    pipe->readers = pipe->writers = 1;
+    list_init(&pipe->read_wait);
+    list_init(&pipe->write_wait);
+    list_init(&pipe->poll_list);
+
+    file_t * file_list[] = {rfile, wfile};
+    for (int i = 0; i < 2; i++) {
+        file_t * file = file_list[i];
+        kernel_strncpy(file->file_name, "pipe", FILE_NAME_SIZE);
+        file->type = FILE_PIPE;
+        file->fs = fs;
+        file->data = pipe;
+        file->mode = (file == rfile) ? O_RDONLY : O_WRONLY;
+    }
+    return 0;
+}
+
+/**
+ * @brief 挂载管道文件系统，仅供内部使用
+ */
+int pipefs_mount (struct _fs_t * fs, int major, int minor) {
+    fs->type = FS_PIPEFS;
+    return 0;
+}
+
+void pipefs_unmount (struct _fs_t * fs) {
+}
+
+/**
+ * @brief 管道只能通过pipe()创建，不能按路径打开
+ */
+int pipefs_open (struct _fs_t * fs, const char * path, file_t * file) {
+    return -1;
+}
+
+/**
+ * @brief 读管道。缓存为空时等待，所有写端都关闭后返回0
+ */
+int pipefs_read (char * buf, int size, file_t * file) {
+    pipe_t * pipe = (pipe_t *)file->data;
+
+    irq_state_t state = irq_enter_protection();
+    while (pipe->write_cnt == pipe->read_cnt) {
+        if (pipe->writers == 0) {
+            irq_leave_protection(state);
+            return 0;
+        }
+        pipe_wait(&pipe->read_wait);
+    }
+
+    int count = pipe_copy_out(pipe, buf, size);
+    pipe_wakeup_all(pipe, &pipe->write_wait);
+    irq_leave_protection(state);
+    return count;
+}
+
+/**
+ * @brief 依次写入多个缓存，写完全部数据才返回，中间只在缓存满时唤醒读端。
+ * 所有读端都关闭后，返回已写入的量或-1
+ */
+int pipefs_writev (const struct iovec * iov, int iovcnt, file_t * file) {
+    pipe_t * pipe = (pipe_t *)file->data;
+    int total = 0;
+
+    irq_state_t state = irq_enter_protection();
+    for (int i = 0; (i < iovcnt) && pipe->readers; i++) {
+        const char * buf = (const char *)iov[i].iov_base;
+        int size = iov[i].iov_len;
+        int done = 0;
+
+        while ((done < size) && pipe->readers) {
+            int count = pipe_copy_in(pipe, buf + done, size - done);
+            if (count == 0) {
+                // 缓存已满，让读端取走数据
+                pipe_wakeup_all(pipe, &pipe->read_wait);
+                pipe_wait(&pipe->write_wait);
+                continue;
+            }
+            done += count;
+        }
+        total += done;
+    }
+    pipe_wakeup_all(pipe, &pipe->read_wait);
+    irq_leave_protection(state);
+
+    return total ? total : -1;
+}
+
+/**
+ * @brief 写管道，写完全部数据才返回
+ */
+int pipefs_write (char * buf, int size, file_t * file) {
+    struct iovec iov = {buf, size};
+    return pipefs_writev(&iov, 1, file);
+}
+
+/**
+ * @brief 关闭管道的一端，两端都关闭后释放管道
+ */
+void pipefs_close (file_t * file) {
+    pipe_t * pipe = (pipe_t *)file->data;
+
+    irq_state_t state = irq_enter_protection();
+    if (file->mode == O_RDONLY) {
+        pipe->readers--;
+    } else {
+        pipe->writers--;
+    }
+
+    // 唤醒另一端，使其能检查到对端已经关闭
+    pipe_wakeup(&pipe->read_wait);
+    pipe_wakeup_all(pipe, &pipe->write_wait);
+
+    uint32_t buf = 0;
+    if ((pipe->readers == 0) && (pipe->writers == 0)) {
+        buf = (uint32_t)pipe->buf;
+        pipe->buf = (char *)0;
+    }
+    irq_leave_protection(state);
+
+    if (buf) {
+        memory_free_page(buf);
+    }
+}
+
+int pipefs_seek (file_t * file, uint32_t offset, int dir) {
+    return -1;  // 不支持定位
+}
+
+int pipefs_stat(file_t * file, struct stat *st) {
+    pipe_t * pipe = (pipe_t *)file->data;
+
+    st->st_mode = S_IFIFO;
+    st->st_size = pipe->write_cnt - pipe->read_cnt;
+    return 0;
+}
+
+/**
+ * @brief 读端有数据或写端已全部关闭时可读，写端有空间时可写，读端已全部关闭时出错
+ */
+int pipefs_poll (file_t * file, poll_table_t * table) {
+    pipe_t * pipe = (pipe_t *)file->data;
+    int mask = 0;
+
+    poll_wait(table, &pipe->poll_list);
+
+    irq_state_t state = irq_enter_protection();
+    uint32_t count = pipe->write_cnt - pipe->read_cnt;
+    if (file->mode == O_RDONLY) {
+        if (count) {
+            mask |= POLLIN;
+        }
+        if (pipe->writers == 0) {
+            mask |= POLLIN | POLLHUP;
+        }
+    } else {
+        if (count < PIPE_BUF_SIZE) {
+            mask |= POLLOUT;
+        }
+        if (pipe->readers == 0) {
+            mask |= POLLERR;
+        }
+    }
+    irq_leave_protection(state);
+    return mask;
+}
+
+int pipefs_ioctl(file_t * file, int cmd, int arg0, int arg1) {
+    return -1;
+}
+
+// 管道文件系统
+fs_op_t pipefs_op = {
+    .mount = pipefs_mount,
+    .unmount = pipefs_unmount,
+    .open = pipefs_open,
+    .read = pipefs_read,
+    .write = pipefs_write,
+    .seek = pipefs_seek,
+    .stat = pipefs_stat,
+    .close = pipefs_close,
+    .ioctl = pipefs_ioctl,
+    .writev = pipefs_writev,
+    .poll = pipefs_poll,
+};
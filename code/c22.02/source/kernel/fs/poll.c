@@ -0,0 +1,148 @@
+/**
+ * 多个文件的事件等待
+ *
+ * 调用者在内核栈上准备一个等待记录，逐个询问文件当前的状态，
+ * 同时将记录中的结点挂到各文件的等待队列中。没有文件就绪时在记录的信号量上等待，
+ * 任一文件状态变化时通过poll_wakeup通知，再重新询问一遍。
+ * 文件先挂结点再检查状态，所以检查之后到开始等待之间发生的事件不会丢失。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "fs/poll.h"
+#include "fs/fs.h"
+#include "core/task.h"
+#include "core/mmap.h"
+#include "dev/time.h"
+#include "cpu/irq.h"
+#include "os_cfg.h"
+
+/**
+ * @brief 将等待记录挂到文件的等待队列中，table为空时只查询状态
+ */
+void poll_wait (poll_table_t * table, list_t * list) {
+    if (!table || (table->count >= POLL_FD_MAX)) {
+        return;
+    }
+
+    poll_entry_t * entry = table->entry + table->count++;
+    entry->list = list;
+    entry->table = table;
+
+    irq_state_t state = irq_enter_protection();
+    list_insert_last(list, &entry->node);
+    irq_leave_protection(state);
+}
+
+/**
+ * @brief 通知等待队列中的所有调用者，每个等待记录每轮只通知一次
+ * 通知时可能切换到等待者运行并修改队列，所以每次通知后从头查找
+ */
+void poll_wakeup (list_t * list) {
+    irq_state_t state = irq_enter_protection();
+    list_node_t * node = list_first(list);
+    while (node) {
+        poll_entry_t * entry = list_node_parent(node, poll_entry_t, node);
+        poll_table_t * table = entry->table;
+        if (!table->woken) {
+            table->woken = 1;
+            sem_notify(&table->sem);
+            node = list_first(list);
+        } else {
+            node = list_node_next(node);
+        }
+    }
+    irq_leave_protection(state);
+}
+
+/**
+ * @brief 将等待记录从所有文件的等待队列中移除
+ */
+static void poll_free (poll_table_t * table) {
+    irq_state_t state = irq_enter_protection();
+    for (int i = 0; i < table->count; i++) {
+        poll_entry_t * entry = table->entry + i;
+        list_remove(entry->list, &entry->node);
+    }
+    table->count = 0;
+    irq_leave_protection(state);
+}
+
+/**
+ * @brief 询问各文件的状态，返回有事件的文件数量
+ * 不提供poll接口的文件系统，如磁盘文件，读写不会阻塞，总是就绪
+ */
+static int poll_scan (struct pollfd * fds, int nfds, poll_table_t * table) {
+    int ready = 0;
+
+    for (int i = 0; i < nfds; i++) {
+        struct pollfd * pfd = fds + i;
+        pfd->revents = 0;
+        if (pfd->fd < 0) {
+            continue;
+        }
+
+        file_t * file = task_file(pfd->fd);
+        if (file == (file_t *)0) {
+            pfd->revents = POLLNVAL;
+        } else {
+            fs_op_t * op = file->fs->op;
+            int mask = op->poll ? op->poll(file, table) : (POLLIN | POLLOUT);
+            // 错误、挂断及无效状态不论是否关心都要报告
+            pfd->revents = mask & (pfd->events | POLLERR | POLLHUP | POLLNVAL);
+        }
+
+        if (pfd->revents) {
+            ready++;
+        }
+    }
+
+    return ready;
+}
+
+/**
+ * @brief 等待多个文件中的任一个有事件，timeout为毫秒，小于0时一直等待，为0时不等待
+ * 返回有事件的文件数量，超时返回0
+ */
+int sys_poll (struct pollfd * fds, int nfds, int timeout) {
+    if ((nfds < 0) || (nfds > POLL_FD_MAX)) {
+        return -1;
+    }
+
+    if (nfds && (mmap_prefault((uint32_t)fds, nfds * sizeof(struct pollfd), 1) < 0)) {
+        return -1;
+    }
+
+    uint32_t deadline = time_get_tick() + (timeout + OS_TICK_MS - 1) / OS_TICK_MS;
+    poll_table_t table;
+    table.count = 0;
+
+    int ready;
+    for (;;) {
+        sem_init(&table.sem, 0);
+        table.woken = 0;
+
+        ready = poll_scan(fds, nfds, timeout ? &table : (poll_table_t *)0);
+        if (ready || (timeout == 0)) {
+            break;
+        }
+
+        if (timeout < 0) {
+            sem_wait(&table.sem);
+        } else {
+            int left = (int)(deadline - time_get_tick());
+            if ((left <= 0) || (sem_wait_timeout(&table.sem, left * OS_TICK_MS) < 0)) {
+                // 超时，再检查一次
+                poll_free(&table);
+                ready = poll_scan(fds, nfds, (poll_table_t *)0);
+                break;
+            }
+        }
+
+        poll_free(&table);
+    }
+
+    poll_free(&table);
+    return ready;
+}
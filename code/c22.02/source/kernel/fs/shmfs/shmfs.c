@@ -0,0 +1,223 @@
+/**
+ * 共享内存文件系统
+ *
+ * 每个共享内存段有一个名称，通过shm_open打开后得到文件，再用mmap映射到进程空间。
+ * 段中的页在首次访问时分配，映射到各进程时增加页的引用计数；
+ * 段在最后一个打开的文件关闭后释放，映射区域持有文件，所以会保留到最后一次解除映射。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "fs/shmfs/shmfs.h"
+#include "fs/fs.h"
+#include "ipc/mutex.h"
+#include "tools/klib.h"
+#include "tools/log.h"
+#include <sys/file.h>
+
+static shm_t shm_tbl[SHM_NR];
+static mutex_t shm_mutex;
+
+/**
+ * @brief 按名称查找共享内存段
+ */
+static shm_t * shm_find (const char * name) {
+    for (int i = 0; i < SHM_NR; i++) {
+        shm_t * shm = shm_tbl + i;
+        if (shm->ref && !shm->anon && (kernel_strncmp(shm->name, name, SHM_NAME_SIZE) == 0)) {
+            return shm;
+        }
+    }
+
+    return (shm_t *)0;
+}
+
+/**
+ * @brief 分配新的共享内存段，name为0时分配无名段
+ */
+static shm_t * shm_alloc (const char * name, uint32_t size) {
+    if ((size == 0) || (size > SHM_MAX_PAGES * MEM_PAGE_SIZE)) {
+        log_printf("shm: invalid size %d", size);
+        return (shm_t *)0;
+    }
+
+    for (int i = 0; i < SHM_NR; i++) {
+        shm_t * shm = shm_tbl + i;
+        if (shm->ref == 0) {
+            shm->page_tbl = (uint32_t *)memory_alloc_page();
+            if (!shm->page_tbl) {
+                log_printf("shm: no memory");
+                return (shm_t *)0;
+            }
+
+            kernel_memset(shm->page_tbl, 0, MEM_PAGE_SIZE);
+            kernel_strncpy(shm->name, name ? name : "anon", SHM_NAME_SIZE);
+            shm->anon = (name == (const char *)0);
+            shm->size = size;
+            return shm;
+        }
+    }
+
+    log_printf("shm: no free segment");
+    return (shm_t *)0;
+}
+
+/**
+ * @brief 释放共享内存段。各进程映射的页有自己的引用，这里只释放段持有的引用
+ */
+static void shm_free (shm_t * shm) {
+    for (int i = 0; i < SHM_MAX_PAGES; i++) {
+        if (shm->page_tbl[i]) {
+            memory_page_unref(shm->page_tbl[i]);
+        }
+    }
+
+    memory_free_page((uint32_t)shm->page_tbl);
+    shm->page_tbl = (uint32_t *)0;
+    shm->name[0] = '\0';
+}
+
+/**
+ * @brief 设置打开的共享内存段文件
+ */
+static void shm_file_init (fs_t * fs, shm_t * shm, file_t * file) {
+    kernel_strncpy(file->file_name, shm->name, FILE_NAME_SIZE);
+    file->type = FILE_SHM;
+    file->fs = fs;
+    file->size = shm->size;
+    file->pos = 0;
+    file->data = shm;
+    shm->ref++;
+}
+
+/**
+ * @brief 打开名称为name的共享内存段，不存在且flags中有O_CREAT时，创建大小为size的段
+ * name为0时总是创建新的无名段
+ */
+int shmfs_create (fs_t * fs, const char * name, int flags, uint32_t size, file_t * file) {
+    int err = -1;
+
+    mutex_lock(&shm_mutex);
+    shm_t * shm = name ? shm_find(name) : (shm_t *)0;
+    if (shm && (flags & O_EXCL) && (flags & O_CREAT)) {
+        log_printf("shm: %s exists", name);
+        goto shmfs_create_end;
+    } else if (!shm && (flags & O_CREAT)) {
+        shm = shm_alloc(name, up2(size, MEM_PAGE_SIZE));
+    }
+
+    if (shm) {
+        shm_file_init(fs, shm, file);
+        err = 0;
+    }
+shmfs_create_end:
+    mutex_unlock(&shm_mutex);
+    return err;
+}
+
+/**
+ * @brief 取共享内存段中的一页，首次访问时分配并清0。返回的页已为调用者增加引用
+ */
+uint32_t shmfs_get_page (file_t * file, uint32_t index) {
+    shm_t * shm = (shm_t *)file->data;
+    uint32_t paddr = 0;
+
+    mutex_lock(&shm_mutex);
+    if (index >= shm->size / MEM_PAGE_SIZE) {
+        goto shmfs_get_page_end;
+    }
+
+    paddr = shm->page_tbl[index];
+    if (paddr == 0) {
+        paddr = memory_alloc_zero_page();
+        if (paddr == 0) {
+            log_printf("shm: no memory");
+            goto shmfs_get_page_end;
+        }
+        shm->page_tbl[index] = paddr;
+    }
+    memory_page_ref(paddr);
+
+shmfs_get_page_end:
+    mutex_unlock(&shm_mutex);
+    return paddr;
+}
+
+/**
+ * @brief 挂载共享内存文件系统，仅供内部使用
+ */
+int shmfs_mount (struct _fs_t * fs, int major, int minor) {
+    fs->type = FS_SHMFS;
+    mutex_init(&shm_mutex);
+    return 0;
+}
+
+void shmfs_unmount (struct _fs_t * fs) {
+}
+
+/**
+ * @brief 按名称打开已存在的共享内存段
+ */
+int shmfs_open (struct _fs_t * fs, const char * path, file_t * file) {
+    int err = -1;
+
+    mutex_lock(&shm_mutex);
+    shm_t * shm = shm_find(path);
+    if (shm) {
+        shm_file_init(fs, shm, file);
+        err = 0;
+    }
+    mutex_unlock(&shm_mutex);
+    return err;
+}
+
+/**
+ * @brief 共享内存只能通过映射访问
+ */
+int shmfs_read (char * buf, int size, file_t * file) {
+    return -1;
+}
+
+int shmfs_write (char * buf, int size, file_t * file) {
+    return -1;
+}
+
+/**
+ * @brief 关闭共享内存段，最后一个文件关闭时释放段
+ */
+void shmfs_close (file_t * file) {
+    shm_t * shm = (shm_t *)file->data;
+
+    mutex_lock(&shm_mutex);
+    if (--shm->ref == 0) {
+        shm_free(shm);
+    }
+    mutex_unlock(&shm_mutex);
+}
+
+int shmfs_seek (file_t * file, uint32_t offset, int dir) {
+    return -1;  // 不支持定位
+}
+
+int shmfs_stat(file_t * file, struct stat *st) {
+    st->st_size = file->size;
+    return 0;
+}
+
+int shmfs_ioctl(file_t * file, int cmd, int arg0, int arg1) {
+    return -1;
+}
+
+// 共享内存文件系统
+fs_op_t shmfs_op = {
+    .mount = shmfs_mount,
+    .unmount = shmfs_unmount,
+    .open = shmfs_open,
+    .read = shmfs_read,
+    .write = shmfs_write,
+    .seek = shmfs_seek,
+    .stat = shmfs_stat,
+    .close = shmfs_close,
+    .ioctl = shmfs_ioctl,
+};
@@ -11,15 +11,20 @@
 #include "tools/bitmap.h"
 #include "comm/boot_info.h"
 #include "ipc/mutex.h"
+#include "cpu/mmu.h"
 
 #define MEM_EBDA_START              0x00080000
 #define MEM_EXT_START               (1024*1024)
 #define MEM_EXT_END                 (128*1024*1024 - 1)
 #define MEM_PAGE_SIZE               4096        // 和页表大小一致
 
+#define MEM_FB_START                (0x70000000)        // 图形模式下帧缓存在内核空间中的映射地址
 #define MEMORY_TASK_BASE            (0x80000000)        // 进程起始地址空间
 #define MEM_TASK_STACK_TOP          (0xE0000000)        // 初始栈的位置  
 #define MEM_TASK_STACK_SIZE         (MEM_PAGE_SIZE * 500)   // 初始500KB栈
+#define MEM_ZERO_POOL_NR            32          // 预先清0的页数量
+#define MEM_ZERO_POOL_LOW           8           // 少于该数量时开始补充
+
 #define MEM_TASK_ARG_SIZE           (MEM_PAGE_SIZE * 4)     // 参数和环境变量占用的大小
 
 /**
@@ -32,6 +37,7 @@ typedef struct _addr_alloc_t {
     uint32_t page_size;         // 页大小
     uint32_t start;             // 起始地址
     uint32_t size;              // 地址大小
+    uint16_t * ref_tbl;         // 各页的引用计数，为0时不记录
 }addr_alloc_t;
 
 /**
@@ -45,11 +51,20 @@ typedef struct _memory_map_t {
 }memory_map_t;
 
 void memory_init (boot_info_t * boot_info);
+int memory_create_map (pde_t * page_dir, uint32_t vaddr, uint32_t paddr, int count, uint32_t perm);
+pte_t * find_pte (pde_t * page_dir, uint32_t vaddr, int alloc);
+void memory_page_ref (uint32_t paddr);
+void memory_page_unref (uint32_t paddr);
+int memory_page_ref_count (uint32_t paddr);
 uint32_t memory_create_uvm (void);
 uint32_t memory_alloc_for_page_dir (uint32_t page_dir, uint32_t vaddr, uint32_t size, int perm);
 int memory_alloc_page_for (uint32_t addr, uint32_t size, int perm);
 uint32_t memory_alloc_page (void);
 void memory_free_page (uint32_t addr);
+uint32_t memory_alloc_pages (int page_count);
+void memory_free_pages (uint32_t addr, int page_count);
+uint32_t memory_alloc_zero_page (void);
+void memory_worker_init (void);
 void memory_destroy_uvm (uint32_t page_dir);
 uint32_t memory_copy_uvm (uint32_t page_dir);
 uint32_t memory_get_paddr (uint32_t page_dir, uint32_t vaddr);
@@ -0,0 +1,73 @@
+/**
+ * 内存映射
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef MMAP_H
+#define MMAP_H
+
+#include "comm/types.h"
+#include "tools/list.h"
+#include "fs/file.h"
+
+#define MMAP_START              0xC0000000      // 映射区起始地址
+#define MMAP_END                0xDF000000      // 映射区结束地址，其后为用户栈
+#define MMAP_VMA_NR             256             // 系统中最多的映射区域数量
+
+#ifndef PROT_READ
+#define PROT_NONE               0               // 不可访问
+#define PROT_READ               (1 << 0)        // 可读
+#define PROT_WRITE              (1 << 1)        // 可写
+#define PROT_EXEC               (1 << 2)        // 可执行
+#endif
+
+#ifndef MAP_SHARED
+#define MAP_SHARED              (1 << 0)        // 各进程共享
+#define MAP_PRIVATE             (1 << 1)        // 写时为进程私有
+#define MAP_FIXED               (1 << 4)        // 使用指定的地址
+#define MAP_ANONYMOUS           (1 << 5)        // 不映射文件，初始内容为0
+#define MAP_ANON                MAP_ANONYMOUS
+#define MAP_FAILED              ((void *)-1)    // 映射失败的返回值
+#endif
+
+/**
+ * mmap的参数，参数较多，以结构体传递
+ */
+typedef struct _mmap_args_t {
+    void * addr;                // 建议的起始地址
+    uint32_t length;            // 长度
+    int prot;                   // 访问权限
+    int flags;                  // 映射方式
+    int fd;                     // 文件
+    uint32_t offset;            // 在文件中的偏移，需页对齐
+}mmap_args_t;
+
+struct _task_t;
+struct _task_mm_t;
+
+/**
+ * 进程中的一块映射区域
+ */
+typedef struct _vma_t {
+    uint32_t start;             // 起始地址
+    uint32_t end;               // 结束地址，不含
+    int prot;                   // 访问权限
+    int flags;                  // 映射方式
+    file_t * file;              // 映射的文件
+    uint32_t offset;            // start对应在文件中的偏移
+
+    list_node_t node;           // 进程映射区列表中的结点
+}vma_t;
+
+void mmap_init (void);
+int mmap_fault (uint32_t addr, int error_code);
+int mmap_prefault (uint32_t addr, uint32_t size, int write);
+int mmap_copy (struct _task_mm_t * to, struct _task_mm_t * from);
+void mmap_destroy (struct _task_mm_t * mm);
+
+void * sys_mmap (mmap_args_t * args);
+int sys_munmap (void * addr, uint32_t length);
+
+#endif // MMAP_H
@@ -33,6 +33,25 @@
 #define SYS_readdir				61
 #define SYS_closedir			62
 #define SYS_unlink				63
+#define SYS_chdir				64
+#define SYS_getcwd				65
+#define SYS_mmap				66
+#define SYS_munmap				67
+#define SYS_pipe				68
+#define SYS_dup2				69
+#define SYS_shm_open			70
+#define SYS_ksem_open			71
+#define SYS_ksem_wait			72
+#define SYS_ksem_post			73
+#define SYS_ksem_close			74
+#define SYS_futex				75
+#define SYS_clone				76
+#define SYS_ioring_enter		77
+#define SYS_readv				78
+#define SYS_writev				79
+#define SYS_pread				80
+#define SYS_pwrite				81
+#define SYS_poll				82
 
 
 #define SYS_printmsg            100
@@ -50,5 +69,6 @@ typedef struct _syscall_frame_t {
 }syscall_frame_t;
 
 void exception_handler_syscall (void);		// syscall处理
+void exception_handler_sysenter (void);		// sysenter快速系统调用处理
 
 #endif //OS_SYSCALL_H
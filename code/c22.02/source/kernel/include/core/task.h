@@ -12,6 +12,7 @@
 #include "cpu/cpu.h"
 #include "tools/list.h"
 #include "fs/file.h"
+#include "ipc/sem.h"
 
 #define TASK_NAME_SIZE				32			// 任务名字长度
 #define TASK_TIME_SLICE_DEFAULT		10			// 时间片计数
@@ -25,6 +26,28 @@ typedef struct _task_args_t {
 	char **argv;
 }task_args_t;
 
+/**
+ * @brief 地址空间，同一进程中的各线程共享
+ */
+typedef struct _task_mm_t {
+	int ref;					// 使用该地址空间的任务数量，为0表示空闲
+	uint32_t page_dir;			// 页目录
+	uint32_t heap_start;		// 堆的顶层地址
+	uint32_t heap_end;			// 堆结束地址
+	list_t vma_list;			// 内存映射区域，按地址排列
+	struct _mutex_t * mutex;	// 映射区域的互斥访问锁
+}task_mm_t;
+
+/**
+ * @brief 打开的文件表，同一进程中的各线程共享
+ */
+typedef struct _task_files_t {
+	int ref;					// 使用该文件表的任务数量，为0表示空闲
+    file_t * file_table[TASK_OFILE_NR];	// 任务最多打开的文件数量
+    char cwd[FILE_PATH_SIZE];	// 当前工作目录，为规范的绝对路径
+    uint8_t ksem_ref[KSEM_NR];	// 本进程打开各有名信号量的次数
+}task_files_t;
+
 /**
  * @brief 任务控制块结构
  */
@@ -42,21 +65,21 @@ typedef struct _task_t {
 
     int pid;				// 进程的pid
     struct _task_t * parent;		// 父进程
-	uint32_t heap_start;		// 堆的顶层地址
-	uint32_t heap_end;			// 堆结束地址
     int status;				// 进程执行结果
 
     int sleep_ticks;		// 睡眠时间
     int time_slice;			// 时间片
 	int slice_ticks;		// 递减时间片计数
 
-    file_t * file_table[TASK_OFILE_NR];	// 任务最多打开的文件数量
+	task_mm_t * mm;				// 地址空间
+	task_files_t * files;		// 打开的文件表
 
 	tss_t tss;				// 任务的TSS段
 	uint16_t tss_sel;		// tss选择子
 	
 	list_node_t run_node;		// 运行相关结点
 	list_node_t wait_node;		// 等待队列
+	list_t * wait_list;			// 限时等待时所在的等待队列，超时后由时钟处理移出
 	list_node_t all_node;		// 所有队列结点
 }task_t;
 
@@ -95,6 +118,8 @@ task_t * task_first_task (void);
 
 int sys_getpid (void);
 int sys_fork (void);
+int sys_clone (uint32_t entry, uint32_t stack);
+task_t * kthread_create (const char * name, void (*entry)(void * arg), void * arg);
 int sys_execve(char *name, char **argv, char **env);
 void sys_exit(int status);
 int sys_wait(int* status);
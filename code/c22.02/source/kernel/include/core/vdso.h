@@ -0,0 +1,49 @@
+/**
+ * 映射到每个进程中的只读数据页
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef VDSO_H
+#define VDSO_H
+
+#include "comm/types.h"
+
+#define VDSO_BASE               0xDF000000                  // 位于映射区之后，用户栈之下
+#define VDSO_DATA_ADDR          VDSO_BASE                   // 所有进程共享的数据
+#define VDSO_TASK_ADDR          (VDSO_BASE + 0x1000)        // 进程自己的数据
+
+#define VDSO_TSC_SHIFT          20          // tsc差值换算为纳秒: (delta * tsc_ns_mult) >> VDSO_TSC_SHIFT
+#define VDSO_CALIB_START        10          // 从第几个tick开始校准tsc
+#define VDSO_CALIB_TICKS        10          // 校准持续的tick数
+
+/**
+ * 所有进程共享的数据，只由内核更新。
+ * 更新期间seq为奇数，读取时需前后两次seq相同且为偶数，否则重读
+ */
+typedef struct _vdso_data_t {
+    volatile uint32_t seq;              // 更新计数
+    volatile uint32_t tick;             // 启动后的tick数
+    volatile uint32_t tick_tsc_lo;      // 最近一次tick时的tsc
+    volatile uint32_t tick_tsc_hi;
+    volatile uint32_t tsc_ns_mult;      // tsc到纳秒的换算系数，0表示还未校准
+    volatile uint32_t tsc_per_ms;       // 每毫秒的tsc计数
+    uint32_t tick_ms;                   // 每个tick的毫秒数
+    uint32_t cpu_features;              // cpuid 1号功能的edx
+    char cpu_vendor[16];                // cpu厂商名称
+}vdso_data_t;
+
+/**
+ * 进程自己的数据，同一地址空间中的线程共用
+ */
+typedef struct _vdso_task_t {
+    int pid;                            // 加载程序的进程号
+}vdso_task_t;
+
+void vdso_init (void);
+void vdso_tick (uint32_t tick);
+int vdso_map (uint32_t page_dir, int pid);
+void vdso_set_pid (uint32_t page_dir, int pid);
+
+#endif // VDSO_H
@@ -36,6 +36,11 @@
 #define SEG_RPL0                (0 << 0)
 #define SEG_RPL3                (3 << 0)
 
+#define MSR_SYSENTER_CS     0x174           // sysenter进入的代码段
+#define MSR_SYSENTER_ESP    0x175           // sysenter进入时的栈
+#define MSR_SYSENTER_EIP    0x176           // sysenter进入的入口
+#define CPUID_EDX_SEP       (1 << 11)       // 支持sysenter/sysexit
+
 #define EFLAGS_IF           (1 << 9)
 #define EFLAGS_DEFAULT      (1 << 1)
 
@@ -83,6 +88,7 @@ int gdt_alloc_desc (void);
 void gdt_free_sel (int sel);
 
 void switch_to_tss (uint32_t tss_selector);
+void cpu_set_sysenter_stack (uint32_t esp);
 
 #endif
 
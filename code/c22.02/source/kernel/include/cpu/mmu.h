@@ -17,7 +17,13 @@
 #define PTE_W           (1 << 1)
 #define PDE_P       (1 << 0)
 #define PTE_U           (1 << 2)
+#define PTE_PWT         (1 << 3)        // 与PCD、PAT位一起选择PAT中的内存类型
 #define PDE_U           (1 << 2)
+#define PTE_SHARED      (1 << 9)        // 系统保留位：共享的物理页，fork时不复制
+
+#define MSR_IA32_PAT        0x277
+#define PAT_WC              0x01        // 写合并
+#define PAT_DEFAULT         0x0007040600070406ULL   // 上电时的PAT，项0~3依次为WB、WT、UC-、UC
 
 #pragma pack(1)
 /**
@@ -5,7 +5,7 @@
  * 作者：李述铜
  * 联系邮箱: 527676163@qq.com
  * 
- * 只支持VGA模式
+ * 支持VGA文本模式，以及loader切换到VBE图形模式后在帧缓存上显示
  */
 #ifndef CONSOLE_H
 #define CONSOLE_H
@@ -13,13 +13,16 @@
 #include "comm/types.h"
 #include "dev/tty.h"
 #include "ipc/mutex.h"
+#include "os_cfg.h"
 
 // https://wiki.osdev.org/Printing_To_Screen
 #define CONSOLE_VIDEO_BASE			0xb8000		// 控制台显存起始地址,共32KB
 #define CONSOLE_DISP_ADDR           0xb8000
 #define CONSOLE_DISP_END			(0xb8000 + 32*1024)	// 显存的结束地址
-#define CONSOLE_ROW_MAX				25			// 行数
-#define CONSOLE_COL_MAX				80			// 最大列数
+#define CONSOLE_TEXT_ROWS			25			// 文本模式的行数
+#define CONSOLE_TEXT_COLS			80			// 文本模式的列数
+#define CONSOLE_ROW_MAX				64			// 图形模式下的最大行数
+#define CONSOLE_COL_MAX				160			// 图形模式下的最大列数
 
 #define ASCII_ESC                   0x1b        // ESC ascii码            
 
@@ -58,11 +61,30 @@ typedef union {
 	uint16_t v;
 }disp_char_t;
 
+/**
+ * 回看记录，保存滚出屏幕的行
+ * 每行压缩为一条记录：字符数、属性段数、各属性段(长度, 属性)，及去掉行尾空白后的字符
+ * 记录依次存放在环形缓存中，新记录覆盖最早的记录
+ */
+typedef struct _console_hist_t {
+	uint8_t * buf;				// 记录缓存，首次有行滚出时分配
+	uint32_t * line_pos;		// 各行记录的起始位置，按累计写入量计
+	uint32_t write_pos;			// 累计写入的字节数
+	int first;					// 最早一行在line_pos中的序号
+	int count;					// 已记录的行数
+}console_hist_t;
+
 /**
  * 终端显示部件
  */
 typedef struct _console_t {
-	disp_char_t * disp_base;	// 显示基地址
+	disp_char_t * disp_base;	// 文本模式下的显示基地址，图形模式下为0
+
+	// 显示内容先写入内存中的影子缓存，输出完一批后只将改动的行写入显存
+	// 影子缓存按行组成环形，滚屏时只移动起始行
+	disp_char_t * shadow;		// 影子缓存
+	int origin;					// 屏幕首行在影子缓存中的行号
+	uint32_t dirty[CONSOLE_ROW_MAX / 32];	// 需要写入显存的行，每位对应屏幕上的一行
 
     enum {
         CONSOLE_WRITE_NORMAL,			// 普通模式
@@ -79,6 +101,13 @@ typedef struct _console_t {
     int curr_param_index;
 
     mutex_t mutex;                  // 写互斥锁
+
+	// 回看时显存显示回看位置的内容，输出只写入影子缓存
+	// 键盘中断中改变回看位置时，若正在输出，则由输出结束时重新显示
+	console_hist_t hist;			// 回看记录
+	int view;						// 回看的行数，0表示显示最新内容
+	int writing;					// 正在输出
+	int view_changed;				// 输出期间回看位置有变化
 }console_t;
 
 int console_init (int idx);
@@ -86,4 +115,6 @@ int console_write (tty_t * tty);
 void console_close (int dev);
 void console_select(int idx);
 void console_set_cursor(int idx, int visiable);
+void console_scroll_view (int idx, int dir);
+int console_fb_init (void);
 #endif /* SRC_UI_TTY_WIDGET_H_ */
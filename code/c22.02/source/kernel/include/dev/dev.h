@@ -17,9 +17,12 @@ enum {
     DEV_UNKNOWN = 0,            // 未知类型
     DEV_TTY,                // TTY设备
     DEV_DISK,               // 磁盘设备
+    DEV_KMSG,               // 内核日志
 };
 
 struct _dev_desc_t;
+struct _poll_table_t;
+struct iovec;
 
 /**
  * @brief 设备驱动接口
@@ -45,12 +48,18 @@ typedef struct _dev_desc_t {
     int (*write) (device_t * dev, int addr, char * buf, int size);
     int (*control) (device_t * dev, int cmd, int arg0, int arg1);
     void (*close) (device_t * dev);
+    int (*poll) (device_t * dev, struct _poll_table_t * table);    // 可为空，为空时总是就绪
+    int (*read_pos) (device_t * dev, int * pos, char * buf, int size);  // 可为空，各读者自行记录读位置的设备使用
+    int (*readv) (device_t * dev, int addr, const struct iovec * iov, int iovcnt);   // 可为空，从addr起连续读入多个缓存
 }dev_desc_t;
 
 int dev_open (int major, int minor, void * data);
 int dev_read (int dev_id, int addr, char * buf, int size);
+int dev_read_pos (int dev_id, int * pos, char * buf, int size);
+int dev_readv (int dev_id, int addr, const struct iovec * iov, int iovcnt);
 int dev_write (int dev_id, int addr, char * buf, int size);
 int dev_control (int dev_id, int cmd, int arg0, int arg1);
 void dev_close (int dev_id);
+int dev_poll (int dev_id, struct _poll_table_t * table);
 
 #endif // DEV_H
@@ -89,6 +89,8 @@ typedef struct _partinfo_t {
         FS_INVALID = 0x00,      // 无效文件系统类型
         FS_FAT16_0 = 0x06,      // FAT16文件系统类型
         FS_FAT16_1 = 0x0E,
+        FS_FAT32_0 = 0x0B,      // FAT32文件系统类型
+        FS_FAT32_1 = 0x0C,
     }type;
 
 	int start_sector;           // 起始扇区
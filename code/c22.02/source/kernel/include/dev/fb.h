@@ -0,0 +1,47 @@
+/**
+ * 图形模式下的帧缓存显示
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef FB_H
+#define FB_H
+
+#include "comm/types.h"
+#include "comm/boot_info.h"
+#include "dev/console.h"
+
+#define FB_FONT_WIDTH           8                   // 字符宽度，像素
+#define FB_FONT_HEIGHT          BOOT_FONT_HEIGHT    // 字符高度，像素
+#define FB_CURSOR_HEIGHT        2                   // 光标为字符底部的横线
+#define FB_FONT_FIRST           0x20                // 内核自带字体的第一个字符
+#define FB_FONT_LAST            0x7E                // 内核自带字体的最后一个字符
+
+/**
+ * @brief 帧缓存，按字符网格显示控制台的内容
+ */
+typedef struct _fb_t {
+    uint32_t * base;            // 帧缓存在内核空间中的地址，为0表示文本模式
+    int width, height;          // 分辨率
+    int pitch;                  // 每行的像素数
+    int cols, rows;             // 字符网格的列数和行数
+    uint8_t * font;             // 256个字符的8x16字体，每字符16字节，每字节为一行
+    disp_char_t * screen;       // 屏幕上已画出的字符，只重画有变化的字符
+    int cursor_row, cursor_col; // 已画出的光标位置，cursor_row为-1表示未画出
+    int cursor_visible;         // 是否显示光标
+}fb_t;
+
+extern const uint8_t fb_font_ascii[];
+
+int fb_init (boot_info_t * boot_info);
+int fb_enable (void);
+int fb_present (void);
+int fb_enabled (void);
+void fb_get_size (int * cols, int * rows);
+void fb_draw_line (int row, const disp_char_t * line, int count);
+void fb_set_cursor (int row, int col);
+void fb_show_cursor (int visible);
+void fb_invalidate (void);
+
+#endif // FB_H
@@ -21,6 +21,8 @@
 // https://wiki.osdev.org/PS/2_Keyboard
 #define KBD_CMD_RW_LED			0xED   // 写按键
 
+#define KBD_RING_SIZE           256     // 中断中暂存扫描码的缓存大小，需为2的幂
+
 #define KEY_RSHIFT		0x36
 #define KEY_LSHIFT 		0x2A
 
@@ -91,7 +93,19 @@ typedef struct _kbd_state_t {
     int rctrl_press : 1;         // ctrl键按下
 }kbd_state_t;
 
+/**
+ * 扫描码缓存，中断中只写入head，处理线程只修改tail，无需加锁
+ */
+typedef struct _kbd_ring_t {
+    volatile uint8_t buf[KBD_RING_SIZE];
+    volatile uint32_t head;     // 累计写入的扫描码数量
+    volatile uint32_t tail;     // 累计处理的扫描码数量
+    volatile uint32_t dropped;  // 缓存满时丢弃的数量
+    volatile int waiting;       // 处理线程已无数据可处理，等待唤醒
+}kbd_ring_t;
+
 void kbd_init(void);
+void kbd_worker_init (void);
 
 void exception_handler_kbd (void);
 
@@ -0,0 +1,45 @@
+/**
+ * 串口终端
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "dev/tty.h"
+
+// 参考资料：https://wiki.osdev.org/Serial_Ports
+#define SERIAL_COM1_PORT            0x3F8       // COM1的端口基址
+#define SERIAL_FIFO_SIZE            16          // 16550的发送FIFO大小
+
+#define SERIAL_REG_DATA             0           // 收发数据，DLAB=1时为除数低字节
+#define SERIAL_REG_IER              1           // 中断使能，DLAB=1时为除数高字节
+#define SERIAL_REG_IIR              2           // 读：中断标识
+#define SERIAL_REG_FCR              2           // 写：FIFO控制
+#define SERIAL_REG_LCR              3           // 线路控制
+#define SERIAL_REG_MCR              4           // modem控制
+#define SERIAL_REG_LSR              5           // 线路状态
+#define SERIAL_REG_MSR              6           // modem状态
+
+#define SERIAL_IER_RX               (1 << 0)    // 收到数据中断
+#define SERIAL_IER_TX               (1 << 1)    // 发送保持寄存器空中断
+#define SERIAL_IER_LINE             (1 << 2)    // 线路状态中断
+
+#define SERIAL_IIR_NONE             (1 << 0)    // 无中断待处理
+#define SERIAL_IIR_ID(iir)          (((iir) >> 1) & 0x7)
+#define SERIAL_IIR_MODEM            0
+#define SERIAL_IIR_TX               1
+#define SERIAL_IIR_RX               2
+#define SERIAL_IIR_LINE             3
+#define SERIAL_IIR_RX_TIMEOUT       6
+
+#define SERIAL_LSR_RX_READY         (1 << 0)    // 有收到的数据
+#define SERIAL_LSR_TX_EMPTY         (1 << 5)    // 发送FIFO空
+
+int serial_init (tty_t * tty);
+int serial_write (tty_t * tty);
+void exception_handler_com1 (void);
+
+#endif // SERIAL_H
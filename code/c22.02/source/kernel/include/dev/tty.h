@@ -8,13 +8,18 @@
 #ifndef TTY_H
 #define TTY_H
 
+#include "comm/types.h"
 #include "ipc/sem.h"
 
-#define TTY_NR						8		// 最大支持的tty设备数量
+#define TTY_NR						8		// 控制台tty的数量，次设备号从0开始
+#define TTY_SERIAL_NR				1		// 串口tty的数量，次设备号从TTY_NR开始
 #define TTY_IBUF_SIZE				512		// tty输入缓存大小
 #define TTY_OBUF_SIZE				512		// tty输出缓存大小
+#define TTY_WRITE_CHUNK				128		// 写入时每批放入输出缓存的最大量
 #define TTY_CMD_ECHO				0x1		// 开回显
 #define TTY_CMD_IN_COUNT			0x2		// 获取输入缓冲区中已有的数据量
+#define TTY_CMD_GETATTR				0x3		// 读取termios设置
+#define TTY_CMD_SETATTR				0x4		// 修改termios设置
 
 typedef struct _tty_fifo_t {
 	char * buf;
@@ -25,12 +30,40 @@ typedef struct _tty_fifo_t {
 
 int tty_fifo_get (tty_fifo_t * fifo, char * c);
 int tty_fifo_put (tty_fifo_t * fifo, char c);
+int tty_fifo_get_buf (tty_fifo_t * fifo, char * buf, int size);
+int tty_fifo_put_buf (tty_fifo_t * fifo, const char * buf, int size);
 
 #define TTY_INLCR			(1 << 0)		// 将\n转成\r\n
 #define TTY_IECHO			(1 << 2)		// 是否回显
+#define TTY_ICANON			(1 << 3)		// 规范模式，按行读取并处理删除键
 
 #define TTY_OCRLF			(1 << 0)		// 输出是否将\n转换成\r\n
 
+// termios的简化版本，newlib未提供sys/termios.h
+#define NCCS				8
+#define VMIN				0		// 非规范模式下，读取至少返回的字节数
+#define VTIME				1		// 非规范模式下的等待时间，单位为0.1秒
+
+#define INLCR				(1 << 0)		// c_iflag：将\n转成\r\n
+#define ONLCR				(1 << 0)		// c_oflag：输出时将\n转成\r\n
+#define ECHO				(1 << 0)		// c_lflag：回显
+#define ICANON				(1 << 1)		// c_lflag：规范模式
+
+#define TCSANOW				0
+#define TCSADRAIN			1
+#define TCSAFLUSH			2
+
+typedef uint32_t tcflag_t;
+typedef uint8_t cc_t;
+
+struct termios {
+	tcflag_t c_iflag;
+	tcflag_t c_oflag;
+	tcflag_t c_cflag;
+	tcflag_t c_lflag;
+	cc_t c_cc[NCCS];
+};
+
 /**
  * tty设备
  */
@@ -44,10 +77,16 @@ typedef struct _tty_t {
 
 	int iflags;						// 输入标志
     int oflags;						// 输出标志
-	int console_idx;				// 控制台索引号
+	int vmin, vtime;				// 非规范模式下的VMIN和VTIME
+	list_t poll_list;				// poll等待输入的队列
+	int in_dropped;					// 输入队列满时丢弃的字符数
+	int console_idx;				// 控制台索引号，串口为-1
+	int (*start_out) (struct _tty_t * tty);	// 启动输出队列中数据的输出
 }tty_t;
 
 void tty_select (int tty);
 void tty_in (char ch);
+void tty_put_in (tty_t * tty, char ch);
+void tty_scroll_view (int dir);
 
 #endif /* TTY_H */
@@ -0,0 +1,43 @@
+/**
+ * 目录项缓存
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include "comm/types.h"
+#include "tools/list.h"
+#include "fs/file.h"
+
+#define DCACHE_NR               128         // 缓存的目录项数量
+#define DCACHE_HASH_SIZE        64          // 哈希桶数量
+#define DCACHE_NAME_SIZE        32          // 可缓存的名称长度，更长的名称不缓存
+
+struct _fs_t;
+
+/**
+ * 目录项，记录父目录中某一名称的查找结果
+ */
+typedef struct _dentry_t {
+    struct _fs_t * fs;                  // 所在的文件系统
+    int parent;                         // 父目录标识，由文件系统定义
+    char name[DCACHE_NAME_SIZE];        // 名称
+
+    int negative;                       // 为1表示该名称不存在
+    int ino;                            // 自身的标识，目录为其起始块
+    int index;                          // 在父目录中的索引
+    file_type_t type;                   // 文件类型
+
+    list_node_t hash_node;              // 哈希桶中的结点
+    list_node_t lru_node;               // 替换队列中的结点
+}dentry_t;
+
+void dcache_init (void);
+int dcache_lookup (struct _fs_t * fs, int parent, const char * name, dentry_t * dentry);
+void dcache_add (struct _fs_t * fs, int parent, const char * name, dentry_t * dentry);
+void dcache_invalidate_dir (struct _fs_t * fs, int parent);
+
+#endif // DCACHE_H
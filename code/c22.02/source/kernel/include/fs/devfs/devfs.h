@@ -17,6 +17,7 @@ typedef struct _devfs_type_t {
     const char * name;
     int dev_type;
     int file_type;
+    int minor_base;         // 路径中的序号加上此值为次设备号
 }devfs_type_t;
 
 #endif
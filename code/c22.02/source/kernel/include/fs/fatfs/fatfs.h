@@ -9,11 +9,19 @@
 #define FAT_H
 
 #include "ipc/mutex.h"
+#include "tools/bitmap.h"
 
 #pragma pack(1)    // 千万记得加这个
 
-#define FAT_CLUSTER_INVALID 		0xFFF8      	// 无效的簇号
+#define FAT_CLUSTER_INVALID 		0x0FFFFFF8      // 无效的簇号，也用作簇链的结束标记
 #define FAT_CLUSTER_FREE          	0x00     	    // 空闲或无效的簇号
+#define FAT_ROOT_CLUSTER            0x00            // 根目录的起始簇标记，FAT16的根目录不在数据区中
+#define FAT16_CLUSTER_MAX           65525           // 簇数量少于该值的为FAT16，否则为FAT32
+#define FAT12_CLUSTER_MAX           4085            // 簇数量少于该值的为FAT12，不支持
+#define FAT_RUN_MAX_SECTORS         256             // 单次直接读写的最大扇区数
+#define FAT_EXTENT_NR               15              // 每个文件最多缓存的连续簇段数
+#define FAT_DINDEX_NR               4               // 同时建有名称索引的目录数量
+#define FAT_DINDEX_HASH_SIZE        64              // 每个目录名称索引的哈希桶数量
 
 #define DIRITEM_NAME_FREE               0xE5                // 目录项空闲名标记
 #define DIRITEM_NAME_END                0x00                // 目录项结束名标记
@@ -25,8 +33,14 @@
 #define DIRITEM_ATTR_DIRECTORY          0x10                // 目录项属性：目录
 #define DIRITEM_ATTR_ARCHIVE            0x20                // 目录项属性：归档
 #define DIRITEM_ATTR_LONG_NAME          0x0F                // 目录项属性：长文件名
+#define DIRITEM_ATTR_LONG_NAME_MASK     0x3F                // 判断长文件名属性时用的掩码
 
 #define SFN_LEN                    	 	11              // sfn文件名长
+#define LFN_CHARS_PER_ITEM              13              // 每个长文件名项存放的字符数
+#define LFN_ITEM_MAX                    20              // 长文件名最多占用的项数
+#define LFN_ORD_LAST                    0x40            // 长文件名的最后一项标记
+#define LFN_ORD_MASK                    0x1F            // 长文件名项的序号
+#define FAT_NAME_SIZE                   (LFN_ITEM_MAX * LFN_CHARS_PER_ITEM + 1)   // 文件名缓存大小
 
 /**
  * FAT目录项
@@ -46,6 +60,20 @@ typedef struct _diritem_t {
     uint32_t DIR_FileSize;                 // 文件字节大小
 } diritem_t;
 
+/**
+ * 长文件名目录项，位于对应的短文件名项之前，按序号从大到小存放
+ */
+typedef struct _lfnitem_t {
+    uint8_t LDIR_Ord;                       // 序号，最后一项带有LFN_ORD_LAST标记
+    uint16_t LDIR_Name1[5];                 // 名称第1-5个字符
+    uint8_t LDIR_Attr;                      // 属性，固定为DIRITEM_ATTR_LONG_NAME
+    uint8_t LDIR_Type;                      // 固定为0
+    uint8_t LDIR_Chksum;                    // 对应短文件名的校验和
+    uint16_t LDIR_Name2[6];                 // 名称第6-11个字符
+    uint16_t LDIR_FstClusLO;                // 固定为0
+    uint16_t LDIR_Name3[2];                 // 名称第12-13个字符
+} lfnitem_t;
+
 /**
  * 完整的DBR类型
  */
@@ -65,15 +93,92 @@ typedef struct _dbr_t {
     uint32_t BPB_HiddSec;                  // 隐藏扇区数
     uint32_t BPB_TotSec32;                 // 总的扇区数
 
-	uint8_t BS_DrvNum;                     // 磁盘驱动器参数
-	uint8_t BS_Reserved1;				   // 保留字节
-	uint8_t BS_BootSig;                    // 扩展引导标记
-	uint32_t BS_VolID;                     // 卷标序号
-	uint8_t BS_VolLab[11];                 // 磁盘卷标
-	uint8_t BS_FileSysType[8];             // 文件类型名称
+    union {
+        // FAT16的扩展部分
+        struct {
+            uint8_t BS_DrvNum;                     // 磁盘驱动器参数
+            uint8_t BS_Reserved1;				   // 保留字节
+            uint8_t BS_BootSig;                    // 扩展引导标记
+            uint32_t BS_VolID;                     // 卷标序号
+            uint8_t BS_VolLab[11];                 // 磁盘卷标
+            uint8_t BS_FileSysType[8];             // 文件类型名称
+        } fat16;
+
+        // FAT32的扩展部分
+        struct {
+            uint32_t BPB_FATSz32;                  // FAT表项大小
+            uint16_t BPB_ExtFlags;                 // FAT表镜像标志
+            uint16_t BPB_FSVer;                    // 版本号
+            uint32_t BPB_RootClus;                 // 根目录起始簇号
+            uint16_t BPB_FSInfo;                   // FSInfo所在扇区
+            uint16_t BPB_BkBootSec;                // 备份引导扇区
+            uint8_t BPB_Reserved[12];              // 保留
+            uint8_t BS_DrvNum;                     // 磁盘驱动器参数
+            uint8_t BS_Reserved1;				   // 保留字节
+            uint8_t BS_BootSig;                    // 扩展引导标记
+            uint32_t BS_VolID;                     // 卷标序号
+            uint8_t BS_VolLab[11];                 // 磁盘卷标
+            uint8_t BS_FileSysType[8];             // 文件类型名称
+        } fat32;
+    };
 } dbr_t;
 #pragma pack()
 
+typedef uint32_t cluster_t;
+
+/**
+ * 目录的遍历位置，用于在以簇链存放的目录中定位目录项
+ */
+typedef struct _fat_dir_t {
+    cluster_t start;                        // 目录起始簇，FAT_ROOT_CLUSTER为FAT16的根目录
+    cluster_t curr;                         // 当前所在的簇
+    int curr_index;                         // 当前簇在目录中的簇序号
+} fat_dir_t;
+
+/**
+ * 目录名称索引中的一项
+ */
+typedef struct _fat_dnode_t {
+    uint32_t hash;                          // 名称的哈希值
+    uint16_t index;                         // 短文件名项的索引
+    uint16_t first;                         // 首个长文件名项的索引，无长文件名时与index相同
+    int16_t next;                           // 同一哈希桶中的下一项，-1表示结束
+} fat_dnode_t;
+
+/**
+ * 目录名称索引，每个占一页，在首次查找时建立
+ */
+typedef struct _fat_dindex_t {
+    cluster_t dir;                          // 目录起始簇
+    int used;                               // 是否已使用
+    int complete;                           // 是否已包含目录中的全部文件
+    uint32_t last_used;                     // 最近的使用序号，用于替换
+    int node_count;                         // 已使用过的结点数
+    int16_t free_node;                      // 空闲结点链表，-1表示为空
+    int16_t bucket[FAT_DINDEX_HASH_SIZE];   // 哈希桶
+    fat_dnode_t node[];                     // 结点，占用页内剩余的空间
+} fat_dindex_t;
+
+/**
+ * 文件中一段物理上连续的簇
+ */
+typedef struct _fat_extent_t {
+    uint32_t index;                         // 段中首簇在文件中的簇序号
+    uint32_t count;                         // 连续的簇数量
+    cluster_t start;                        // 起始簇号
+} fat_extent_t;
+
+/**
+ * 打开文件的簇链缓存，记录从文件开头起已访问过的各连续簇段
+ * 段数满后隔段丢弃，未缓存的簇从之前最近的段沿簇链查找
+ */
+typedef struct _fat_emap_t {
+    int used;                               // 是否已分配
+    int count;                              // 已缓存的段数
+    uint32_t covered;                       // 已沿簇链查找过的簇数，从文件开头连续
+    fat_extent_t extent[FAT_EXTENT_NR];     // 各段，按在文件中的位置排列
+} fat_emap_t;
+
 /**
  * fat结构
  */
@@ -86,17 +191,27 @@ typedef struct _fat_t {
     uint32_t sec_per_cluster;               // 每簇的扇区数
     uint32_t root_ent_cnt;                  // 根目录的项数
     uint32_t root_start;                    // 根目录起始扇区号
+    cluster_t root_cluster;                 // FAT32根目录的起始簇号
+    uint32_t entry_size;                    // FAT表项字节数，FAT16为2，FAT32为4
     uint32_t data_start;                    // 数据区起始扇区号
     uint32_t cluster_byte_size;             // 每簇字节数
+    uint32_t cluster_total;                 // 簇总数，含最开始的两个保留簇
+
+    // 空闲簇管理
+    bitmap_t free_map;                      // 空闲簇位图，1表示已占用
+    int free_count;                         // 空闲簇数量
+    int next_free;                          // 下次开始查找空闲簇的位置
 
     // 与文件系统读写相关信息
     uint8_t * fat_buffer;             		// FAT表项缓冲
     int curr_sector;                        // 当前缓存的扇区数
+    int dirty;                              // 缓存的扇区是否已修改，需要写回
+    fat_emap_t * emap_tbl;                  // 打开文件的簇链缓存表，占一页
+    fat_dindex_t * dindex_tbl;              // 目录名称索引表，每项一页
+    uint32_t dindex_seq;                    // 目录名称索引的使用序号
 
     struct _fs_t * fs;                      // 所在的文件系统
     mutex_t mutex;                          // 互斥信号量
 } fat_t;
 
-typedef uint16_t cluster_t;
-
 #endif // FAT_H
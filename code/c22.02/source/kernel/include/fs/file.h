@@ -12,6 +12,14 @@
 
 #define FILE_TABLE_SIZE         2048        // 可打开的文件数量
 #define FILE_NAME_SIZE          32          // 文件名称大小
+#define FILE_PATH_SIZE          128         // 完整路径的最大长度
+#define FILE_IOV_MAX            16          // readv/writev一次最多的缓存数量
+
+#ifndef SEEK_SET
+#define SEEK_SET                0           // 相对文件开头定位
+#define SEEK_CUR                1           // 相对当前位置定位
+#define SEEK_END                2           // 相对文件末尾定位
+#endif
 
 /**
  * 文件类型
@@ -21,8 +29,19 @@ typedef enum _file_type_t {
     FILE_TTY = 1,
     FILE_NORMAL,
     FILE_DIR,
+    FILE_PIPE,
+    FILE_SHM,
+    FILE_DEV,                   // 非tty的字符设备
 } file_type_t;
 
+/**
+ * readv/writev使用的缓存描述
+ */
+struct iovec {
+    void * iov_base;            // 缓存起始地址
+    uint32_t iov_len;           // 缓存长度
+};
+
 struct _fs_t;
 
 /**
@@ -39,8 +58,10 @@ typedef struct _file_t {
     int pos;                   	// 当前位置
     int sblk;                   // 内部起始块位置
     int cblk;                   // 当前块
+    int pblk;                   // 父目录的起始块
     int p_index;                // 在父目录中的索引
     int mode;					// 读写模式
+    void * data;                // 文件系统的私有数据
 
     struct _fs_t * fs;          // 所在的文件系统
 } file_t;
@@ -14,6 +14,7 @@
 #include "applib/lib_syscall.h"
 #include "fs/fatfs/fatfs.h"
 #include "ipc/mutex.h"
+#include "fs/dcache.h"
 
 struct _fs_t;
 
@@ -31,18 +32,32 @@ typedef struct _fs_op_t {
     int (*stat)(file_t * file, struct stat *st);
     int (*ioctl) (file_t * file, int cmd, int arg0, int arg1);
 
+    // 一次处理多个缓存，可为空，为空时逐个调用read/write
+    int (*readv) (const struct iovec * iov, int iovcnt, file_t * file);
+    int (*writev) (const struct iovec * iov, int iovcnt, file_t * file);
+
+    // 返回文件当前的POLLxxx状态，并用poll_wait挂到状态变化时通知的队列上。可为空，为空时总是就绪
+    int (*poll) (file_t * file, poll_table_t * table);
+
     int (*opendir)(struct _fs_t * fs,const char * name, DIR * dir);
     int (*readdir)(struct _fs_t * fs, DIR* dir, struct dirent * dirent);
     int (*closedir)(struct _fs_t * fs,DIR *dir);
-    int (*unlink) (struct _fs_t * fs, const char * path);
+    int (*unlink) (struct _fs_t * fs, int dir, const char * name);
+
+    // 在目录dir中查找名称为name的项，找到时填充dentry中的ino、index和type
+    int (*lookup) (struct _fs_t * fs, int dir, const char * name, dentry_t * dentry);
 }fs_op_t;
 
 #define FS_MOUNTP_SIZE      512
+#define FS_ROOT_INO         0           // 文件系统根目录的标识
 
 // 文件系统类型
 typedef enum _fs_type_t {
     FS_FAT16,
+    FS_FAT32,
     FS_DEVFS,
+    FS_PIPEFS,
+    FS_SHMFS,
 }fs_type_t;
 
 typedef struct _fs_t {
@@ -61,28 +76,40 @@ typedef struct _fs_t {
         fat_t fat_data;         // 文件系统相关数据
     };
     mutex_t * mutex;              // 文件系统操作互斥信号量
+    int nocase;                 // 文件名不区分大小写，目录项缓存按大写比较
 }fs_t;
 
 void fs_init (void);
 int path_to_num (const char * path, int * num);
-const char * path_next_child (const char * path);
 
 int sys_open(const char *name, int flags, ...);
 int sys_read(int file, char *ptr, int len);
 int sys_write(int file, char *ptr, int len);
 int sys_lseek(int file, int ptr, int dir);
+int sys_readv(int file, const struct iovec * iov, int iovcnt);
+int sys_writev(int file, const struct iovec * iov, int iovcnt);
+int sys_pread(int file, char *ptr, int len, int offset);
+int sys_pwrite(int file, char *ptr, int len, int offset);
 int sys_close(int file);
 
 int sys_isatty(int file);
 int sys_fstat(int file, struct stat *st);
 
 int sys_dup (int file);
+int sys_dup2 (int file, int new_file);
+int sys_pipe (int * fd);
+int sys_shm_open (const char * name, int flags, uint32_t size);
 int sys_ioctl(int fd, int cmd, int arg0, int arg1);
 
 int sys_opendir(const char * name, DIR * dir);
 int sys_readdir(DIR* dir, struct dirent * dirent);
 int sys_closedir(DIR *dir);
 int sys_unlink (const char * path);
+int sys_chdir (const char * path);
+void fs_close_file (file_t * file);
+file_t * fs_shm_anon (uint32_t size);
+int fs_read_file_at (file_t * file, uint32_t offset, char * buf, int size);
+int sys_getcwd (char * buf, int size);
 
 #endif // FILE_H
 
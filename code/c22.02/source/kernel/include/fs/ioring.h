@@ -0,0 +1,60 @@
+/**
+ * 批量提交的文件操作环
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef IORING_H
+#define IORING_H
+
+#include "comm/types.h"
+
+#define IORING_ENTRIES          64          // 提交和完成队列的项数，需为2的幂
+
+#define IORING_OP_NOP           0           // 空操作
+#define IORING_OP_OPEN          1           // open(addr, len)，len为打开标志
+#define IORING_OP_READ          2           // read(fd, addr, len)
+#define IORING_OP_WRITE         3           // write(fd, addr, len)
+#define IORING_OP_CLOSE         4           // close(fd)
+#define IORING_OP_LSEEK         5           // lseek(fd, len, SEEK_SET)
+
+#define IOSQE_FD_REF            (1 << 0)    // fd为前面第fd项的结果，如刚打开的文件
+#define IOSQE_LEN_REF           (1 << 1)    // len为前面第len项的结果，如刚读取的字节数
+
+/**
+ * 提交项，由应用填写
+ */
+typedef struct _ioring_sqe_t {
+    uint8_t op;                 // 操作类型
+    uint8_t flags;              // IOSQE_xxx
+    uint16_t reserved;
+    int fd;                     // 文件，或IOSQE_FD_REF时往前的项数
+    uint32_t addr;              // 缓存或路径
+    uint32_t len;               // 长度，或IOSQE_LEN_REF时往前的项数
+    uint32_t user_data;         // 原样放入完成项
+}ioring_sqe_t;
+
+/**
+ * 完成项，由内核填写
+ */
+typedef struct _ioring_cqe_t {
+    uint32_t user_data;         // 对应提交项的user_data
+    int res;                    // 操作的返回值
+}ioring_cqe_t;
+
+/**
+ * 提交和完成队列，位于应用的内存中。
+ * 应用写入提交项后增加sq_tail，内核处理后增加sq_head；
+ * 内核写入完成项后增加cq_tail，应用取走后增加cq_head
+ */
+typedef struct _ioring_t {
+    volatile uint32_t sq_head, sq_tail;
+    volatile uint32_t cq_head, cq_tail;
+    ioring_sqe_t sqes[IORING_ENTRIES];
+    ioring_cqe_t cqes[IORING_ENTRIES];
+}ioring_t;
+
+int sys_ioring_enter (ioring_t * ring, int to_submit);
+
+#endif // IORING_H
@@ -0,0 +1,39 @@
+/**
+ * 文件页缓存
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef PCACHE_H
+#define PCACHE_H
+
+#include "comm/types.h"
+#include "tools/list.h"
+#include "fs/file.h"
+
+#define PCACHE_NR               256         // 最多缓存的页数
+#define PCACHE_HASH_SIZE        64          // 哈希桶数量
+
+struct _fs_t;
+
+/**
+ * 缓存的一页文件数据
+ */
+typedef struct _pcache_page_t {
+    struct _fs_t * fs;                  // 所在的文件系统，为0表示未使用
+    int dir;                            // 文件所在目录的起始块
+    int slot;                           // 文件在目录中的索引，与dir一起标识文件
+    uint32_t index;                     // 页在文件中的序号
+    uint32_t paddr;                     // 存放数据的物理页
+
+    list_node_t hash_node;              // 哈希桶中的结点
+    list_node_t lru_node;               // 替换队列中的结点
+}pcache_page_t;
+
+void pcache_init (void);
+uint32_t pcache_get (file_t * file, uint32_t index);
+void pcache_update (file_t * file, uint32_t pos, const char * buf, int size);
+void pcache_invalidate (struct _fs_t * fs, int dir, int slot);
+
+#endif // PCACHE_H
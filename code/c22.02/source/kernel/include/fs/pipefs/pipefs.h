@@ -0,0 +1,35 @@
+/**
+ * 管道文件系统
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef PIPEFS_H
+#define PIPEFS_H
+
+#include "fs/fs.h"
+#include "tools/list.h"
+#include "core/memory.h"
+
+#define PIPE_NR                 32              // 系统中最多的管道数量
+#define PIPE_BUF_SIZE           MEM_PAGE_SIZE   // 管道缓存大小，占用一页
+
+/**
+ * @brief 管道，数据存放在一页大小的环形缓存中
+ */
+typedef struct _pipe_t {
+    char * buf;                 // 数据缓存，为0表示管道空闲
+    uint32_t read_cnt;          // 累计读取的字节数
+    uint32_t write_cnt;         // 累计写入的字节数，与read_cnt之差为缓存中的数据量
+
+    int readers;                // 打开的读端数量
+    int writers;                // 打开的写端数量
+    list_t read_wait;           // 等待数据的进程
+    list_t write_wait;          // 等待空间的进程
+    list_t poll_list;           // poll等待两端状态变化的队列
+}pipe_t;
+
+int pipefs_create (fs_t * fs, file_t * rfile, file_t * wfile);
+
+#endif // PIPEFS_H
@@ -0,0 +1,55 @@
+/**
+ * 多个文件的事件等待
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef POLL_H
+#define POLL_H
+
+#include "comm/types.h"
+#include "tools/list.h"
+#include "ipc/sem.h"
+
+#define POLL_FD_MAX             32          // 一次最多等待的文件数
+
+#define POLLIN                  0x0001      // 有数据可读
+#define POLLPRI                 0x0002      // 有紧急数据
+#define POLLOUT                 0x0004      // 可以写入
+#define POLLERR                 0x0008      // 出错，如管道读端已全部关闭
+#define POLLHUP                 0x0010      // 对端已关闭
+#define POLLNVAL                0x0020      // 文件无效
+
+struct pollfd {
+    int fd;                     // 文件
+    short events;               // 关心的事件
+    short revents;              // 发生的事件
+};
+
+struct _poll_table_t;
+
+/**
+ * 挂在文件等待队列中的结点，每个文件一个
+ */
+typedef struct _poll_entry_t {
+    list_node_t node;
+    list_t * list;              // 所在的等待队列
+    struct _poll_table_t * table;
+}poll_entry_t;
+
+/**
+ * 一次poll调用的等待记录，放在调用者的内核栈上
+ */
+typedef struct _poll_table_t {
+    sem_t sem;                  // 任一文件有事件时通知
+    int woken;                  // 本轮已经通知过
+    int count;                  // 已使用的结点数
+    poll_entry_t entry[POLL_FD_MAX];
+}poll_table_t;
+
+void poll_wait (poll_table_t * table, list_t * list);
+void poll_wakeup (list_t * list);
+int sys_poll (struct pollfd * fds, int nfds, int timeout);
+
+#endif // POLL_H
@@ -0,0 +1,32 @@
+/**
+ * 共享内存文件系统
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef SHMFS_H
+#define SHMFS_H
+
+#include "fs/fs.h"
+#include "core/memory.h"
+
+#define SHM_NR                  16              // 系统中最多的共享内存段数量
+#define SHM_NAME_SIZE           32              // 共享内存段名称长度
+#define SHM_MAX_PAGES           (MEM_PAGE_SIZE / sizeof(uint32_t))  // 每段最多的页数
+
+/**
+ * @brief 共享内存段，页在首次访问时分配
+ */
+typedef struct _shm_t {
+    char name[SHM_NAME_SIZE];   // 名称，为空表示空闲
+    int anon;                   // 无名段，供共享的匿名映射使用，不能按名称打开
+    uint32_t size;              // 大小
+    int ref;                    // 打开的文件数量，映射区域也持有文件
+    uint32_t * page_tbl;        // 各页的物理地址，未分配的为0
+}shm_t;
+
+int shmfs_create (fs_t * fs, const char * name, int flags, uint32_t size, file_t * file);
+uint32_t shmfs_get_page (file_t * file, uint32_t index);
+
+#endif // SHMFS_H
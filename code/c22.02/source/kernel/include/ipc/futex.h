@@ -0,0 +1,33 @@
+/**
+ * 用户空间快速互斥
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include "comm/types.h"
+#include "tools/list.h"
+
+#define FUTEX_WAIT              0       // *addr等于val时等待
+#define FUTEX_WAKE              1       // 唤醒最多val个等待者
+
+#define FUTEX_HASH_SIZE         64      // 等待队列哈希表大小
+
+struct _task_t;
+
+/**
+ * 等待者，存放在等待进程的内核栈上
+ */
+typedef struct _futex_waiter_t {
+    uint32_t key;               // 等待地址对应的物理地址
+    struct _task_t * task;      // 等待的进程
+    list_node_t node;           // 哈希表中的结点
+}futex_waiter_t;
+
+void futex_init (void);
+int sys_futex (uint32_t * addr, int op, int val);
+
+#endif // FUTEX_H
@@ -18,9 +18,30 @@ typedef struct _sem_t {
     list_t wait_list;		// 等待的进程列表
 }sem_t;
 
+#define KSEM_NR             32      // 提供给应用程序的信号量数量
+#define KSEM_NAME_SIZE      32      // 信号量名称长度
+
+/**
+ * 应用程序使用的有名信号量，各进程用同一名称打开得到同一信号量
+ */
+typedef struct _ksem_t {
+    char name[KSEM_NAME_SIZE];  // 名称
+    int ref;                    // 各进程打开的总次数，为0表示空闲
+    sem_t sem;
+}ksem_t;
+
 void sem_init (sem_t * sem, int init_count);
 void sem_wait (sem_t * sem);
 void sem_notify (sem_t * sem);
+int sem_wait_timeout (sem_t * sem, int ms);
+int sem_wait_n (sem_t * sem, int max);
+void sem_notify_n (sem_t * sem, int n);
 int sem_count (sem_t * sem);
 
+int sys_ksem_open (const char * name, int init_count);
+int sys_ksem_wait (int id);
+int sys_ksem_post (int id);
+int sys_ksem_close (int id);
+void ksem_ref_add (int id, int n);
+
 #endif //OS_SEM_H
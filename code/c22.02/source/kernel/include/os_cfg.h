@@ -12,7 +12,9 @@
 #define KERNEL_SELECTOR_CS		(1 * 8)		// 内核代码段描述符
 #define KERNEL_SELECTOR_DS		(2 * 8)		// 内核数据段描述符
 #define KERNEL_STACK_SIZE       (8*1024)    // 内核栈
-#define SELECTOR_SYSCALL     	(3 * 8)	// 调用门的选择子
+#define APP_SELECTOR_CS		    (3 * 8)		// 应用代码段，sysexit要求紧跟在内核段之后
+#define APP_SELECTOR_DS		    (4 * 8)		// 应用数据段
+#define SELECTOR_SYSCALL     	(5 * 8)	// 调用门的选择子
 
 #define OS_TICK_MS              10       	// 每毫秒的时钟数
 
@@ -22,6 +24,12 @@
 
 #define TASK_NR             128            // 进程的数量
 
+#define CONSOLE_HISTORY_SIZE    (64*1024)   // 每个控制台回看记录的字节数，需为页大小的整数倍
+#define CONSOLE_HISTORY_LINES   4096        // 每个控制台最多记录的回看行数
+
+#define LOG_BUF_SIZE        (16*1024)   // 内核日志环形缓存大小，需为2的幂
+#define LOG_MSG_SIZE        256         // 单条日志的最大长度，含时间戳等前缀
+
 #define ROOT_DEV            DEV_DISK, 0xb1  // 根目录所在的设备
 
 #endif //OS_OS_CFG_H
@@ -28,7 +28,8 @@ int kernel_strlen(const char * str);
 void kernel_memcpy (void * dest, void * src, int size);
 void kernel_memset(void * dest, uint8_t v, int size);
 int kernel_memcmp (void * d1, void * d2, int size);
-void kernel_itoa(char * buf, int num, int base);
+int kernel_snprintf(char * buffer, int size, const char * fmt, ...);
+int kernel_vsnprintf(char * buffer, int size, const char * fmt, va_list args);
 void kernel_sprintf(char * buffer, const char * fmt, ...);
 void kernel_vsprintf(char * buffer, const char * fmt, va_list args);
 
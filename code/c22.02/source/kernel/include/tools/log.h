@@ -8,7 +8,20 @@
 #ifndef LOG_H
 #define LOG_H
 
+// 日志级别，数值越小越重要
+#define LOG_ERR             3
+#define LOG_WARN            4
+#define LOG_INFO            6
+#define LOG_DEBUG           7
+
+#define LOG_CONSOLE_LEVEL   LOG_INFO    // 不高于此级别的日志才输出到控制台
+
 void log_init (void);
+void log_worker_init (void);
 void log_printf(const char * fmt, ...);
+void log_printk(int level, const char * fmt, ...);
+int log_read (int * pos, char * buf, int size);
+void log_tick (void);
+void log_flush (void);
 
-#endif // LOG_H
\ No newline at end of file
+#endif // LOG_H
@@ -53,6 +53,17 @@ int first_task_main (void) {
         }
     }
 
+    // 串口上也运行一个shell，无显示器时使用
+    int pid = fork();
+    if (pid == 0) {
+        char * argv[] = {"/dev/ttyS0", (char *)0};
+        execve("shell.elf", argv, (char **)0);
+        print_msg("create shell on ttyS0 failed", 0);
+        while (1) {
+            msleep(10000);
+        }
+    }
+
     while (1) {
         // 不断收集孤儿进程
         int status;
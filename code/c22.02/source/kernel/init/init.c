@@ -18,8 +18,12 @@
 #include "ipc/sem.h"
 #include "core/memory.h"
 #include "dev/console.h"
+#include "dev/fb.h"
 #include "dev/kbd.h"
 #include "fs/fs.h"
+#include "core/mmap.h"
+#include "ipc/futex.h"
+#include "core/vdso.h"
 
 static boot_info_t * init_boot_info;        // 启动信息
 
@@ -32,12 +36,17 @@ void kernel_init (boot_info_t * boot_info) {
     // 初始化CPU，再重新加载
     cpu_init();
     irq_init();
+    fb_init(boot_info);     // 先记下loader是否已切到图形模式，控制台0打开时要用到
     log_init();
 
     // 内存初始化要放前面一点，因为后面的代码可能需要内存分配
     memory_init(boot_info);
+    console_fb_init();      // 帧缓存已映射，控制台改为在帧缓存上显示
+    mmap_init();
+    futex_init();
     fs_init();
 
+    vdso_init();
     time_init();
 
     task_manager_init();
@@ -79,5 +88,8 @@ void init_main(void) {
 
     // 初始化任务
     task_first_init();
+    memory_worker_init();
+    log_worker_init();
+    kbd_worker_init();
     move_to_first_task();
 }
@@ -0,0 +1,135 @@
+/**
+ * 用户空间快速互斥
+ *
+ * 应用程序在共享的整数上用原子操作实现锁和信号量，只有需要等待或唤醒时才调用futex。
+ * 等待者以物理地址为键，放在哈希表中，因此同一页映射到不同进程中时，仍能互相唤醒。
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include "ipc/futex.h"
+#include "core/task.h"
+#include "core/memory.h"
+#include "cpu/irq.h"
+#include "cpu/mmu.h"
+#include "core/mmap.h"
+#include "tools/log.h"
+
+static list_t futex_hash[FUTEX_HASH_SIZE];      // 等待队列哈希表
+
+/**
+ * @brief 初始化等待队列
+ */
+void futex_init (void) {
+    for (int i = 0; i < FUTEX_HASH_SIZE; i++) {
+        list_init(futex_hash + i);
+    }
+}
+
+/**
+ * @brief 取用户地址对应的物理地址作为键，地址未映射时返回0
+ */
+static uint32_t futex_key (uint32_t addr) {
+    pte_t * pte = find_pte((pde_t *)task_current()->tss.cr3, addr, 0);
+    if (!pte || !pte->present) {
+        return 0;
+    }
+
+    return pte_paddr(pte) | (addr & (MEM_PAGE_SIZE - 1));
+}
+
+/**
+ * @brief 确保地址所在的页已经映射。可能要读磁盘，需在开中断时调用
+ */
+static int futex_map (uint32_t addr) {
+    if (futex_key(addr)) {
+        return 0;
+    }
+
+    return mmap_fault(addr, 0);
+}
+
+static inline list_t * futex_bucket (uint32_t key) {
+    return futex_hash + ((key >> 2) % FUTEX_HASH_SIZE);
+}
+
+/**
+ * @brief *addr仍等于val时，进入等待，直到被唤醒
+ */
+static int futex_wait (uint32_t * addr, int val) {
+    if (futex_map((uint32_t)addr) < 0) {
+        return -1;
+    }
+
+    int err = 0;
+    irq_state_t state = irq_enter_protection();
+
+    // 关中断后再检查，唤醒方只能在此之后修改值和唤醒
+    uint32_t key = futex_key((uint32_t)addr);
+    if ((key == 0) || (*(volatile int *)addr != val)) {
+        err = -1;
+    } else {
+        futex_waiter_t waiter;
+        waiter.key = key;
+        waiter.task = task_current();
+        list_node_init(&waiter.node);
+        list_insert_last(futex_bucket(key), &waiter.node);
+
+        task_set_block(waiter.task);
+        task_dispatch();
+    }
+
+    irq_leave_protection(state);
+    return err;
+}
+
+/**
+ * @brief 唤醒最多count个在addr上等待的进程，返回唤醒的数量
+ */
+static int futex_wake (uint32_t * addr, int count) {
+    int woken = 0;
+
+    if (futex_map((uint32_t)addr) < 0) {
+        return -1;
+    }
+
+    irq_state_t state = irq_enter_protection();
+    uint32_t key = futex_key((uint32_t)addr);
+    if (key) {
+        list_t * bucket = futex_bucket(key);
+        list_node_t * node = list_first(bucket);
+        while (node && (woken < count)) {
+            futex_waiter_t * waiter = list_node_parent(node, futex_waiter_t, node);
+            node = list_node_next(node);
+
+            if (waiter->key == key) {
+                list_remove(bucket, &waiter->node);
+                task_set_ready(waiter->task);
+                woken++;
+            }
+        }
+    }
+    irq_leave_protection(state);
+
+    return woken;
+}
+
+/**
+ * @brief futex系统调用，addr需4字节对齐
+ */
+int sys_futex (uint32_t * addr, int op, int val) {
+    if (((uint32_t)addr & 0x3) || ((uint32_t)addr < MEMORY_TASK_BASE)) {
+        log_printf("futex: bad addr 0x%x", (uint32_t)addr);
+        return -1;
+    }
+
+    switch (op) {
+    case FUTEX_WAIT:
+        return futex_wait(addr, val);
+    case FUTEX_WAKE:
+        return futex_wake(addr, val);
+    default:
+        return -1;
+    }
+}
@@ -8,6 +8,10 @@
 #include "cpu/irq.h"
 #include "core/task.h"
 #include "ipc/sem.h"
+#include "tools/klib.h"
+#include "os_cfg.h"
+
+static ksem_t ksem_tbl[KSEM_NR];      // 应用程序使用的信号量
 
 /**
  * 信号量初始化
@@ -17,6 +21,18 @@ void sem_init (sem_t * sem, int init_count) {
     list_init(&sem->wait_list);
 }
 
+/**
+ * @brief 唤醒等待信号量的进程，需在中断保护中调用
+ * 限时等待的进程同时在延时队列中，需一并移除，剩余的sleep_ticks不为0，告知等待者已得到信号量
+ */
+static void sem_wakeup_task (task_t * task) {
+    if (task->wait_list) {
+        task->wait_list = (list_t *)0;
+        task_set_wakeup(task);
+    }
+    task_set_ready(task);
+}
+
 /**
  * 申请信号量
  */
@@ -36,6 +52,37 @@ void sem_wait (sem_t * sem) {
     irq_leave_protection(irq_state);
 }
 
+/**
+ * @brief 申请信号量，最多等待ms毫秒，ms为0时不等待。得到返回0，超时返回-1
+ */
+int sem_wait_timeout (sem_t * sem, int ms) {
+    int err = 0;
+    irq_state_t  irq_state = irq_enter_protection();
+
+    if (sem->count > 0) {
+        sem->count--;
+    } else if (ms <= 0) {
+        err = -1;
+    } else {
+        // 同时加入等待队列和延时队列，先到者唤醒
+        task_t * curr = task_current();
+        task_set_block(curr);
+        list_insert_last(&sem->wait_list, &curr->wait_node);
+        curr->wait_list = &sem->wait_list;
+        task_set_sleep(curr, (ms + (OS_TICK_MS - 1)) / OS_TICK_MS);
+        task_dispatch();
+
+        // 超时唤醒时延时计数已减到0，且已被移出等待队列
+        if (curr->sleep_ticks == 0) {
+            err = -1;
+        }
+        curr->sleep_ticks = 0;
+    }
+
+    irq_leave_protection(irq_state);
+    return err;
+}
+
 /**
  * 释放信号量
  */
@@ -46,7 +93,7 @@ void sem_notify (sem_t * sem) {
         // 有进程等待，则唤醒加入就绪队列
         list_node_t * node = list_remove_first(&sem->wait_list);
         task_t * task = list_node_parent(node, task_t, wait_node);
-        task_set_ready(task);
+        sem_wakeup_task(task);
 
         task_dispatch();
     } else {
@@ -56,6 +103,50 @@ void sem_notify (sem_t * sem) {
     irq_leave_protection(irq_state);
 }
 
+/**
+ * 申请最多max个计数，没有可用计数时等待，返回实际得到的数量
+ * 被sem_notify唤醒时只得到1个
+ */
+int sem_wait_n (sem_t * sem, int max) {
+    int n = 1;
+    irq_state_t  irq_state = irq_enter_protection();
+
+    if (sem->count > 0) {
+        n = sem->count < max ? sem->count : max;
+        sem->count -= n;
+    } else {
+        task_t * curr = task_current();
+        task_set_block(curr);
+        list_insert_last(&sem->wait_list, &curr->wait_node);
+        task_dispatch();
+    }
+
+    irq_leave_protection(irq_state);
+    return n;
+}
+
+/**
+ * 一次释放n个计数，先逐个交给等待的进程，剩余的加到计数中
+ */
+void sem_notify_n (sem_t * sem, int n) {
+    int wakeup = 0;
+    irq_state_t  irq_state = irq_enter_protection();
+
+    while ((n > 0) && list_count(&sem->wait_list)) {
+        list_node_t * node = list_remove_first(&sem->wait_list);
+        task_t * task = list_node_parent(node, task_t, wait_node);
+        sem_wakeup_task(task);
+        wakeup = 1;
+        n--;
+    }
+    sem->count += n;
+
+    if (wakeup) {
+        task_dispatch();
+    }
+    irq_leave_protection(irq_state);
+}
+
 /**
  * 获取信号量的当前值
  */
@@ -66,3 +157,112 @@ int sem_count (sem_t * sem) {
     return count;
 }
 
+
+/**
+ * @brief 打开名称为name的信号量，不存在时以init_count为初值创建，返回信号量的id
+ * 打开次数同时记在进程的文件表中，只有打开过的进程才能使用，进程退出时自动关闭
+ */
+int sys_ksem_open (const char * name, int init_count) {
+    task_files_t * files = task_current()->files;
+    int id = -1;
+    int free_id = -1;
+
+    irq_state_t  irq_state = irq_enter_protection();
+    for (int i = 0; i < KSEM_NR; i++) {
+        ksem_t * ksem = ksem_tbl + i;
+        if (ksem->ref == 0) {
+            if (free_id < 0) {
+                free_id = i;
+            }
+        } else if (kernel_strncmp(ksem->name, name, KSEM_NAME_SIZE) == 0) {
+            id = i;
+            break;
+        }
+    }
+
+    if ((id < 0) && (free_id >= 0)) {
+        id = free_id;
+        kernel_strncpy(ksem_tbl[id].name, name, KSEM_NAME_SIZE);
+        sem_init(&ksem_tbl[id].sem, init_count);
+    }
+
+    // 本进程的打开次数已达上限
+    if ((id >= 0) && (files->ksem_ref[id] == 0xFF)) {
+        id = -1;
+    }
+
+    if (id >= 0) {
+        ksem_tbl[id].ref++;
+        files->ksem_ref[id]++;
+    }
+    irq_leave_protection(irq_state);
+    return id;
+}
+
+/**
+ * @brief 取本进程已打开的信号量
+ */
+static sem_t * ksem_get (int id) {
+    if ((id < 0) || (id >= KSEM_NR) || (task_current()->files->ksem_ref[id] == 0)) {
+        return (sem_t *)0;
+    }
+
+    return &ksem_tbl[id].sem;
+}
+
+/**
+ * @brief 申请信号量
+ */
+int sys_ksem_wait (int id) {
+    sem_t * sem = ksem_get(id);
+    if (!sem) {
+        return -1;
+    }
+
+    sem_wait(sem);
+    return 0;
+}
+
+/**
+ * @brief 释放信号量
+ */
+int sys_ksem_post (int id) {
+    sem_t * sem = ksem_get(id);
+    if (!sem) {
+        return -1;
+    }
+
+    sem_notify(sem);
+    return 0;
+}
+
+/**
+ * @brief 关闭本进程打开的信号量，最后一次关闭后释放
+ * 等待者所在的进程都持有引用，只有同一进程的其它线程仍在等待时，才会关闭最后一个引用，此时拒绝关闭
+ */
+int sys_ksem_close (int id) {
+    if (!ksem_get(id)) {
+        return -1;
+    }
+
+    int err = 0;
+    irq_state_t  irq_state = irq_enter_protection();
+    ksem_t * ksem = ksem_tbl + id;
+    if ((ksem->ref == 1) && list_count(&ksem->sem.wait_list)) {
+        err = -1;
+    } else {
+        ksem->ref--;
+        task_current()->files->ksem_ref[id]--;
+    }
+    irq_leave_protection(irq_state);
+    return err;
+}
+
+/**
+ * @brief 调整信号量的总打开次数，fork时子进程继承父进程的打开次数，进程退出时全部减去
+ */
+void ksem_ref_add (int id, int n) {
+    irq_state_t  irq_state = irq_enter_protection();
+    ksem_tbl[id].ref += n;
+    irq_leave_protection(irq_state);
+}
@@ -108,11 +108,16 @@ void kernel_memcpy (void * dest, void * src, int size) {
         return;
     }
 
-    uint8_t * s = (uint8_t *)src;
-    uint8_t * d = (uint8_t *)dest;
-    while (size--) {
-        *d++ = *s++;
-    }
+    // 先按4字节成块复制，剩余不足4字节的再逐字节复制
+    uint32_t words = size >> 2;
+    __asm__ __volatile__(
+        "cld\n\t"
+        "rep movsl\n\t"
+        "mov %[tail], %%ecx\n\t"
+        "rep movsb"
+        : "+D"(dest), "+S"(src), "+c"(words)
+        : [tail]"r"(size & 3)
+        : "memory");
 }
 
 void kernel_memset(void * dest, uint8_t v, int size) {
@@ -142,108 +147,286 @@ int kernel_memcmp (void * d1, void * d2, int size) {
 	return 0;
 }
 
-void kernel_itoa(char * buf, int num, int base) {
-    // 转换字符索引[-15, -14, ...-1, 0, 1, ...., 14, 15]
-    static const char * num2ch = {"FEDCBA9876543210123456789ABCDEF"};
-    char * p = buf;
-    int old_num = num;
+// 格式化输出的目标缓存，超出部分只计数不写入
+typedef struct _fmt_out_t {
+    char * buf;
+    int size;
+    int len;                // 完整输出所需的长度，不含结尾的0
+}fmt_out_t;
 
-    // 仅支持部分进制
-    if ((base != 2) && (base != 8) && (base != 10) && (base != 16)) {
-        *p = '\0';
-        return;
+static inline void fmt_putc (fmt_out_t * out, char c) {
+    if (out->len < out->size - 1) {
+        out->buf[out->len] = c;
     }
+    out->len++;
+}
 
-    // 只支持十进制负数
-    int signed_num = 0;
-    if ((num < 0) && (base == 10)) {
-        *p++ = '-';
-        signed_num = 1;
+static void fmt_fill (fmt_out_t * out, char c, int count) {
+    while (count-- > 0) {
+        fmt_putc(out, c);
     }
+}
+
+/**
+ * @brief 32位数除以10，用乘以倒数代替除法
+ */
+static inline uint32_t div10 (uint32_t n, uint32_t * rem) {
+    uint32_t q = (uint32_t)(((uint64_t)n * 0xCCCCCCCDu) >> 35);
+    *rem = n - q * 10;
+    return q;
+}
 
-    if (signed_num) {
+/**
+ * @brief 64位数除以10。没有链接libgcc，不能直接做64位除法，按16位分段长除
+ */
+static uint64_t div10_64 (uint64_t n, uint32_t * rem) {
+    uint64_t q = 0;
+    uint32_t r = 0;
+    for (int shift = 48; shift >= 0; shift -= 16) {
+        uint32_t cur = (r << 16) | (uint32_t)((n >> shift) & 0xFFFF);
+        q |= (uint64_t)div10(cur, &r) << shift;
+    }
+    *rem = r;
+    return q;
+}
+
+/**
+ * @brief 将无符号数转换为字符，从end处向前存放，返回起始位置
+ */
+static char * fmt_number (char * end, uint64_t num, int hex, int upper) {
+    static const char lower_digits[] = "0123456789abcdef";
+    static const char upper_digits[] = "0123456789ABCDEF";
+    const char * digits = upper ? upper_digits : lower_digits;
+    char * p = end;
+
+    if (hex) {
         do {
-            char ch = num2ch[num % base + 15];
-            *p++ = ch;
-            num /= base;
+            *--p = digits[num & 0xF];
+            num >>= 4;
         } while (num);
     } else {
-        uint32_t u_num = (uint32_t)num;
+        uint32_t r;
+        while (num >> 32) {
+            num = div10_64(num, &r);
+            *--p = '0' + r;
+        }
+
+        uint32_t n = (uint32_t)num;
         do {
-            char ch = num2ch[u_num % base + 15];
-            *p++ = ch;
-            u_num /= base;
-        } while (u_num);
+            n = div10(n, &r);
+            *--p = '0' + r;
+        } while (n);
     }
-    *p-- = '\0';
+    return p;
+}
+
+/**
+ * @brief 格式化字符串到最多size字节的缓存中，结果总以0结尾
+ * 支持%d %i %u %x %X %p %c %s %%，标志'-' '0'，宽度和精度(可为*)，长度l ll z h
+ * 返回完整输出所需的长度，不含结尾的0，大于等于size时表示输出被截断
+ */
+int kernel_vsnprintf(char * buffer, int size, const char * fmt, va_list args) {
+    fmt_out_t out = {.buf = buffer, .size = size, .len = 0};
+    char num_buf[24];
+    char ch;
+
+    while ((ch = *fmt++)) {
+        if (ch != '%') {
+            fmt_putc(&out, ch);
+            continue;
+        }
+
+        // 标志
+        int left = 0, zero = 0;
+        for (;; fmt++) {
+            if (*fmt == '-') {
+                left = 1;
+            } else if (*fmt == '0') {
+                zero = 1;
+            } else {
+                break;
+            }
+        }
 
-    // 将转换结果逆序，生成最终的结果
-    char * start = (!signed_num) ? buf : buf + 1;
-    while (start < p) {
-        char ch = *start;
-        *start = *p;
-        *p-- = ch;
-        start++;
+        // 宽度
+        int width = 0;
+        if (*fmt == '*') {
+            width = va_arg(args, int);
+            if (width < 0) {
+                left = 1;
+                width = -width;
+            }
+            fmt++;
+        } else {
+            while ((*fmt >= '0') && (*fmt <= '9')) {
+                width = width * 10 + (*fmt++ - '0');
+            }
+        }
+
+        // 精度，为-1表示未指定
+        int prec = -1;
+        if (*fmt == '.') {
+            fmt++;
+            prec = 0;
+            if (*fmt == '*') {
+                prec = va_arg(args, int);
+                fmt++;
+            } else {
+                while ((*fmt >= '0') && (*fmt <= '9')) {
+                    prec = prec * 10 + (*fmt++ - '0');
+                }
+            }
+        }
+
+        // 长度，只有ll是64位
+        int is_64 = 0;
+        while ((*fmt == 'l') || (*fmt == 'h') || (*fmt == 'z')) {
+            if ((fmt[0] == 'l') && (fmt[1] == 'l')) {
+                is_64 = 1;
+                fmt++;
+            }
+            fmt++;
+        }
+
+        ch = *fmt++;
+        if (ch == '\0') {
+            break;
+        }
+
+        const char * str;
+        int len;
+        char sign = 0;
+        const char * prefix = "";
+        switch (ch) {
+            case 'c':
+                num_buf[0] = (char)va_arg(args, int);
+                str = num_buf;
+                len = 1;
+                break;
+            case 's':
+                str = va_arg(args, const char *);
+                if (str == (const char *)0) {
+                    str = "(null)";
+                }
+                for (len = 0; str[len] && ((prec < 0) || (len < prec)); len++) {}
+                break;
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'p': {
+                uint64_t num;
+                if (ch == 'p') {
+                    num = (uint32_t)va_arg(args, void *);
+                    prefix = "0x";
+                    prec = 8;
+                } else if ((ch == 'd') || (ch == 'i')) {
+                    long long n = is_64 ? va_arg(args, long long) : va_arg(args, int);
+                    num = (uint64_t)n;
+                    if (n < 0) {
+                        sign = '-';
+                        num = -num;
+                    }
+                } else {
+                    num = is_64 ? va_arg(args, uint64_t) : va_arg(args, uint32_t);
+                }
+
+                char * end = num_buf + sizeof(num_buf);
+                str = fmt_number(end, num, ch != 'd' && ch != 'i' && ch != 'u', ch == 'X');
+                len = end - str;
+                if ((prec == 0) && (num == 0)) {
+                    len = 0;        // 与C库一致，精度为0时0值不输出数字
+                }
+
+                // 精度为最少的数字位数
+                int prefix_len = kernel_strlen(prefix) + (sign ? 1 : 0);
+                int digits = (prec > len) ? prec : len;
+                int pad = width - prefix_len - digits;
+                if (zero && !left && (prec < 0) && (pad > 0)) {
+                    digits += pad;
+                    pad = 0;
+                }
+
+                if (!left) {
+                    fmt_fill(&out, ' ', pad);
+                }
+                if (sign) {
+                    fmt_putc(&out, sign);
+                }
+                while (*prefix) {
+                    fmt_putc(&out, *prefix++);
+                }
+                fmt_fill(&out, '0', digits - len);
+                while (len--) {
+                    fmt_putc(&out, *str++);
+                }
+                if (left) {
+                    fmt_fill(&out, ' ', pad);
+                }
+                continue;
+            }
+            case '%':
+            default:
+                // 不支持的格式原样输出
+                num_buf[0] = ch;
+                str = num_buf;
+                len = 1;
+                break;
+        }
+
+        int pad = width - len;
+        if (!left) {
+            fmt_fill(&out, ' ', pad);
+        }
+        while (len-- > 0) {
+            fmt_putc(&out, *str++);
+        }
+        if (left) {
+            fmt_fill(&out, ' ', pad);
+        }
     }
+
+    if (size > 0) {
+        buffer[(out.len < size) ? out.len : size - 1] = '\0';
+    }
+    return out.len;
+}
+
+/**
+ * @brief 格式化字符串到最多size字节的缓存中
+ */
+int kernel_snprintf(char * buffer, int size, const char * fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    int len = kernel_vsnprintf(buffer, size, fmt, args);
+    va_end(args);
+    return len;
 }
 
 /**
- * @brief 格式化字符串到缓存中
+ * @brief 格式化字符串到缓存中，不检查缓存大小
  */
 void kernel_sprintf(char * buffer, const char * fmt, ...) {
     va_list args;
 
     va_start(args, fmt);
-    kernel_vsprintf(buffer, fmt, args);
+    kernel_vsnprintf(buffer, 0x7FFFFFFF, fmt, args);
     va_end(args);
 }
 
 /**
- * 格式化字符串
+ * 格式化字符串，不检查缓存大小
  */
 void kernel_vsprintf(char * buffer, const char * fmt, va_list args) {
-    enum {NORMAL, READ_FMT} state = NORMAL;
-    char ch;
-    char * curr = buffer;
-    while ((ch = *fmt++)) {
-        switch (state) {
-            // 普通字符
-            case NORMAL:
-                if (ch == '%') {
-                    state = READ_FMT;
-                } else {
-                    *curr++ = ch;
-                }
-                break;
-            // 格式化控制字符，只支持部分
-            case READ_FMT:
-                if (ch == 'd') {
-                    int num = va_arg(args, int);
-                    kernel_itoa(curr, num, 10);
-                    curr += kernel_strlen(curr);
-                } else if (ch == 'x') {
-                    int num = va_arg(args, int);
-                    kernel_itoa(curr, num, 16);
-                    curr += kernel_strlen(curr);
-                } else if (ch == 'c') {
-                    char c = va_arg(args, int);
-                    *curr++ = c;
-                } else if (ch == 's') {
-                    const char * str = va_arg(args, char *);
-                    int len = kernel_strlen(str);
-                    while (len--) {
-                        *curr++ = *str++;
-                    }
-                }
-                state = NORMAL;
-                break;
-        }
-    }
+    kernel_vsnprintf(buffer, 0x7FFFFFFF, fmt, args);
 }
 
 void panic (const char * file, int line, const char * func, const char * cond) {
-    log_printf("assert failed! %s", cond);
-    log_printf("file: %s\nline %d\nfunc: %s\n", file, line, func);
+    log_printk(LOG_ERR, "assert failed! %s", cond);
+    log_printk(LOG_ERR, "file: %s\nline %d\nfunc: %s\n", file, line, func);
+    log_flush();
 
     for (;;) {
         hlt();
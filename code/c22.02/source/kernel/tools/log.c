@@ -1,6 +1,11 @@
 /**
  * 日志输出
  *
+ * 日志带上级别和时间戳后追加到环形缓存中，格式为"<级别>[秒.毫秒] 内容\n"。
+ * 追加时只短暂关中断，不使用互斥锁，可以在中断和异常处理中调用。
+ * 缓存满时丢弃最早的整条日志。缓存中的日志由klogd线程输出到控制台，
+ * klogd启动前和panic之后则直接输出。/dev/kmsg可读出缓存中的全部日志。
+ *
  * 创建时间：2021年8月5日
  * 作者：李述铜
  * 联系邮箱: 527676163@qq.com
@@ -11,75 +16,243 @@
 #include "tools/log.h"
 #include "cpu/irq.h"
 #include "os_cfg.h"
-#include "ipc/mutex.h"
+#include "ipc/sem.h"
+#include "core/task.h"
 #include "dev/console.h"
 #include "dev/dev.h"
+#include "dev/tty.h"
+#include "dev/time.h"
 
-// 目标用串口，参考资料：https://wiki.osdev.org/Serial_Ports
+// 输出到串口ttyS0，由串口中断发送，不再逐字节查询等待
 #define LOG_USE_COM         0
-#define COM1_PORT           0x3F8       // RS232端口0初始化
 
-static mutex_t mutex;
+/**
+ * @brief 日志环形缓存，位置均为累计写入的字节数
+ */
+static struct {
+    char buf[LOG_BUF_SIZE];
+    uint32_t head;              // 写入位置
+    uint32_t tail;              // 最早一条完整日志的起始位置
+    uint32_t con_pos;           // 已输出到控制台的位置
+}log_ring;
+
 static int log_dev_id;
+static int log_sync = 1;        // 直接在调用者中输出，klogd启动前及panic后使用
+static int log_draining;        // 正在输出，防止输出过程中产生的日志重入
+static int con_level = LOG_INFO;    // 当前输出行的级别，超长日志的后续部分沿用
+
+static sem_t klogd_sem;
+static int klogd_waiting;       // klogd已无日志可输出，等待唤醒
+
+static inline char ring_char (uint32_t pos) {
+    return log_ring.buf[pos & (LOG_BUF_SIZE - 1)];
+}
 
 /**
- * @brief 初始化日志输出
+ * @brief 将一条日志追加到缓存，空间不足时丢弃最早的整条日志。需在中断保护中调用
  */
-void log_init (void) {
-    mutex_init(&mutex);
+static void ring_append (const char * str, int len) {
+    while (log_ring.head + len - log_ring.tail > LOG_BUF_SIZE) {
+        while (ring_char(log_ring.tail++) != '\n') {}
+    }
 
-    log_dev_id = dev_open(DEV_TTY, 0, 0);
+    // 尚未输出的日志被覆盖，跳过
+    if ((int)(log_ring.con_pos - log_ring.tail) < 0) {
+        log_ring.con_pos = log_ring.tail;
+    }
+
+    uint32_t offset = log_ring.head & (LOG_BUF_SIZE - 1);
+    uint32_t first = LOG_BUF_SIZE - offset;
+    if (first > len) {
+        first = len;
+    }
+    kernel_memcpy(log_ring.buf + offset, (void *)str, first);
+    kernel_memcpy(log_ring.buf, (void *)(str + first), len - first);
+    log_ring.head += len;
+}
+
+/**
+ * @brief 将缓存中尚未输出的日志逐行写到控制台
+ */
+static void log_drain (void) {
+    char line[LOG_MSG_SIZE];
+
+    irq_state_t state = irq_enter_protection();
+    if (log_draining) {
+        irq_leave_protection(state);
+        return;
+    }
+    log_draining = 1;
+
+    while (log_ring.con_pos != log_ring.head) {
+        // 每次取出一行，写tty时可能等待，不能在中断保护中进行
+        int len = 0;
+        while ((log_ring.con_pos != log_ring.head) && (len < sizeof(line))) {
+            char c = ring_char(log_ring.con_pos++);
+            line[len++] = c;
+            if (c == '\n') {
+                break;
+            }
+        }
+        irq_leave_protection(state);
 
+        // 去掉级别前缀，内容中换行后的部分沿用上一行的级别
+        char * msg = line;
+        if ((len >= 3) && (line[0] == '<') && (line[2] == '>')) {
+            con_level = line[1] - '0';
+            msg += 3;
+            len -= 3;
+        }
+        if (con_level <= LOG_CONSOLE_LEVEL) {
+            dev_write(log_dev_id, 0, msg, len);
+        }
+
+        state = irq_enter_protection();
+    }
+
+    log_draining = 0;
+    irq_leave_protection(state);
+}
+
+/**
+ * @brief 日志输出线程，有新日志时由定时器唤醒
+ */
+static void klogd_entry (void * arg) {
+    for (;;) {
+        log_drain();
+
+        irq_state_t state = irq_enter_protection();
+        klogd_waiting = (log_ring.con_pos == log_ring.head);
+        int idle = klogd_waiting;
+        irq_leave_protection(state);
+
+        if (idle) {
+            sem_wait(&klogd_sem);
+        }
+    }
+}
+
+/**
+ * @brief 格式化日志并追加到缓存
+ */
+static void log_vprintk (int level, const char * fmt, va_list args) {
+    char str_buf[LOG_MSG_SIZE];
+
+    uint32_t ms = time_get_tick() * OS_TICK_MS;
+    int len = kernel_snprintf(str_buf, sizeof(str_buf), "<%d>[%5d.%03d] ", level, ms / 1000, ms % 1000);
+    len += kernel_vsnprintf(str_buf + len, sizeof(str_buf) - len, fmt, args);
+
+    // 过长的日志被截断，留出换行的位置
+    if (len > sizeof(str_buf) - 2) {
+        len = sizeof(str_buf) - 2;
+    }
+    str_buf[len++] = '\n';
+
+    irq_state_t state = irq_enter_protection();
+    ring_append(str_buf, len);
+    int sync = log_sync;
+    irq_leave_protection(state);
+
+    if (sync) {
+        log_drain();
+    }
+}
+
+/**
+ * @brief 初始化日志输出
+ */
+void log_init (void) {
 #if LOG_USE_COM
-    outb(COM1_PORT + 1, 0x00);    // Disable all interrupts
-    outb(COM1_PORT + 3, 0x80);    // Enable DLAB (set baud rate divisor)
-    outb(COM1_PORT + 0, 0x03);    // Set divisor to 3 (lo byte) 38400 baud
-    outb(COM1_PORT + 1, 0x00);    //                  (hi byte)
-    outb(COM1_PORT + 3, 0x03);    // 8 bits, no parity, one stop bit
-    outb(COM1_PORT + 2, 0xC7);    // Enable FIFO, clear them, with 14-byte threshold
-  
-    // If serial is not faulty set it in normal operation mode
-    // (not-loopback with IRQs enabled and OUT#1 and OUT#2 bits enabled)
-    outb(COM1_PORT + 4, 0x0F);
+    log_dev_id = dev_open(DEV_TTY, TTY_NR, 0);
+#else
+    log_dev_id = dev_open(DEV_TTY, 0, 0);
 #endif
 }
 
 /**
- * @brief 日志打印
+ * @brief 启动日志输出线程，需在任务管理初始化后调用
+ */
+void log_worker_init (void) {
+    sem_init(&klogd_sem, 0);
+
+    task_t * task = kthread_create("klogd", klogd_entry, (void *)0);
+    if (task == (task_t *)0) {
+        log_printk(LOG_WARN, "create klogd failed, log output is synchronous");
+        return;
+    }
+
+    log_sync = 0;
+}
+
+/**
+ * @brief 日志打印，级别为LOG_INFO
  */
 void log_printf(const char * fmt, ...) {
-    char str_buf[128];
     va_list args;
 
-    kernel_memset(str_buf, '\0', sizeof(str_buf));
+    va_start(args, fmt);
+    log_vprintk(LOG_INFO, fmt, args);
+    va_end(args);
+}
+
+/**
+ * @brief 按指定级别打印日志
+ */
+void log_printk(int level, const char * fmt, ...) {
+    va_list args;
 
     va_start(args, fmt);
-    kernel_vsprintf(str_buf, fmt, args);
+    log_vprintk(level, fmt, args);
     va_end(args);
+}
 
-    // 显示，如果发送速度太慢，会造成这里关中断太长时间
-    // 所以，这里这样做不是好办法
-    mutex_lock(&mutex);
-    
-#if LOG_USE_COM
-    const char * p = str_buf;    
-    while (*p != '\0') {
-        while ((inb(COM1_PORT + 5) & (1 << 6)) == 0);
-        outb(COM1_PORT, *p++);
+/**
+ * @brief 从pos处读取缓存中的日志，并更新pos。pos处的日志已被覆盖时从最早的日志开始读
+ */
+int log_read (int * pos, char * buf, int size) {
+    irq_state_t state = irq_enter_protection();
+
+    uint32_t start = (uint32_t)*pos;
+    if ((int)(start - log_ring.tail) < 0) {
+        start = log_ring.tail;
     }
 
-    outb(COM1_PORT, '\r');
-    outb(COM1_PORT, '\n');
-#else
-    //console_write(0, str_buf, kernel_strlen(str_buf));
-    dev_write(log_dev_id, 0, "log:", 4);
-    dev_write(log_dev_id, 0, str_buf, kernel_strlen(str_buf));
+    uint32_t count = log_ring.head - start;
+    if (count > size) {
+        count = size;
+    }
+
+    uint32_t offset = start & (LOG_BUF_SIZE - 1);
+    uint32_t first = LOG_BUF_SIZE - offset;
+    if (first > count) {
+        first = count;
+    }
+    kernel_memcpy(buf, log_ring.buf + offset, first);
+    kernel_memcpy(buf + first, log_ring.buf, count - first);
 
-    char c = '\n';
-    //console_write(0, &c, 1);
-    dev_write(log_dev_id, 0, &c, 1);
+    *pos = start + count;
+    irq_leave_protection(state);
+    return count;
+}
 
-#endif
-    mutex_unlock(&mutex);
+/**
+ * @brief 定时器中调用，有新日志时唤醒klogd
+ */
+void log_tick (void) {
+    if (klogd_waiting && (log_ring.con_pos != log_ring.head)) {
+        klogd_waiting = 0;
+        sem_notify(&klogd_sem);
+    }
 }
 
+/**
+ * @brief 立即输出缓存中的全部日志，此后的日志也直接输出。用于panic
+ */
+void log_flush (void) {
+    irq_state_t state = irq_enter_protection();
+    log_sync = 1;
+    log_draining = 0;       // 可能在输出过程中出错，强制重新开始输出
+    irq_leave_protection(state);
+
+    log_drain();
+}
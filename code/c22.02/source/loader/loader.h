@@ -27,6 +27,42 @@ typedef struct SMAP_entry {
     uint32_t ACPI; // extended
 }__attribute__((packed)) SMAP_entry_t;
 
+// VBE控制器信息，参考https://wiki.osdev.org/VESA_Video_Modes
+typedef struct _vbe_info_t {
+    char signature[4];          // 调用前填"VBE2"，返回"VESA"
+    uint16_t version;
+    uint32_t oem;
+    uint32_t capabilities;
+    uint16_t mode_off;          // 模式号列表的地址，以0xFFFF结束
+    uint16_t mode_seg;
+    uint16_t total_memory;      // 显存大小，以64KB为单位
+    uint8_t reserved[492];
+}__attribute__((packed)) vbe_info_t;
+
+// VBE模式信息
+typedef struct _vbe_mode_info_t {
+    uint16_t attributes;        // 位4：图形模式，位7：支持线性帧缓存
+    uint8_t window_a, window_b;
+    uint16_t granularity;
+    uint16_t window_size;
+    uint16_t segment_a, segment_b;
+    uint32_t win_func_ptr;
+    uint16_t pitch;             // 每行的字节数
+    uint16_t width, height;
+    uint8_t w_char, y_char, planes, bpp, banks;
+    uint8_t memory_model;       // 6为直接颜色
+    uint8_t bank_size, image_pages, reserved0;
+    uint8_t red_mask, red_position;
+    uint8_t green_mask, green_position;
+    uint8_t blue_mask, blue_position;
+    uint8_t reserved_mask, reserved_position;
+    uint8_t direct_color_attributes;
+    uint32_t framebuffer;       // 线性帧缓存的物理地址
+    uint32_t off_screen_mem_off;
+    uint16_t off_screen_mem_size;
+    uint8_t reserved1[206];
+}__attribute__((packed)) vbe_mode_info_t;
+
 extern boot_info_t boot_info;
 
 #endif // LOADER_H
@@ -75,6 +75,123 @@ static void  detect_memory(void) {
     show_msg("ok.\r\n");
 }
 
+#if BOOT_FB_ENABLE
+/**
+ * 读取seg:off处的16位数据，地址可能不在当前段内
+ */
+static uint16_t read_far16 (uint16_t seg, uint16_t off) {
+    uint16_t v;
+
+    __asm__ __volatile__(
+        "pushw %%es\n\t"
+        "mov %[seg], %%es\n\t"
+        "mov %%es:(%[off]), %[v]\n\t"
+        "popw %%es"
+        :[v]"=r"(v):[seg]"r"(seg), [off]"b"(off));
+    return v;
+}
+
+#if BOOT_FB_BIOS_FONT
+/**
+ * 从BIOS中复制8x16字体，供图形模式下的控制台使用
+ */
+static void copy_bios_font (void) {
+    uint16_t seg, off;
+
+    // INT 0x10, AX=0x1130, BH=6：返回8x16字体的地址ES:BP
+	__asm__ __volatile__(
+        "pushw %%bp\n\t"
+        "pushw %%es\n\t"
+        "int $0x10\n\t"
+        "mov %%es, %%ax\n\t"
+        "mov %%bp, %%cx\n\t"
+        "popw %%es\n\t"
+        "popw %%bp"
+        :"=a"(seg), "=c"(off):"a"(0x1130), "b"(0x0600):"dx");
+
+    uint16_t * font = (uint16_t *)boot_info.fb_font;
+    for (int i = 0; i < BOOT_FONT_SIZE / 2; i++) {
+        font[i] = read_far16(seg, off + i * 2);
+    }
+}
+#endif
+
+// 参考：https://wiki.osdev.org/VESA_Video_Modes
+// 遍历BIOS支持的模式，选择不超过BOOT_FB_WIDTH*BOOT_FB_HEIGHT的最大的32位线性帧缓存模式
+static void detect_vbe (void) {
+    static vbe_info_t vbe_info;
+    static vbe_mode_info_t mode_info;
+    uint16_t status;
+
+    show_msg("try to set vbe mode:");
+
+    boot_info.fb_addr = 0;
+    vbe_info.signature[0] = 'V';
+    vbe_info.signature[1] = 'B';
+    vbe_info.signature[2] = 'E';
+    vbe_info.signature[3] = '2';
+	__asm__ __volatile__("int $0x10"
+        :"=a"(status):"a"(0x4F00), "D"(&vbe_info):"memory");
+    if (status != 0x004F) {
+        show_msg("no vbe.\r\n");
+        return;
+    }
+
+#if BOOT_FB_BIOS_FONT
+    // 字体要在切换模式前取得
+    copy_bios_font();
+#endif
+
+    uint16_t best_mode = 0xFFFF;
+    uint32_t best_area = 0;
+    for (uint16_t off = vbe_info.mode_off; ; off += 2) {
+        uint16_t mode = read_far16(vbe_info.mode_seg, off);
+        if (mode == 0xFFFF) {
+            break;
+        }
+
+        __asm__ __volatile__("int $0x10"
+            :"=a"(status):"a"(0x4F01), "c"(mode), "D"(&mode_info):"memory");
+        if (status != 0x004F) {
+            continue;
+        }
+
+        // 只用支持线性帧缓存的32位直接颜色图形模式
+        if (((mode_info.attributes & 0x90) != 0x90) || (mode_info.bpp != 32) || (mode_info.memory_model != 6)) {
+            continue;
+        }
+        if ((mode_info.width > BOOT_FB_WIDTH) || (mode_info.height > BOOT_FB_HEIGHT)) {
+            continue;
+        }
+
+        uint32_t area = (uint32_t)mode_info.width * mode_info.height;
+        if (area > best_area) {
+            best_area = area;
+            best_mode = mode;
+            boot_info.fb_addr = mode_info.framebuffer;
+            boot_info.fb_width = mode_info.width;
+            boot_info.fb_height = mode_info.height;
+            boot_info.fb_pitch = mode_info.pitch;
+            boot_info.fb_bpp = mode_info.bpp;
+        }
+    }
+
+    if (best_mode == 0xFFFF) {
+        boot_info.fb_addr = 0;
+        show_msg("no mode.\r\n");
+        return;
+    }
+
+    // 切换模式，位14表示使用线性帧缓存。之后BIOS不能再显示文字
+    __asm__ __volatile__("int $0x10"
+        :"=a"(status):"a"(0x4F02), "b"(best_mode | 0x4000));
+    if (status != 0x004F) {
+        boot_info.fb_addr = 0;
+        show_msg("failed.\r\n");
+    }
+}
+#endif // BOOT_FB_ENABLE
+
 // GDT表。临时用，后面内容会替换成自己的
 uint16_t gdt_table[][4] = {
     {0, 0, 0, 0},
@@ -110,6 +227,9 @@ static void  enter_protect_mode() {
 void loader_entry(void) {
     show_msg("....loading.....\r\n");
 	detect_memory();
+#if BOOT_FB_ENABLE
+    detect_vbe();
+#endif
     enter_protect_mode();
     for(;;) {}
 }
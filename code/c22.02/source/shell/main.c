@@ -190,7 +190,7 @@ static int do_less (int argc, char ** argv) {
  */
 static int do_ls (int argc, char ** argv) {
     // 打开目录
-	DIR * p_dir = opendir("temp");
+	DIR * p_dir = opendir(argc > 1 ? argv[1] : ".");
 	if (p_dir == NULL) {
 		printf("open dir failed\n");
 		return -1;
@@ -210,6 +210,32 @@ static int do_ls (int argc, char ** argv) {
     return 0;
 }
 
+/**
+ * @brief 切换当前目录
+ */
+static int do_cd (int argc, char ** argv) {
+    const char * path = argc > 1 ? argv[1] : "/";
+
+    if (chdir(path) < 0) {
+        fprintf(stderr, "cd failed: %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 显示当前目录
+ */
+static int do_pwd (int argc, char ** argv) {
+    char cwd[FILE_PATH_SIZE];
+
+    if (getcwd(cwd, sizeof(cwd)) == (char *)0) {
+        return -1;
+    }
+    puts(cwd);
+    return 0;
+}
+
 /**
  * @brief 复制文件命令
  */
@@ -262,6 +288,54 @@ static int do_remove (int argc, char ** argv) {
     return 0;
 }
 
+/**
+ * @brief 显示内核日志
+ */
+static int do_dmesg (int argc, char ** argv) {
+    int raw = 0;
+
+    int ch;
+    while ((ch = getopt(argc, argv, "rh")) != -1) {
+        switch (ch) {
+            case 'h':
+                puts("show kernel log");
+                puts("dmesg [-r]");
+                puts("-r keep the <level> prefix.");
+                optind = 1;        // getopt需要多次调用，需要重置
+                return 0;
+            case 'r':
+                raw = 1;
+                break;
+            case '?':
+                if (optarg) {
+                    fprintf(stderr, "Unknown option: -%s\n", optarg);
+                }
+                optind = 1;        // getopt需要多次调用，需要重置
+                return -1;
+        }
+    }
+    optind = 1;        // getopt需要多次调用，需要重置
+
+    FILE * file = fopen("/dev/kmsg", "r");
+    if (file == NULL) {
+        fprintf(stderr, "open /dev/kmsg failed.");
+        return -1;
+    }
+
+    char * buf = (char *)malloc(255);
+    while (fgets(buf, 255, file) != NULL) {
+        // 每行以<级别>开头，超长行的后续部分没有
+        char * msg = buf;
+        if (!raw && (buf[0] == '<') && buf[1] && (buf[2] == '>')) {
+            msg += 3;
+        }
+        fputs(msg, stdout);
+    }
+    free(buf);
+    fclose(file);
+    return 0;
+}
+
 // 命令列表
 static const cli_cmd_t cmd_list[] = {
     {
@@ -284,6 +358,16 @@ static const cli_cmd_t cmd_list[] = {
         .useage = "ls [dir] -- list director",
         .do_func = do_ls,
     },
+    {
+        .name = "cd",
+        .useage = "cd [dir] -- change current directory",
+        .do_func = do_cd,
+    },
+    {
+        .name = "pwd",
+        .useage = "pwd -- show current directory",
+        .do_func = do_pwd,
+    },
     {
         .name = "less",
         .useage = "list text file content",
@@ -299,6 +383,11 @@ static const cli_cmd_t cmd_list[] = {
         .useage = "rm file -- remove file",
         .do_func = do_remove,
     },
+    {
+        .name = "dmesg",
+        .useage = "dmesg [-r] -- show kernel log",
+        .do_func = do_dmesg,
+    },
     {
         .name = "quit",
         .useage = "quit from shell",
@@ -345,42 +434,202 @@ static void run_builtin (const cli_cmd_t * cmd, int argc, char ** argv) {
 
 /**
  * 遍历搜索目录，看看文件是否存在，存在返回文件所在路径
+ * 先在当前目录下找，再到根目录下找
  */
 static const char * find_exec_path (const char * file_name) {
+    static const char * fmt_list[] = {"%s", "%s.elf", "/%s", "/%s.elf"};
     static char path[255];
 
-    int fd = open(file_name, 0);
-    if (fd < 0) {
-        sprintf(path, "%s.elf", file_name);
-        fd = open(path, 0);
-        if (fd < 0) {
-            return (const char * )0;
+    for (int i = 0; i < sizeof(fmt_list) / sizeof(fmt_list[0]); i++) {
+        snprintf(path, sizeof(path), fmt_list[i], file_name);
+
+        int fd = open(path, 0);
+        if (fd >= 0) {
+            close(fd);
+            return path;
         }
     }
 
-    close(fd);
-    return path;
+    return (const char * )0;
 }
 
 /**
- * 试图运行当前文件
+ * 将输入解析为以|连接的多条命令，同时提取出<和>重定向的文件
+ * 返回命令的数量，格式错误时返回-1
  */
-static void run_exec_file (const char * path, int argc, char ** argv) {
-    int pid = fork();
-    if (pid < 0) {
-        fprintf(stderr, "fork failed: %s", path);
-    } else if (pid == 0) {
-        // 子进程
-        int err = execve(path, argv, (char * const *)0);
-        if (err < 0) {
-            fprintf(stderr, "exec failed: %s", path);
+static int parse_pipeline (char * input, cli_stage_t * stage_list) {
+    int count = 0;
+    cli_stage_t * stage = stage_list;
+    memset(stage, 0, sizeof(cli_stage_t));
+
+    const char * space = " ";  // 字符分割器
+    char * token = strtok(input, space);
+    while (token) {
+        if (strcmp(token, "|") == 0) {
+            // 前一条命令不能为空
+            if ((stage->argc == 0) || (++count >= CLI_MAX_STAGE_COUNT)) {
+                return -1;
+            }
+            stage = stage_list + count;
+            memset(stage, 0, sizeof(cli_stage_t));
+        } else if ((strcmp(token, "<") == 0) || (strcmp(token, ">") == 0)) {
+            // 后面紧跟文件名
+            char * file = strtok(NULL, space);
+            if (!file) {
+                return -1;
+            }
+
+            if (token[0] == '<') {
+                stage->in_file = file;
+            } else {
+                stage->out_file = file;
+            }
+        } else {
+            if (stage->argc >= CLI_MAX_ARG_COUNT) {
+                return -1;
+            }
+            stage->argv[stage->argc++] = token;
         }
+
+        token = strtok(NULL, space);
+    }
+
+    // 空行返回0，以|结尾则出错
+    if (stage->argc == 0) {
+        return count ? -1 : 0;
+    }
+    return count + 1;
+}
+
+/**
+ * 按命令中的<和>，将标准输入输出重定向到文件
+ */
+static int redirect_stage (const cli_stage_t * stage) {
+    if (stage->in_file) {
+        int fd = open(stage->in_file, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "open file failed: %s\n", stage->in_file);
+            return -1;
+        }
+        dup2(fd, 0);
+        close(fd);
+    }
+
+    if (stage->out_file) {
+        int fd = open(stage->out_file, O_WRONLY | O_CREAT | O_TRUNC);
+        if (fd < 0) {
+            fprintf(stderr, "open file failed: %s\n", stage->out_file);
+            return -1;
+        }
+        dup2(fd, 1);
+        close(fd);
+    }
+
+    return 0;
+}
+
+/**
+ * 在当前shell中运行带重定向的内部命令，运行完后恢复标准输入输出
+ */
+static void run_builtin_redirect (const cli_cmd_t * cmd, const cli_stage_t * stage) {
+    fflush(stdout);
+    int saved_in = dup(0);
+    int saved_out = dup(1);
+
+    if (redirect_stage(stage) == 0) {
+        run_builtin(cmd, stage->argc, (char **)stage->argv);
+        fflush(stdout);
+    }
+
+    dup2(saved_in, 0);
+    dup2(saved_out, 1);
+    close(saved_in);
+    close(saved_out);
+}
+
+/**
+ * 在子进程中运行管道中的一条命令，不返回
+ */
+static void exec_stage (const cli_stage_t * stage) {
+    if (redirect_stage(stage) < 0) {
         exit(-1);
-    } else {
-		// 等待子进程执行完毕
+    }
+
+    // 内部命令在子进程中运行，以便其输出能进入管道
+    const cli_cmd_t * cmd = find_builtin(stage->argv[0]);
+    if (cmd) {
+        int ret = cmd->do_func(stage->argc, (char **)stage->argv);
+        fflush(stdout);
+        exit(ret);
+    }
+
+    const char * path = find_exec_path(stage->argv[0]);
+    int err = execve(path, (char * const *)stage->argv, (char * const *)0);
+    if (err < 0) {
+        fprintf(stderr, "exec failed: %s", path);
+    }
+    exit(-1);
+}
+
+/**
+ * 运行以管道相连的各条命令，前一条命令的输出作为后一条命令的输入
+ */
+static void run_pipeline (cli_stage_t * stage_list, int count) {
+    int in_fd = -1;         // 上一条命令输出管道的读端
+    int started = 0;
+
+    // 清空缓存，避免子进程重复输出
+    fflush(stdout);
+
+    for (int i = 0; i < count; i++) {
+        int pipe_fd[2] = {-1, -1};
+        if ((i < count - 1) && (pipe(pipe_fd) < 0)) {
+            fprintf(stderr, "create pipe failed\n");
+            break;
+        }
+
+        int pid = fork();
+        if (pid < 0) {
+            fprintf(stderr, "fork failed: %s", stage_list[i].argv[0]);
+            if (pipe_fd[0] >= 0) {
+                close(pipe_fd[0]);
+                close(pipe_fd[1]);
+            }
+            break;
+        } else if (pid == 0) {
+            // 子进程，连接前后的管道
+            if (in_fd >= 0) {
+                dup2(in_fd, 0);
+                close(in_fd);
+            }
+            if (pipe_fd[1] >= 0) {
+                dup2(pipe_fd[1], 1);
+                close(pipe_fd[0]);
+                close(pipe_fd[1]);
+            }
+            exec_stage(stage_list + i);
+        }
+
+        // 父进程不使用管道，及时关闭，否则读端永远等不到结束
+        started++;
+        if (in_fd >= 0) {
+            close(in_fd);
+        }
+        if (pipe_fd[1] >= 0) {
+            close(pipe_fd[1]);
+        }
+        in_fd = pipe_fd[0];
+    }
+
+    if (in_fd >= 0) {
+        close(in_fd);
+    }
+
+    // 等待所有子进程执行完毕
+    while (started--) {
         int status;
         int pid = wait(&status);
-        fprintf(stderr, "cmd %s result: %d, pid = %d\n", path, status, pid);
+        fprintf(stderr, "cmd result: %d, pid = %d\n", status, pid);
     }
 }
 
@@ -412,42 +661,44 @@ int main (int argc, char **argv) {
             *cr = '\0';
         }
 
-        int argc = 0;
-        char * argv[CLI_MAX_ARG_COUNT];
-        memset(argv, 0, sizeof(argv));
-
-        // 提取出命令，找命令表
-        const char * space = " ";  // 字符分割器
-        char *token = strtok(cli.curr_input, space);
-        while (token) {
-            // 记录参数
-            argv[argc++] = token;
-
-            // 先获取下一位置
-            token = strtok(NULL, space);
-        }
-
-        // 没有任何输入，则x继续循环
-        if (argc == 0) {
+        // 解析出各条命令
+        cli_stage_t stage_list[CLI_MAX_STAGE_COUNT];
+        int count = parse_pipeline(cli.curr_input, stage_list);
+        if (count < 0) {
+            fprintf(stderr, ESC_COLOR_ERROR"Syntax error\n"ESC_COLOR_DEFAULT);
+            continue;
+        } else if (count == 0) {
+            // 没有任何输入，则x继续循环
             continue;
         }
 
-        // 试图作为内部命令加载执行
-        const cli_cmd_t * cmd = find_builtin(argv[0]);
-        if (cmd) {
-            run_builtin(cmd, argc, argv);
+        // 单独的内部命令，直接在shell中执行
+        const cli_cmd_t * cmd = find_builtin(stage_list[0].argv[0]);
+        if ((count == 1) && cmd) {
+            if (stage_list[0].in_file || stage_list[0].out_file) {
+                run_builtin_redirect(cmd, stage_list);
+            } else {
+                run_builtin(cmd, stage_list[0].argc, stage_list[0].argv);
+            }
             continue;
         }
 
-        // 试图作为外部命令执行。只检查文件是否存在，不考虑是否可执行
-        const char * path = find_exec_path(argv[0]);
-        if (path) {
-            run_exec_file(path, argc, argv);
+        // 外部命令只检查文件是否存在，不考虑是否可执行
+        const char * unknown = (const char *)0;
+        for (int i = 0; i < count; i++) {
+            const char * name = stage_list[i].argv[0];
+            if (!find_builtin(name) && !find_exec_path(name)) {
+                unknown = name;
+                break;
+            }
+        }
+        if (!unknown) {
+            run_pipeline(stage_list, count);
             continue;
         }
 
         // 找不到命令，提示错误
-        fprintf(stderr, ESC_COLOR_ERROR"Unknown command: %s\n"ESC_COLOR_DEFAULT, cli.curr_input);
+        fprintf(stderr, ESC_COLOR_ERROR"Unknown command: %s\n"ESC_COLOR_DEFAULT, unknown);
     }
 
     return 0;
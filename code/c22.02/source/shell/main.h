@@ -10,6 +10,7 @@
 
 #define CLI_INPUT_SIZE              1024            // 输入缓存区
 #define	CLI_MAX_ARG_COUNT		    10			    // 最大接收的参数数量
+#define CLI_MAX_STAGE_COUNT         4               // 管道中最多的命令数量
 
 #define ESC_CMD2(Pn, cmd)		    "\x1b["#Pn#cmd
 #define	ESC_COLOR_ERROR			    ESC_CMD2(31, m)	// 红色错误
@@ -26,6 +27,16 @@ typedef struct _cli_cmd_t {
     int(*do_func)(int argc, char **argv);       // 回调函数
 }cli_cmd_t;
 
+/**
+ * 管道中的一条命令
+ */
+typedef struct _cli_stage_t {
+    int argc;
+    char * argv[CLI_MAX_ARG_COUNT + 1];
+    const char * in_file;           // <重定向的输入文件
+    const char * out_file;          // >重定向的输出文件
+}cli_stage_t;
+
 /**
  * 命令行管理器
  */
@@ -263,20 +263,28 @@ int main (int argc, char ** argv) {
 	row_max = 25;
 	col_max = 80;
 
-	ioctl(0, TTY_CMD_ECHO, 0, 0);
+	// 关闭回显和行缓存，等待按键时最多等0.1秒，不再轮询输入
+	struct termios old, raw;
+	tcgetattr(0, &old);
+	raw = old;
+	raw.c_lflag &= ~(ECHO | ICANON);
+	raw.c_cc[VMIN] = 1;
+	raw.c_cc[VTIME] = 0;
+	tcsetattr(0, TCSANOW, &raw);
 
 	show_welcome();
     begin_game();
 
-    int count;
+	raw.c_cc[VMIN] = 0;
+	raw.c_cc[VTIME] = 1;
+	tcsetattr(0, TCSANOW, &raw);
+
 	int cnt = 0;
 	do {
-		// 检查是否有键盘输入
-		ioctl(0, TTY_CMD_IN_COUNT, (int)&count, 0);
-		if (count) {
-			int ch = getchar();
+		char ch;
+		if (read(0, &ch, 1) > 0) {
 			move_forward(ch);
-		} else if (++cnt % 50 == 0) {
+		} else if (++cnt % 5 == 0) {
 			// 每隔一段时间自动往前移
 			move_forward(snake.dir);
 		}
@@ -286,15 +294,13 @@ int main (int argc, char ** argv) {
 			show_string(row, col,  "GAME OVER");
 			show_string(row + 1, col,  "Press Any key to continue");
 			fflush(stdout);
-			getchar();
+			while (read(0, &ch, 1) <= 0) {}
 			break;
 		}
-
-		msleep(10);
 	}while (1);
 
 	// 这里是有危险的，如果进程异常退出，将导致回显失败
-	ioctl(0, TTY_CMD_ECHO, 1, 0);
+	tcsetattr(0, TCSANOW, &old);
 	clear_map();
     return 0;
 }
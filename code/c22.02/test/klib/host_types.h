@@ -0,0 +1,21 @@
+/**
+ * 在主机上编译内核代码时使用的基本数据类型
+ *
+ * comm/types.h中的uint32_t为unsigned long，在64位主机上是64位的。
+ * 编译时用-include预先包含本文件，使各类型与目标机的宽度一致
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#ifndef HOST_TYPES_H
+#define HOST_TYPES_H
+
+#include <stdint.h>
+
+#define _UINT8_T_DECLARED
+#define _UINT16_T_DECLARED
+#define _UINT32_T_DECLARED
+#define _UINT64_T_DECLARED
+
+#endif // HOST_TYPES_H
@@ -0,0 +1,253 @@
+/**
+ * kernel_vsnprintf的主机测试
+ *
+ * 在主机上编译内核的klib.c，与主机C库的vsnprintf逐一比较输出和返回值，
+ * 覆盖标志、宽度、精度、ll长度、最小负数及缓存截断。带参数bench时比较两者的速度
+ *
+ * 创建时间：2022年8月5日
+ * 作者：李述铜
+ * 联系邮箱: 527676163@qq.com
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include "tools/klib.h"
+
+#define BUF_SIZE        256
+
+static int total;
+static int failed;
+
+// klib.c中panic用到的日志函数，测试中不会调用
+void log_printk (int level, const char * fmt, ...) {
+}
+
+void log_flush (void) {
+}
+
+/**
+ * @brief 按相同的参数分别调用两者，比较返回值及整个缓存，缓存未使用的部分也不能被改写
+ */
+static void check (int size, const char * fmt, ...) {
+    char expect[BUF_SIZE], actual[BUF_SIZE];
+    va_list args, args_copy;
+
+    memset(expect, 0x5A, sizeof(expect));
+    memset(actual, 0x5A, sizeof(actual));
+
+    va_start(args, fmt);
+    va_copy(args_copy, args);
+    int expect_len = vsnprintf(expect, size, fmt, args);
+    int actual_len = kernel_vsnprintf(actual, size, fmt, args_copy);
+    va_end(args_copy);
+    va_end(args);
+
+    total++;
+    if ((expect_len != actual_len) || memcmp(expect, actual, sizeof(expect))) {
+        failed++;
+        printf("FAIL size=%d fmt=\"%s\": expect %d \"%s\", got %d \"%s\"\n", size, fmt,
+                expect_len, size ? expect : "", actual_len, size ? actual : "");
+    }
+}
+
+/**
+ * @brief %p固定输出8位十六进制，与C库的格式不同，单独比较
+ */
+static void check_pointer (uintptr_t value) {
+    char expect[BUF_SIZE], actual[BUF_SIZE];
+
+    snprintf(expect, sizeof(expect), "0x%08x", (unsigned int)value);
+    kernel_snprintf(actual, sizeof(actual), "%p", (void *)value);
+
+    total++;
+    if (strcmp(expect, actual)) {
+        failed++;
+        printf("FAIL fmt=\"%%p\": expect \"%s\", got \"%s\"\n", expect, actual);
+    }
+}
+
+static const char * flag_list[] = {"", "-", "0", "-0"};
+static const char * width_list[] = {"", "1", "6", "12", "25"};
+static const char * prec_list[] = {"", ".", ".0", ".1", ".5", ".12"};
+
+#define ARRAY_SIZE(a)   (sizeof(a) / sizeof((a)[0]))
+
+/**
+ * @brief 32位整数的各种标志、宽度和精度组合
+ */
+static void test_int (void) {
+    static const int values[] = {0, 1, -1, 7, 42, -42, 12345, -98765, 0x7FFF0000, INT_MAX, INT_MIN};
+    static const char * conv_list[] = {"d", "i", "u", "x", "X"};
+    char fmt[32];
+
+    for (int f = 0; f < ARRAY_SIZE(flag_list); f++) {
+        for (int w = 0; w < ARRAY_SIZE(width_list); w++) {
+            for (int p = 0; p < ARRAY_SIZE(prec_list); p++) {
+                for (int c = 0; c < ARRAY_SIZE(conv_list); c++) {
+                    snprintf(fmt, sizeof(fmt), "[%%%s%s%s%s]", flag_list[f], width_list[w], prec_list[p], conv_list[c]);
+                    for (int v = 0; v < ARRAY_SIZE(values); v++) {
+                        check(BUF_SIZE, fmt, values[v]);
+                    }
+                }
+            }
+        }
+    }
+
+    // h在内核中不截断，只比较short范围内的值
+    check(BUF_SIZE, "%hd %hu %hx", -1234, 65535, 0xBEEF);
+}
+
+/**
+ * @brief 64位整数，重点是跨越32位、48位边界及10的各次幂附近的值，检查div10_64的分段除法
+ */
+static void test_ll (void) {
+    static const long long values[] = {
+        0, 1, -1, 9, 10, -10, 4294967295LL, 4294967296LL, 4294967297LL, -4294967296LL,
+        9999999999LL, 10000000000LL, 281474976710655LL, 281474976710656LL,
+        12345678901234567LL, -12345678901234567LL, LLONG_MAX, LLONG_MIN,
+    };
+    static const char * conv_list[] = {"lld", "lli", "llu", "llx", "llX"};
+    char fmt[32];
+
+    for (int f = 0; f < ARRAY_SIZE(flag_list); f++) {
+        for (int w = 0; w < ARRAY_SIZE(width_list); w++) {
+            for (int p = 0; p < ARRAY_SIZE(prec_list); p++) {
+                for (int c = 0; c < ARRAY_SIZE(conv_list); c++) {
+                    snprintf(fmt, sizeof(fmt), "[%%%s%s%s%s]", flag_list[f], width_list[w], prec_list[p], conv_list[c]);
+                    for (int v = 0; v < ARRAY_SIZE(values); v++) {
+                        check(BUF_SIZE, fmt, values[v]);
+                    }
+                }
+            }
+        }
+    }
+
+    // 10的各次幂及其前后的值
+    unsigned long long pow10 = 1;
+    for (int i = 0; i < 20; i++, pow10 *= 10) {
+        check(BUF_SIZE, "%llu %llu %llu", pow10 - 1, pow10, pow10 + 1);
+        check(BUF_SIZE, "%lld %lld", -(long long)(pow10 - 1), -(long long)pow10);
+    }
+    check(BUF_SIZE, "%llu %llx", ULLONG_MAX, ULLONG_MAX);
+
+    // 伪随机值，每16位分段的各种组合
+    unsigned long long seed = 0x123456789ABCDEFULL;
+    for (int i = 0; i < 5000; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        unsigned long long n = seed >> (i % 64);
+        check(BUF_SIZE, "%llu|%lld|%llx|%020llu", n, (long long)n, n, n);
+    }
+}
+
+/**
+ * @brief 宽度和精度由参数给出
+ */
+static void test_star (void) {
+    static const int widths[] = {-12, -3, 0, 3, 12};
+    static const int precs[] = {-1, 0, 2, 9};
+
+    for (int w = 0; w < ARRAY_SIZE(widths); w++) {
+        check(BUF_SIZE, "[%*d]", widths[w], -42);
+        check(BUF_SIZE, "[%-*x]", widths[w], 0xABC);
+        check(BUF_SIZE, "[%0*u]", widths[w], 77u);
+        check(BUF_SIZE, "[%*s]", widths[w], "abc");
+        for (int p = 0; p < ARRAY_SIZE(precs); p++) {
+            check(BUF_SIZE, "[%*.*d]", widths[w], precs[p], 1234);
+            check(BUF_SIZE, "[%*.*s]", widths[w], precs[p], "hello");
+            check(BUF_SIZE, "[%*.*lld]", widths[w], precs[p], LLONG_MIN);
+        }
+    }
+}
+
+/**
+ * @brief 字符、字符串、%%及不带格式的文本
+ */
+static void test_str (void) {
+    static const char * strs[] = {"", "a", "hello", "a longer string than width"};
+    char fmt[32];
+
+    for (int f = 0; f < 2; f++) {
+        for (int w = 0; w < ARRAY_SIZE(width_list); w++) {
+            for (int p = 0; p < ARRAY_SIZE(prec_list); p++) {
+                snprintf(fmt, sizeof(fmt), "[%%%s%s%ss]", flag_list[f], width_list[w], prec_list[p]);
+                for (int s = 0; s < ARRAY_SIZE(strs); s++) {
+                    check(BUF_SIZE, fmt, strs[s]);
+                }
+            }
+
+            snprintf(fmt, sizeof(fmt), "[%%%s%sc]", flag_list[f], width_list[w]);
+            check(BUF_SIZE, fmt, 'x');
+        }
+    }
+
+    check(BUF_SIZE, "%s", (char *)0);
+    check(BUF_SIZE, "100%% done, %c%c%c", 'o', 'k', '!');
+    check(BUF_SIZE, "no format at all");
+    check(BUF_SIZE, "");
+}
+
+/**
+ * @brief 缓存不够时截断，结果总以0结尾，返回值仍为完整输出的长度
+ */
+static void test_truncate (void) {
+    static const int sizes[] = {0, 1, 2, 3, 5, 8, 13, 21};
+
+    for (int i = 0; i < ARRAY_SIZE(sizes); i++) {
+        int size = sizes[i];
+        check(size, "%d", INT_MIN);
+        check(size, "%lld", LLONG_MIN);
+        check(size, "%20d|", 42);
+        check(size, "%-20s|", "left");
+        check(size, "%08x%08X", 0xDEADBEEF, 0xCAFE);
+        check(size, "[%5d.%03d] %s", 12, 7, "log message");
+        check(size, "%s%s%s", "abc", "defgh", "ijklmnop");
+    }
+}
+
+/**
+ * @brief 比较格式化一条典型日志的速度
+ */
+static void bench (void) {
+    const int count = 1000000;
+    char buf[BUF_SIZE];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        kernel_snprintf(buf, sizeof(buf), "<%d>[%5d.%03d] %s %08x %lld", 6, i, i % 1000, "msg", i, (long long)i * 1000003);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double kernel_ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / count;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        snprintf(buf, sizeof(buf), "<%d>[%5d.%03d] %s %08x %lld", 6, i, i % 1000, "msg", i, (long long)i * 1000003);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double libc_ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / count;
+
+    printf("kernel_snprintf: %.1f ns/call\n", kernel_ns);
+    printf("libc snprintf:   %.1f ns/call\n", libc_ns);
+}
+
+int main (int argc, char ** argv) {
+    if ((argc > 1) && !strcmp(argv[1], "bench")) {
+        bench();
+        return 0;
+    }
+
+    test_int();
+    test_ll();
+    test_star();
+    test_str();
+    test_truncate();
+
+    check_pointer(0);
+    check_pointer(0x1234);
+    check_pointer(0xDEADBEEF);
+
+    printf("%d/%d passed\n", total - failed, total);
+    return failed ? 1 : 0;
+}